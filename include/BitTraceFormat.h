@@ -0,0 +1,105 @@
+#ifndef BIT_TRACE_FORMAT_H
+#define BIT_TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <cstddef> // size_t用
+
+/**
+ * @brief ピン波形トレースの共通定義
+ *
+ * PinTraceRecorderが書き出し、ReplayPinInterfaceが読み込むコンパクトな
+ * バイナリ形式（HBT1）の定義。
+ *
+ * ファイル構成:
+ *   ヘッダ 8バイト: "HBT1" / バージョン / チャネル数 / 予約(2)
+ *   レコード: LEB128可変長整数 ((時間差us << 3) | (チャネル << 1) | レベル)
+ *
+ * 時間差は直前のレコードからのマイクロ秒。9600bps程度のビット境界であれば
+ * 1レコードは2バイトに収まる。
+ */
+namespace BitTrace
+{
+    /**
+     * @brief トレース対象チャネル
+     */
+    enum Channel
+    {
+        CHANNEL_TX = 0, ///< 送信データ（DI）
+        CHANNEL_RX = 1, ///< 受信データ（RO）
+        CHANNEL_DE = 2, ///< ドライバイネーブル
+        CHANNEL_COUNT = 3
+    };
+
+    /**
+     * @brief 出力形式
+     */
+    enum Format
+    {
+        FORMAT_BINARY, ///< HBT1バイナリ形式
+        FORMAT_VCD     ///< Value Change Dump（GTKWave等で表示可能）
+    };
+
+    /**
+     * @brief 1つのレベル変化
+     */
+    struct Edge
+    {
+        uint64_t timeMicros; ///< トレース開始からの時刻（マイクロ秒）
+        uint8_t channel;     ///< チャネル
+        uint8_t level;       ///< 変化後のレベル
+    };
+
+    static const uint8_t MAGIC[4] = {'H', 'B', 'T', '1'};
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 8;
+
+    /**
+     * @brief レコードのエンコード
+     * @param deltaMicros 直前のレコードからの時間差
+     * @param channel チャネル
+     * @param level レベル
+     * @param out 出力先（最大10バイト）
+     * @return 書き込んだバイト数
+     */
+    inline size_t encodeRecord(uint64_t deltaMicros, uint8_t channel, uint8_t level, uint8_t *out)
+    {
+        uint64_t value = (deltaMicros << 3) | ((uint64_t)(channel & 0x03) << 1) | (level ? 1 : 0);
+        size_t length = 0;
+        do
+        {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            out[length++] = value ? (byte | 0x80) : byte;
+        } while (value);
+        return length;
+    }
+
+    /**
+     * @brief レコードのデコード
+     * @param data 入力データ
+     * @param length 入力データ長
+     * @param deltaMicros 時間差（出力）
+     * @param channel チャネル（出力）
+     * @param level レベル（出力）
+     * @return 消費したバイト数（0の場合は不完全なレコード）
+     */
+    inline size_t decodeRecord(const uint8_t *data, size_t length,
+                               uint64_t &deltaMicros, uint8_t &channel, uint8_t &level)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < length && i < 10; i++)
+        {
+            value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+            if (!(data[i] & 0x80))
+            {
+                deltaMicros = value >> 3;
+                channel = (value >> 1) & 0x03;
+                level = value & 0x01;
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+}
+
+#endif // BIT_TRACE_FORMAT_H
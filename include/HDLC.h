@@ -15,6 +15,86 @@ using String = std::string;
 #endif
 
 #include "IPinInterface.h"
+#include "IFrameLogger.h"
+#include "IConfigStorage.h"
+#include "IByteStream.h"
+#include "PayloadCodec.h"
+
+/**
+ * @brief Serialへのデバッグトレース出力（1で有効）
+ *
+ * ビット毎・フレーム毎にSerialへ出力するため、有効にすると
+ * ビットタイミングと応答時間が大きく乱れる。通常はPcapWriter等の
+ * フレームロガーを使うこと。
+ */
+#ifndef HDLC_SERIAL_TRACE
+#define HDLC_SERIAL_TRACE 0
+#endif
+#ifdef NATIVE_TEST
+#undef HDLC_SERIAL_TRACE
+#define HDLC_SERIAL_TRACE 0
+#endif
+
+/**
+ * @brief 拡張モード（モジュロ128、2バイトコントロール）の有効化
+ *
+ * 既定ではRAMの少ないAVRでは無効、それ以外では有効。
+ * 無効の場合はSNRMEを送受信せず、常にモジュロ8で動作する。
+ */
+#ifndef HDLC_ENABLE_EXTENDED_MODE
+#if defined(__AVR__)
+#define HDLC_ENABLE_EXTENDED_MODE 0
+#else
+#define HDLC_ENABLE_EXTENDED_MODE 1
+#endif
+#endif
+
+/**
+ * @brief Iフレーム情報フィールドの圧縮（PayloadCodec）の有効化
+ *
+ * 有効でも、negotiateCompressionで相手局と合意したリンクでだけ使う。
+ * 無効の場合はXIDで圧縮を提案されても受理しない。
+ */
+#ifndef HDLC_ENABLE_COMPRESSION
+#define HDLC_ENABLE_COMPRESSION 1
+#endif
+
+/**
+ * @brief バースト送信用バッファサイズ（バイト）
+ *
+ * sendIFramesはウィンドウ内のフレームをこのバッファに作成し、1回の送信
+ * 区間（DEの切り替え1回、フレーム間のフラグは共有）で送る。入りきらない
+ * 場合は複数のバーストに分ける。関数内の一時バッファとしてスタックに置く。
+ */
+#ifndef HDLC_BURST_BUFFER_SIZE
+#if defined(__AVR__)
+#define HDLC_BURST_BUFFER_SIZE 128
+#else
+#define HDLC_BURST_BUFFER_SIZE 1024
+#endif
+#endif
+
+/**
+ * @brief 非同期要求（connect/submitI）の待ち行列の長さ
+ */
+#ifndef HDLC_ASYNC_QUEUE_SIZE
+#if defined(__AVR__)
+#define HDLC_ASYNC_QUEUE_SIZE 4
+#else
+#define HDLC_ASYNC_QUEUE_SIZE 16
+#endif
+#endif
+
+/**
+ * @brief 受信コールバックへ渡すまでフレームを保持するスロット数（2のべき乗）
+ */
+#ifndef HDLC_RX_QUEUE_SLOTS
+#if defined(__AVR__)
+#define HDLC_RX_QUEUE_SLOTS 2
+#else
+#define HDLC_RX_QUEUE_SLOTS 8
+#endif
+#endif
 
 /**
  * @brief 統合HDLC/RS485通信クラス
@@ -34,18 +114,227 @@ public:
      */
     static const uint8_t FLAG_SEQUENCE = 0x7E;
 
+    /**
+     * @brief アボートとみなす連続1ビット数
+     */
+    static const uint8_t ABORT_ONES = 7;
+
+    /**
+     * @brief 回線アイドルとみなす連続1ビット数
+     */
+    static const uint8_t IDLE_ONES = 15;
+
+    /**
+     * @brief 全局宛てのアドレス
+     */
+    static const uint8_t BROADCAST_ADDRESS = 0xFF;
+
+    /**
+     * @brief コントロールフィールドのP/Fビット
+     */
+    static const uint8_t POLL_FINAL_BIT = 0x10;
+
     /**
      * @brief HDLCコマンドタイプ
      */
     enum CommandType
     {
-        CMD_SNRM = 0x83, // Set Normal Response Mode
-        CMD_UA = 0x63,   // Unnumbered Acknowledgment
-        CMD_I = 0x00,    // Information (下位3ビットに送信シーケンス番号)
-        CMD_RR = 0x01,   // Receive Ready (下位3ビットに受信シーケンス番号)
-        CMD_REJ = 0x09   // Reject (下位3ビットに受信シーケンス番号)
+        CMD_SNRM = 0x83,  // Set Normal Response Mode
+        CMD_SNRME = 0xCF, // Set Normal Response Mode Extended（モジュロ128）
+        CMD_UA = 0x63,    // Unnumbered Acknowledgment
+        CMD_I = 0x00,     // Information (ビット1-3に送信シーケンス番号)
+        CMD_RR = 0x01,    // Receive Ready (ビット5-7に受信シーケンス番号)
+        CMD_REJ = 0x09,   // Reject (ビット5-7に受信シーケンス番号)
+        CMD_XID = 0xAF,   // Exchange Identification（通信速度の交渉）
+        CMD_TEST = 0xE3   // Test（情報フィールドをそのまま折り返す）
+    };
+
+    /**
+     * @brief XID情報フィールドの形式識別子（ISO/IEC 8885の汎用形式）
+     */
+    static const uint8_t XID_FORMAT_ID = 0x82;
+
+    /**
+     * @brief XID情報フィールドのグループ識別子（ユーザ定義グループ）
+     */
+    static const uint8_t XID_GROUP_ID = 0xF0;
+
+    /**
+     * @brief XIDのパラメータ識別子
+     *
+     * グループ内は パラメータ識別子(1) + 長さ(1) + 値 の並び。
+     */
+    enum XidParameter
+    {
+        XID_PARAM_BAUD_RATE = 0x01,  ///< 通信速度（4バイト、ビッグエンディアン）
+        XID_PARAM_COMPRESSION = 0x02 ///< 情報フィールドの圧縮（1バイト、0 無効, 1 PayloadCodec）
     };
 
+    /**
+     * @brief 速度切り替え後、新しい速度で有効なフレームを受信できなければ元に戻すまでの時間（ミリ秒）
+     */
+    static const uint32_t BAUD_FALLBACK_MS = 200;
+
+    /**
+     * @brief フレーム形式
+     */
+    enum FrameFormat
+    {
+        FORMAT_I, ///< 情報フレーム
+        FORMAT_S, ///< 監視フレーム（RR/REJ）
+        FORMAT_U  ///< 非番号制フレーム（SNRM/UA等）
+    };
+
+    /**
+     * @brief 解析済みのコントロールフィールド
+     *
+     * 拡張モードではI/S形式のコントロールフィールドが2バイト
+     * （1バイト目: N(S)または監視種別、2バイト目: N(R)とP/F）になる。
+     */
+    struct ControlField
+    {
+        FrameFormat format;      ///< フレーム形式
+        uint8_t command;         ///< CMD_I/CMD_RR/CMD_REJ、U形式はP/Fを除いた値
+        uint8_t sendSequence;    ///< N(S)（I形式のみ）
+        uint8_t receiveSequence; ///< N(R)（I/S形式のみ）
+        bool pollFinal;          ///< P/Fビット
+        size_t length;           ///< コントロールフィールド長（1または2）
+    };
+
+    /**
+     * @brief 受信統計
+     */
+    struct ReceiveStatistics
+    {
+        uint32_t filteredFrames; ///< アドレスフィルタで破棄したフレーム数
+        uint32_t abortedFrames;  ///< アボートシーケンスで破棄したフレーム数
+        uint32_t oversizeFrames; ///< 最大長超過で破棄したフレーム数
+        uint32_t idleDetections; ///< 回線アイドルを検出した回数
+        uint32_t crcErrors;      ///< CRC異常で破棄したフレーム数
+        uint32_t validFrames;    ///< CRC正常で受信したフレーム数
+        uint32_t overrunFrames;  ///< 受信スロットが一杯で通知できなかったフレーム数
+        uint32_t codecErrors;    ///< 圧縮された情報フィールドを伸長できず破棄したフレーム数
+    };
+
+    /**
+     * @brief 局の役割
+     */
+    enum Role
+    {
+        ROLE_PRIMARY,  ///< 一次局（SNRM/Iフレームを送信し応答を待つ）
+        ROLE_SECONDARY ///< 二次局（自局宛てのコマンドに応答する）
+    };
+
+    /**
+     * @brief 回線符号化方式
+     */
+    enum LineCoding
+    {
+        LINE_NRZ, ///< ビットの値をそのままレベルで送る
+        LINE_NRZI ///< 0でレベルを反転し、1で保持する
+    };
+
+    /**
+     * @brief 相手局とのリンク状態
+     */
+    enum LinkState
+    {
+        LINK_DISCONNECTED, ///< 未接続（SNRM未確立）
+        LINK_CONNECTED     ///< SNRM/UAで接続済み
+    };
+
+    /**
+     * @brief 相手局毎のセッション情報
+     *
+     * 複数の二次局を扱う場合は局毎にこの構造体を用意し、selectSession()で
+     * 切り替える。ある局への応答処理は選択中のセッションだけを更新する。
+     */
+    struct StationSession
+    {
+        uint8_t address;           ///< 相手局アドレス
+        LinkState linkState;       ///< リンク状態
+        uint8_t sendSequence;      ///< 未確認の先頭IフレームのN(S)（0-7、拡張モードは0-127）
+        uint8_t receiveSequence;   ///< 受信状態変数 V(R)（0-7、拡張モードは0-127）
+        uint8_t outstandingFrames; ///< 未確認の送信Iフレーム数
+        uint32_t lastSeenMillis;   ///< 最後に応答を受信した時刻
+        bool extendedMode;         ///< 拡張モード（SNRME/UAで確立）
+        uint32_t srttMicros;       ///< 平滑化した応答遅延（0は未測定）
+        uint32_t rttVarMicros;     ///< 応答遅延のばらつき
+        uint8_t timeoutBackoff;    ///< 連続タイムアウトによるタイムアウト倍率（2のべき乗）
+        bool compression;          ///< Iフレームの情報フィールドを圧縮（XIDで合意、SNRMで解除）
+    };
+
+    /**
+     * @brief 保存・復元するリンク設定
+     *
+     * begin()で設定ストレージから読み出して適用する。
+     */
+    struct LinkConfig
+    {
+        uint8_t address;            ///< 相手局（二次局では自局）アドレス
+        Role role;                  ///< 局の役割
+        uint32_t baudRate;          ///< 通信速度
+        uint32_t maxBaudRate;       ///< 速度交渉・調整の上限
+        uint32_t responseTimeoutMs; ///< 応答待機タイムアウト時間（ミリ秒）
+        bool adaptiveTimeout;       ///< 測定した応答遅延によるタイムアウト
+        uint8_t windowSize;         ///< 送信ウィンドウサイズ
+        bool extendedMode;          ///< 拡張モード（SNRME）を要求する
+        LineCoding lineCoding;      ///< 回線符号化方式
+    };
+
+    /**
+     * @brief 保存済みの設定が無い場合にbegin()で設定する相手局アドレス
+     */
+    static const uint8_t DEFAULT_ADDRESS = 1;
+
+    /**
+     * @brief ポーリング結果
+     */
+    enum PollResult
+    {
+        POLL_NO_RESPONSE, ///< 応答なし（タイムアウトまたは不正フレーム）
+        POLL_READY,       ///< RR応答（送信データなし）
+        POLL_DATA,        ///< Iフレーム応答（readFrameで読み出し可能）
+        POLL_REJECTED     ///< REJ応答
+    };
+
+    /**
+     * @brief 非同期要求のハンドル（INVALID_HANDLEは受け付けられなかった要求）
+     */
+    typedef uint8_t RequestHandle;
+
+    /**
+     * @brief 無効なハンドル
+     */
+    static const RequestHandle INVALID_HANDLE = 0;
+
+    /**
+     * @brief 非同期要求の結果
+     */
+    enum RequestStatus
+    {
+        REQUEST_COMPLETED, ///< 確認応答あり（UA、またはN(R)による確認）
+        REQUEST_REJECTED,  ///< REJ応答
+        REQUEST_TIMEOUT,   ///< 応答なし
+        REQUEST_FAILED     ///< 不正な応答または送信失敗
+    };
+
+    /**
+     * @brief 非同期要求の完了コールバック
+     * @param handle 完了した要求
+     * @param status 結果
+     * @param context setCompletionCallbackで渡した値
+     */
+    typedef void (*CompletionCallback)(RequestHandle handle, RequestStatus status, void *context);
+
+    /**
+     * @brief 受信フレームの通知コールバック
+     * @param data フレーム（アドレスから情報フィールドまで、CRCを除く。呼び出し中のみ有効）
+     * @param length フレーム長
+     * @param isValid CRCチェックの結果
+     */
+    typedef void (*FrameReceivedCallback)(const uint8_t *data, size_t length, bool isValid);
+
     /**
      * @brief コンストラクタ
      * @param pinInterface ピンインターフェース
@@ -59,11 +348,77 @@ public:
          uint8_t dePin, uint8_t rePin, uint32_t baudRate);
 
     /**
-     * @brief 初期化（アドレス入力を含む）
+     * @brief 初期化
+     *
+     * ピンを設定し、設定ストレージ（setConfigStorage）に有効なリンク設定が
+     * あれば適用する。無ければ相手局アドレスをDEFAULT_ADDRESSにする。
+     * 入力待ち等は行わず、すぐに戻る。
      * @return true 成功, false 失敗
      */
     bool begin();
 
+    /**
+     * @brief リンク設定の保存先を設定（begin()より前に呼ぶ）
+     * @param storage 保存先（nullptrで保存しない）
+     */
+    void setConfigStorage(IConfigStorage *storage) { this->m_configStorage = storage; }
+
+    /**
+     * @brief 非同期（オクテット単位）フレーミングで送受信するバイトストリームを設定
+     *
+     * 設定するとフレームをISO/IEC 13239の調歩同期形式（0x7Eで区切り、0x7E/0x7Dを
+     * 0x7Dでエスケープ）でストリームへ送受信し、TX/RXピンのビット操作は行わない。
+     * アドレス・コントロール・FCS・リンク制御はビット同期と共通で、DE/REの切り替えも
+     * これまで通り行う。setBaudRateはストリームの速度も変更する。
+     * detectBaudRate・setLineCodingはビット同期でのみ使える。
+     * @param stream バイトストリーム（nullptrでビット同期に戻す）
+     */
+    void setByteStream(IByteStream *stream);
+
+    /**
+     * @brief 設定中のバイトストリーム（ビット同期ではnullptr）
+     */
+    IByteStream *getByteStream() const { return this->m_byteStream; }
+
+    /**
+     * @brief 現在のリンク設定を取得
+     */
+    LinkConfig getLinkConfig() const;
+
+    /**
+     * @brief リンク設定を適用
+     * @param config 設定
+     */
+    void applyLinkConfig(const LinkConfig &config);
+
+    /**
+     * @brief 現在のリンク設定を設定ストレージへ保存
+     *
+     * 保存済みの内容と同じ場合は書き込まない。
+     * @return true 成功（変更なしを含む）, false 保存先が無いまたは書き込み失敗
+     */
+    bool saveLinkConfig();
+
+    /**
+     * @brief リンク設定をバイト列へ変換（マジック・バージョン・CRC付き）
+     * @param config 設定
+     * @param out 出力先（LINK_CONFIG_SIZEバイト）
+     */
+    static void encodeLinkConfig(const LinkConfig &config, uint8_t *out);
+
+    /**
+     * @brief バイト列からリンク設定を復元
+     * @param data encodeLinkConfigの出力（LINK_CONFIG_SIZEバイト）
+     * @param config 復元先
+     * @return true 成功, false マジック・バージョン・CRC・値の不一致（未保存を含む）
+     */
+    static bool decodeLinkConfig(const uint8_t *data, LinkConfig &config);
+
+    /**
+     * @brief 保存するリンク設定のバイト数
+     */
+    static const size_t LINK_CONFIG_SIZE = 21;
+
     /**
      * @brief 指定アドレスにSNRMコマンドを送信してUAを待機
      * @return true 成功, false 失敗
@@ -80,15 +435,61 @@ public:
 
     /**
      * @brief Iコマンドでデータを送信（タイムアウト指定）
+     *
+     * コントロールフィールドにはN(S)=V(S)、N(R)=V(R)、P=1を設定する。
+     * 応答がIフレームの場合はそのN(R)で確認応答とみなし、N(S)がV(R)と
+     * 一致すればデータを受信キューに残す（readFrameで読み出す）。
      * @param data 送信するデータ
      * @param length データ長
      * @param timeoutMs レスポンス待機タイムアウト時間（ミリ秒）
-     * @return true 成功, false 失敗
+     * @return true 成功（確認応答あり）, false 失敗
      */
     bool sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs);
 
+    /**
+     * @brief 複数のIフレームをウィンドウ制御（Go-Back-N）で送信
+     *
+     * 最大ウィンドウサイズまで応答を待たずに送信し、ウィンドウの最後の
+     * フレームにだけPビットを立てる。ウィンドウ内のフレームは1回のバースト
+     * （DE切り替え1回、フレーム間は1つのフラグを終了/開始で共有）で送る。応答のN(R)で確認された分だけ進め、
+     * REJまたは一部未確認の場合は未確認の先頭から再送する。
+     * @param payloads 送信データの配列
+     * @param lengths 各データの長さ
+     * @param count データ数
+     * @param maxRetries 無応答・再送要求時の最大再試行回数
+     * @return 確認応答を受けたデータ数（先頭から）
+     */
+    size_t sendIFrames(const uint8_t *const *payloads, const size_t *lengths, size_t count,
+                       uint8_t maxRetries = 3);
+
+    /**
+     * @brief 送信ウィンドウサイズを設定（既定7）
+     *
+     * モジュロ8では最大7、拡張モードでは最大127に制限される。
+     * @param windowSize ウィンドウサイズ（1以上）
+     */
+    void setWindowSize(uint8_t windowSize) { this->m_windowSize = windowSize ? windowSize : 1; }
+
+#if HDLC_ENABLE_EXTENDED_MODE
+    /**
+     * @brief 次のリンク確立で拡張モード（SNRME）を要求するか
+     * @param enabled true SNRMEを送信, false SNRMを送信（既定）
+     */
+    void setExtendedMode(bool enabled) { this->m_extendedRequested = enabled; }
+#endif
+
+    /**
+     * @brief 選択中のセッションでのアドレス+コントロールフィールド長
+     *
+     * readFrameで読み出したIフレームのデータはこのオフセットから始まる。
+     */
+    size_t frameHeaderSize() const { return this->_isExtended() ? 3 : 2; }
+
     /**
      * @brief フレーム受信（低レベルビット制御）
+     *
+     * タイムアウトはフレームの開始までに適用し、受信途中のフレームは
+     * 終了フラグ（またはアボート・最大長超過）まで受信を続ける。
      * @param timeoutMs タイムアウト時間（ミリ秒）
      * @return true フレーム受信成功, false タイムアウトまたはエラー
      */
@@ -108,6 +509,400 @@ public:
      */
     void setAddress(uint8_t address);
 
+    /**
+     * @brief 局の役割を設定
+     *
+     * 二次局では選択中のセッションのアドレスが自局アドレスとなり、
+     * 応答フレーム（UA/RR/REJ）をCRC込みで事前に作成しておく。
+     * @param role 役割
+     */
+    void setRole(Role role);
+
+    /**
+     * @brief 局の役割を取得
+     */
+    Role getRole() const { return this->m_role; }
+
+    /**
+     * @brief 選択中の局へのSNRM（拡張モード要求時はSNRME）を非同期に要求
+     *
+     * 要求は待ち行列に入り、service()で順に処理される。
+     * @return ハンドル（待ち行列が一杯の場合はINVALID_HANDLE）
+     */
+    RequestHandle connect();
+
+    /**
+     * @brief 選択中の局へのIフレーム送信を非同期に要求
+     *
+     * N(S)/N(R)は送信時点のセッションから決まる。データは完了コールバックが
+     * 呼ばれるまで呼び出し側で保持すること（コピーしない）。
+     * @param data 送信データ
+     * @param length データ長
+     * @return ハンドル（待ち行列が一杯・引数不正の場合はINVALID_HANDLE）
+     */
+    RequestHandle submitI(const uint8_t *data, size_t length);
+
+    /**
+     * @brief 要求が未完了か
+     * @param handle ハンドル
+     */
+    bool isPending(RequestHandle handle) const;
+
+    /**
+     * @brief 未完了の要求数
+     */
+    size_t pendingRequests() const { return this->m_requestCount; }
+
+    /**
+     * @brief セッションに未完了の要求があるか
+     * @param session セッション
+     */
+    bool hasPendingRequests(const StationSession *session) const;
+
+    /**
+     * @brief 非同期要求の完了コールバックを設定
+     * @param callback コールバック（nullptrで通知しない）
+     * @param context コールバックへ渡す値
+     */
+    void setCompletionCallback(CompletionCallback callback, void *context = nullptr);
+
+    /**
+     * @brief 非同期要求の処理を進める（loop()から繰り返し呼ぶ）
+     *
+     * 要求の送信開始時はフレームの送信が終わるまで、応答待ちでは応答フレームの
+     * 開始を検出した時にそのフレームの受信が終わるまで戻らない（ビット同期の
+     * 送受信は途中で中断できないため）。それ以外の応答待ちの間は回線を1回
+     * 確認してすぐに戻る。応答フレームの開始フラグを逃さないよう、呼び出し
+     * 間隔は1ビット時間より短くするか、相手局の setPreambleFlags で開始フラグを
+     * 増やすこと。完了した要求はコールバックで通知する。
+     * 要求が無い間も回線を確認し、要求外のフレームを受信する（二次局では
+     * listen()と同じく応答する）。受信スロットのフレームは最後に通知する。
+     * @return true 処理中の要求がある, false なし
+     */
+    bool service();
+
+    /**
+     * @brief 受信フレームの通知先を設定
+     *
+     * 受信処理はフレームを受信スロットへコピーするだけで、コールバックは次の
+     * service()で呼ぶ（ビット受信中や割り込み内では呼ばない）。dataは受信スロット
+     * 内を指し、コールバックから戻るまで有効。スロットが一杯の間に受信した
+     * フレームは通知せず、受信統計のoverrunFramesに数える。
+     * @param callback コールバック（nullptrで通知しない）
+     */
+    void setReceiveCallback(FrameReceivedCallback callback) { this->m_receiveCallback = callback; }
+
+    /**
+     * @brief フレーム前に送る開始フラグの数（既定1）
+     *
+     * 受信側がservice()で応答を待つ場合、開始フラグを増やすと呼び出し間隔が
+     * 長くても（フラグ1つ毎に8ビット時間）フレームの開始を検出できる。
+     * @param count 開始フラグの数（1以上）
+     */
+    void setPreambleFlags(uint8_t count) { this->m_preambleFlags = count ? count : 1; }
+
+    /**
+     * @brief 二次局として1フレーム待ち受けて応答
+     *
+     * 自局宛て（またはブロードキャスト）のフレームだけを処理する。
+     * SNRMにはUAを返してシーケンス番号をリセットし、IフレームはN(S)がV(R)と
+     * 一致すればRR、一致しなければREJを返す。受理したIフレームは受信キューに
+     * 残す（readFrameで読み出す）。ブロードキャストには応答しない。
+     * 応答は受信完了直後に事前作成済みのフレームで送信する。
+     * queueResponseDataで送信データがある場合は、RRの代わりにIフレーム
+     * （N(R)で受信確認を兼ねる）で応答する。
+     * @param timeoutMs 受信タイムアウト時間（ミリ秒）
+     * @return true Iフレームを受理した, false それ以外
+     */
+    bool listen(uint32_t timeoutMs);
+
+    /**
+     * @brief 二次局から一次局へ送るデータを登録
+     *
+     * 次のポーリングまたはIフレームへの応答としてIフレームで送信し、
+     * 一次局のN(R)で確認されるまで同じN(S)で再送する。
+     * @param data 送信データ
+     * @param length データ長
+     * @return true 成功, false 未確認のデータがある、または長すぎる
+     */
+    bool queueResponseData(const uint8_t *data, size_t length);
+
+    /**
+     * @brief 確認待ちの送信データがあるか
+     */
+    bool hasPendingResponse() const { return this->m_pendingLength > 0; }
+
+    /**
+     * @brief 受信アドレスフィルタの有効/無効（既定は無効）
+     *
+     * 有効にすると、受信中のフレームの先頭1バイト（アドレス）が確定した時点で
+     * 受理アドレス表と照合し、一致しなければ残りを保存せず次のフラグ探索に移る。
+     * 現在のセッションのアドレスは常に受理する。
+     * @param enabled true 有効, false 無効
+     */
+    void setAddressFilter(bool enabled) { this->m_addressFilterEnabled = enabled; }
+
+    /**
+     * @brief 受理アドレスの登録/解除（自局・グループ・ブロードキャスト等）
+     * @param address アドレス
+     * @param accept true 受理, false 受理しない
+     */
+    void acceptAddress(uint8_t address, bool accept = true);
+
+    /**
+     * @brief 受理アドレスをすべて解除
+     */
+    void clearAcceptedAddresses();
+
+    /**
+     * @brief アドレスが受理対象か
+     * @param address アドレス
+     * @return true 受理, false 破棄
+     */
+    bool isAddressAccepted(uint8_t address) const
+    {
+        return !this->m_addressFilterEnabled || address == this->m_session->address ||
+               (this->m_acceptMap[address >> 3] & (1 << (address & 0x07)));
+    }
+
+    /**
+     * @brief 受信統計を取得
+     */
+    const ReceiveStatistics &getReceiveStatistics() const { return this->m_receiveStatistics; }
+
+    /**
+     * @brief 受信統計をクリア
+     */
+    void resetReceiveStatistics();
+
+    /**
+     * @brief 通信速度を変更し、ビット時間等のタイミングを再計算
+     *
+     * setDriverTiming/calibrateDriverTimingで設定していない場合は
+     * ドライバ切り替えの待機時間も新しい速度の既定値にする。
+     * @param baudRate 通信速度（bps）
+     */
+    void setBaudRate(uint32_t baudRate);
+
+    /**
+     * @brief 現在の通信速度（bps）
+     */
+    uint32_t getBaudRate() const { return this->m_baudRate; }
+
+    /**
+     * @brief 回線上のフラグから通信速度を検出
+     *
+     * 受信モードでRXのエッジ時刻を記録し、最短の区間を1ビットとみなす。
+     * その6倍の長さのHIGH区間（フラグ0x7Eの6個の1、データ中はスタッフィング
+     * により現れない）が見つかれば、その長さ/6をビット時間として速度を求め、
+     * 標準の速度に近ければ丸める。フラグフィルの途中から始めた場合は1ビットの
+     * 区間が無いので、LOW 2ビット・HIGH 6ビットの周期が続けば周期/8をビット時間とする。
+     * 現在の設定は変更しない。
+     * @param timeoutMs 最大待機時間（ミリ秒）
+     * @return 検出した速度（bps）、検出できなければ0（非同期フレーミングでは常に0）
+     */
+    uint32_t detectBaudRate(uint32_t timeoutMs);
+
+    /**
+     * @brief 自動速度検出モードの有効/無効（既定は無効）
+     *
+     * 有効にすると、速度が未確定の間はreceiveFrameWithBitControlの前に
+     * detectBaudRateで速度を検出して切り替える（検出に使ったフレームは
+     * 受信できないため、相手局の再送で受け取る）。受信エラーが続いた場合は
+     * 再度検出する。
+     * @param enabled true 有効, false 無効
+     */
+    void setAutoBaud(bool enabled);
+
+    /**
+     * @brief 回線符号化方式を設定（既定はLINE_NRZ）
+     *
+     * LINE_NRZIではビットスタッフィングと合わせて6ビット以内（フラグ中は7ビット）に
+     * 必ずエッジが現れるため、受信時はエッジ毎に標本化の位相を合わせ直す。
+     * 長いフレームや高い速度でもクロックのずれが蓄積しない。
+     * 相手局と同じ方式にすること。detectBaudRateはNRZの回線でのみ使える。
+     * @param coding 回線符号化方式
+     */
+    void setLineCoding(LineCoding coding) { this->m_lineCoding = coding; }
+
+    /**
+     * @brief 現在の回線符号化方式
+     */
+    LineCoding getLineCoding() const { return this->m_lineCoding; }
+
+    /**
+     * @brief ドライバ切り替えの待機時間を設定
+     *
+     * 既定は送信時 半ビット+100us、受信切り替え時 半ビット。
+     * @param settleMicros DE有効化から最初のビット（開始フラグ）までの待機時間
+     * @param turnaroundMicros DE解除から受信開始までの待機時間
+     */
+    void setDriverTiming(uint32_t settleMicros, uint32_t turnaroundMicros);
+
+    /**
+     * @brief DE有効化後の待機時間（マイクロ秒）
+     */
+    uint32_t getSettleMicros() const { return this->m_settleMicros; }
+
+    /**
+     * @brief DE解除後の待機時間（マイクロ秒）
+     */
+    uint32_t getTurnaroundMicros() const { return this->m_turnaroundMicros; }
+
+    /**
+     * @brief ループバックでドライバの切り替え時間を測定して待機時間を設定
+     *
+     * REを有効にしたままTXをLOWにしてDEを切り替え、自局の受信出力が
+     * 変化するまでの時間（有効化・解除それぞれ）を測定する。測定値の最大に
+     * 1/8ビット時間の余裕を加えて setDriverTiming() に設定する。
+     * バスが空いている時（他局が送信していない時）に呼ぶこと。
+     * @param samples 測定回数
+     * @return true 成功, false 応答なし（ループバック不可・バス使用中等、設定は変更しない）
+     */
+    bool calibrateDriverTiming(uint8_t samples = 8);
+
+    /**
+     * @brief 選択中の局と通信速度を交渉して切り替える（一次局）
+     *
+     * 現在の速度でXID(P)により速度を提案し、相手局はXID(F)で受理する速度
+     * （提案以下で自局の上限まで）を返してから切り替える。一次局は応答の受信後に
+     * 切り替え、新しい速度でTEST(P)を送って折り返しを確認する。確認できなければ
+     * 元の速度に戻す（相手局はBAUD_FALLBACK_MSの間に新しい速度で有効なフレームを
+     * 受信できなければ元に戻る）。速度はバス全体で共通のため、1対1の区間で使うこと。
+     * @param baudRate 提案する通信速度（bps）
+     * @return true 新しい速度に切り替えた, false 拒否・失敗（元の速度のまま）
+     */
+    bool negotiateBaudRate(uint32_t baudRate);
+
+    /**
+     * @brief 選択中の局とIフレーム情報フィールドの圧縮を交渉する（一次局）
+     *
+     * XID(P)で提案し、相手局がXID(F)で受理すれば以後のIフレームの情報フィールドを
+     * PayloadCodecで圧縮する（先頭1バイトが方式、縮まなければ無圧縮のまま送る）。
+     * リンクの再確立（SNRM）で解除される。圧縮中は方式バイトの分、1フレームの
+     * データは1バイト短くなる。
+     * @param enable true 圧縮を提案, false 圧縮の解除
+     * @return true 相手局が応答し、要求どおりの状態になった
+     */
+    bool negotiateCompression(bool enable);
+
+    /**
+     * @brief 交渉で受け入れる通信速度の上限（既定115200）
+     *
+     * tuneBaudRateが維持できなかった速度を再び試さないための制限も解除する。
+     * @param baudRate 上限（bps）
+     */
+    void setMaxBaudRate(uint32_t baudRate);
+
+    /**
+     * @brief 交渉で受け入れる通信速度の上限（bps）
+     */
+    uint32_t getMaxBaudRate() const { return this->m_maxBaudRate; }
+
+    /**
+     * @brief 二次局で速度切り替えの確認待ちか
+     */
+    bool isBaudChangePending() const { return this->m_fallbackBaudRate != 0; }
+
+    /**
+     * @brief 前回からの受信CRC異常率に応じて通信速度を1段階上げ下げする（一次局）
+     *
+     * 前回の呼び出しからの受信フレームが一定数に達していれば recommendBaudRate の
+     * 速度を negotiateBaudRate で交渉する。CRC異常で速度を下げた場合は下げる前の速度を、
+     * 速度を上げられなかった場合はその速度を上限とし、速度を上げる基準を満たす区間が16回続くか
+     * setMaxBaudRate が呼ばれるまで試さない。定期的（ポーリングの合間等）に呼ぶ。
+     * 全局が同じ速度で受信する必要があるため、1対1の回線でだけ使う。
+     * @return true 速度を変更した, false 変更なし
+     */
+    bool tuneBaudRate();
+
+    /**
+     * @brief CRC異常率から次に使う通信速度を求める
+     *
+     * 異常率が0.5%以下なら1段上、5%以上なら1段下の標準速度を返す。
+     * @param baudRate 現在の速度（bps）
+     * @param validFrames CRC正常の受信フレーム数
+     * @param crcErrors CRC異常の受信フレーム数
+     * @param maxBaudRate 上げる場合の上限（bps）
+     * @return 推奨する速度（変更不要なら現在の速度）
+     */
+    static uint32_t recommendBaudRate(uint32_t baudRate, uint32_t validFrames, uint32_t crcErrors,
+                                      uint32_t maxBaudRate);
+
+    /**
+     * @brief 応答待機タイムアウト時間の設定（既定50ms）
+     *
+     * 引数でタイムアウトを指定しないsendICommand/sendSNRMAndWaitUA等で、
+     * 局の応答遅延が未測定の場合（適応タイムアウト無効時は常に）使う。
+     * @param timeoutMs タイムアウト時間（ミリ秒）
+     */
+    void setResponseTimeout(uint32_t timeoutMs) { this->m_responseTimeoutMs = timeoutMs; }
+
+    /**
+     * @brief 測定した応答遅延によるタイムアウトの有効/無効（既定は有効）
+     * @param enabled true 局毎のSRTT/RTTVARから算出, false setResponseTimeoutの値に固定
+     */
+    void setAdaptiveTimeout(bool enabled) { this->m_adaptiveTimeout = enabled; }
+
+    /**
+     * @brief 選択中のセッションの応答待機タイムアウト時間
+     *
+     * SRTT + 4×RTTVAR（応答フレームの開始まで）にフラグ検出分の余裕を加え、
+     * 連続タイムアウトの回数に応じて倍にする（MAX_RESPONSE_TIMEOUT_MSまで）。
+     * setAdaptiveTimeout(false)の場合はsetResponseTimeoutの値をそのまま返す。
+     * @return タイムアウト時間（ミリ秒）
+     */
+    uint32_t responseTimeoutMs() const;
+
+    /**
+     * @brief 応答遅延の測定値でSRTT/RTTVARを更新
+     * @param session 対象のセッション
+     * @param sampleMicros 送信完了から応答フレーム開始までの時間
+     */
+    static void updateRttEstimate(StationSession &session, uint32_t sampleMicros);
+
+    /**
+     * @brief 適応タイムアウトの上限（ミリ秒）
+     */
+    static const uint32_t MAX_RESPONSE_TIMEOUT_MS = 5000;
+
+    /**
+     * @brief 操作対象のセッションを選択
+     *
+     * 以降のsendSNRMAndWaitUA/sendICommand/pollStationは選択したセッションの
+     * アドレスとシーケンス番号を使う。セッションの領域は呼び出し側が保持する。
+     * @param session セッション（nullptrで内蔵の既定セッションに戻す）
+     */
+    void selectSession(StationSession *session);
+
+    /**
+     * @brief 選択中のセッションを取得
+     */
+    StationSession &currentSession() { return *this->m_session; }
+
+    /**
+     * @brief セッションの初期化
+     * @param session 初期化するセッション
+     * @param address 相手局アドレス
+     */
+    static void initSession(StationSession &session, uint8_t address);
+
+    /**
+     * @brief 選択中の局をRR（Pビット付き）でポーリング
+     *
+     * 応答がIフレームでN(S)がV(R)と一致する場合はV(R)を進め、
+     * フレームを受信キューに残す（readFrameで読み出す）。
+     * @param timeoutMs 応答待機タイムアウト時間（ミリ秒、0で responseTimeoutMs()）
+     * @return ポーリング結果
+     */
+    PollResult pollStation(uint32_t timeoutMs);
+
+    /**
+     * @brief 送受信フレームの記録先を設定
+     * @param logger 記録先（nullptrで記録しない）
+     */
+    void setFrameLogger(IFrameLogger *logger);
+
     /**
      * @brief CRC-16計算
      * @param data データ
@@ -116,6 +911,26 @@ public:
      */
     static uint16_t calculateCRC16(const uint8_t *data, size_t length);
 
+    /**
+     * @brief destuffBitsで出力バッファが不足した場合の戻り値
+     */
+    static const size_t DESTUFF_OVERFLOW = (size_t)-1;
+
+    /**
+     * @brief ビットデスタッフィング（フラグ間のビット列からバイト列を復元）
+     *
+     * 5個の連続する1の直後の0を取り除き、MSBファーストでバイトに詰める。
+     * 8ビットに満たない末尾のビットは捨てる。
+     * @param rawData 入力ビット列（MSBファースト）
+     * @param startBit 開始ビット位置
+     * @param bitCount 入力ビット数
+     * @param output 出力バッファ
+     * @param maxOutput 出力バッファサイズ
+     * @return 出力バイト数、バッファ不足の場合はDESTUFF_OVERFLOW
+     */
+    static size_t destuffBits(const uint8_t *rawData, size_t startBit, size_t bitCount,
+                              uint8_t *output, size_t maxOutput);
+
 private:
     // 受信コンテキスト構造体
     struct ReceiveContext
@@ -126,6 +941,12 @@ private:
         uint8_t rawData[MAX_FRAME_SIZE * 2]; ///< スタッフィング済みデータ用
         size_t rawBitIndex;                  ///< 生データビットインデックス
         bool frameComplete;                  ///< フレーム完了フラグ
+        uint8_t addressByte;                 ///< デスタッフィング済みアドレス（組み立て中）
+        uint8_t addressBitCount;             ///< アドレスの確定ビット数（8で判定済み）
+        uint8_t addressOnes;                 ///< アドレス部デスタッフィング用の連続1カウント
+        uint8_t lineOnes;                    ///< 回線上の連続1ビット数（255で飽和）
+        size_t stuffedBits;                  ///< フレーム中で除去されるスタッフィングビット数
+        bool frameDropped;                   ///< 受信途中のフレームを破棄した
     };
 
     // RS485物理層パラメータ
@@ -138,12 +959,77 @@ private:
     uint32_t m_bitTimeMicros;
     uint32_t m_halfBitTimeMicros;
     bool m_isTransmitting;
+    uint32_t m_settleMicros;     ///< DE有効化から最初のビットまでの待機時間
+    uint32_t m_turnaroundMicros; ///< DE解除から受信開始までの待機時間
+    bool m_driverTimingSet;      ///< 待機時間を明示的に設定済み
+    LineCoding m_lineCoding;
+    uint8_t m_txLevel; ///< NRZI送信中の回線レベル
+    uint8_t m_rxLevel; ///< 直前に標本化した回線レベル（NRZIの復号とエッジ同期に使う）
+    bool m_resumeAfterFlag;  ///< service()の受信がフラグの直後で戻った（次の呼び出しで続きを受信する）
+    uint32_t m_resumeMicros; ///< その次のビットの標本点の時刻
+
+    // 自動速度検出
+    bool m_autoBaud;
+    bool m_baudLocked;
+    uint8_t m_autoBaudFailures; ///< 速度確定後に連続した受信エラーの回数
+
+    // 通信速度の交渉
+    uint32_t m_maxBaudRate;
+    uint32_t m_baudCeiling;       ///< 維持できなかった速度（0は制限なし）
+    uint32_t m_fallbackBaudRate;  ///< 二次局の確認待ち中に戻す速度（0は確認済み）
+    uint32_t m_baudChangeMillis;  ///< 二次局が速度を切り替えた時刻
+    uint32_t m_tuneValidBase;     ///< 前回のtuneBaudRate時点のvalidFrames
+    uint32_t m_tuneErrorBase;     ///< 前回のtuneBaudRate時点のcrcErrors
+    uint8_t m_cleanTuneIntervals; ///< m_baudCeilingの設定後、CRC異常率が低かった区間数
+
+    // 非同期要求
+    enum RequestType
+    {
+        REQUEST_CONNECT, ///< SNRM/SNRME
+        REQUEST_I        ///< Iフレーム
+    };
+    struct AsyncRequest
+    {
+        RequestHandle handle;
+        RequestType type;
+        StationSession *session; ///< 要求時に選択されていたセッション
+        const uint8_t *data;     ///< 送信データ（呼び出し側が保持）
+        size_t length;
+        bool extended; ///< SNRMEを送る
+    };
+    enum AsyncState
+    {
+        ASYNC_IDLE,         ///< 要求の送信待ち
+        ASYNC_WAIT_RESPONSE ///< 先頭の要求の応答待ち
+    };
+    AsyncRequest m_requests[HDLC_ASYNC_QUEUE_SIZE];
+    size_t m_requestHead;
+    size_t m_requestCount;
+    RequestHandle m_nextHandle;
+    AsyncState m_asyncState;
+    uint32_t m_asyncStartMillis; ///< 応答待ちの開始時刻
+    uint32_t m_asyncSentMicros;  ///< 要求の送信完了時刻
+    uint32_t m_asyncTimeoutMs;   ///< 応答待ちのタイムアウト時間
+    CompletionCallback m_completionCallback;
+    void *m_completionContext;
+    uint8_t m_preambleFlags;
+
+    // 受信通知（受信処理が書き込み、service()が読み出す単一生産者・単一消費者のリング）
+    struct ReceiveSlot
+    {
+        uint8_t data[MAX_FRAME_SIZE];
+        size_t length;
+        bool valid;
+    };
+    ReceiveSlot m_receiveSlots[HDLC_RX_QUEUE_SLOTS];
+    volatile uint8_t m_receiveHead; ///< 書き込んだスロット数（桁あふれで巡回）
+    volatile uint8_t m_receiveTail; ///< 通知したスロット数
+    FrameReceivedCallback m_receiveCallback;
 
     // HDLC状態
     bool m_initialized;
-    uint8_t m_targetAddress;   ///< 送信先アドレス
-    uint8_t m_sendSequence;    ///< 送信シーケンス番号（0-7）
-    uint8_t m_receiveSequence; ///< 受信シーケンス番号（0-7）
+    StationSession m_defaultSession; ///< 単一局で使う既定のセッション
+    StationSession *m_session;       ///< 選択中のセッション
 
     uint8_t m_receiveBuffer[MAX_FRAME_SIZE];
     size_t m_receiveIndex;
@@ -151,6 +1037,35 @@ private:
     uint8_t m_bitCount;
     uint8_t m_consecutiveOnes; ///< 連続する1ビットのカウント（デスタッフィング用）
 
+    IFrameLogger *m_frameLogger; ///< 送受信フレームの記録先
+    IConfigStorage *m_configStorage; ///< リンク設定の保存先
+    IByteStream *m_byteStream;       ///< 非同期フレーミングの送受信先（nullptrはビット同期）
+    size_t m_octetLength;            ///< 非同期フレーミングで受信中のフレーム長
+    bool m_octetEscape;              ///< 直前に0x7Dを受信した
+    bool m_octetDiscard;             ///< 次のフラグまで読み捨てる
+    Role m_role;                 ///< 局の役割
+    uint32_t m_responseTimeoutMs;
+    bool m_adaptiveTimeout;
+
+    // 受信アドレスフィルタ（256ビットの受理表）
+    bool m_addressFilterEnabled;
+    uint8_t m_acceptMap[32];
+    ReceiveStatistics m_receiveStatistics;
+
+    // 二次局の事前作成済み応答フレーム（アドレス + コントロール + CRC）
+    static const size_t RESPONSE_FRAME_SIZE = 4;
+    uint8_t m_uaResponse[RESPONSE_FRAME_SIZE];
+    uint8_t m_rrResponses[8][RESPONSE_FRAME_SIZE];  ///< N(R)毎のRR(F=1)
+    uint8_t m_rejResponses[8][RESPONSE_FRAME_SIZE]; ///< N(R)毎のREJ(F=1)
+
+    // ウィンドウ制御と拡張モード
+    uint8_t m_windowSize;
+    bool m_extendedRequested;
+
+    // 二次局の送信待ちデータ（一次局のN(R)で確認されるまで保持）
+    uint8_t m_pendingData[MAX_FRAME_SIZE];
+    size_t m_pendingLength;
+
     // 事前計算された待機時間
     uint32_t m_shortDelayMicros; ///< フラグ検出時の短い待機時間（1/8ビット時間）
 
@@ -169,6 +1084,29 @@ private:
      */
     void _enableTransmit();
 
+    /**
+     * @brief 応答フレームの受信結果を応答遅延の推定に反映
+     * @param sentMicros 送信完了時刻
+     * @param received true 応答を受信した, false タイムアウト
+     */
+    void _recordResponseTime(uint32_t sentMicros, bool received);
+
+    /**
+     * @brief フレームの送信所要時間（フラグ2つを含む、スタッフィングは含まない）
+     * @param length フレーム長（CRCを含む）
+     * @return マイクロ秒
+     */
+    uint32_t _airtimeMicros(size_t length) const { return (uint32_t)((length + 2) * 8) * this->m_bitTimeMicros; }
+
+    /**
+     * @brief 受信出力が指定レベルになるまで待機
+     * @param level 待つレベル
+     * @param limitMicros 最大待機時間
+     * @param elapsedMicros 経過時間（出力）
+     * @return true 到達, false タイムアウト
+     */
+    bool _waitForLevel(uint8_t level, uint32_t limitMicros, uint32_t &elapsedMicros);
+
     /**
      * @brief 受信モードに切り替え
      */
@@ -194,11 +1132,17 @@ private:
     void _transmitByteWithStuffing(uint8_t byte, uint8_t &consecutiveOnes);
 
     /**
-     * @brief 1ビット受信
+     * @brief 1ビット受信（NRZIでは直前の標本とのレベル比較で復号）
      * @return 受信ビット
      */
     uint8_t _readBit();
 
+    /**
+     * @brief 回線レベルの読み取り（符号化方式によらない）
+     * @return 回線レベル
+     */
+    uint8_t _readLevel();
+
     /**
      * @brief ビット時間待機
      */
@@ -215,6 +1159,14 @@ private:
      */
     void _waitBitTime(uint32_t elapsedMicros);
 
+    /**
+     * @brief エッジに同期したビット時間待機（NRZI受信用）
+     *
+     * 待機中に回線を監視し、エッジを検出したらその半ビット後を次の標本点にする。
+     * @param bitStartTime 直前の標本化の時刻（マイクロ秒）
+     */
+    void _waitBitTimeWithResync(uint32_t bitStartTime);
+
     // HDLCプロトコルメソッド
     /**
      * @brief 生フレーム送信（内部用）
@@ -224,6 +1176,29 @@ private:
      */
     bool _transmitFrame(const uint8_t *data, size_t length);
 
+    /**
+     * @brief 複数フレームを1回の送信区間で連続送信（内部用）
+     *
+     * DEは1回だけ有効にし、フレーム間は1つのフラグを前のフレームの終了と
+     * 次のフレームの開始に共有する。
+     * @param frames 送信フレームを連結したデータ
+     * @param lengths 各フレームの長さ
+     * @param count フレーム数
+     * @return true 成功, false 失敗
+     */
+    bool _transmitFrames(const uint8_t *frames, const size_t *lengths, size_t count);
+
+    /**
+     * @brief 複数フレームをバイトストリームへ送信（非同期フレーミング）
+     *
+     * _transmitFramesと同じく、フレーム間のフラグは1つを共有する。
+     * @param frames 送信フレームを連結したデータ
+     * @param lengths 各フレームの長さ
+     * @param count フレーム数
+     * @return true 成功, false 失敗
+     */
+    bool _transmitOctetFrames(const uint8_t *frames, const size_t *lengths, size_t count);
+
     /**
      * @brief HDLCフレームの作成
      * @param address アドレス
@@ -238,6 +1213,68 @@ private:
                             const uint8_t *info, size_t infoLength,
                             uint8_t *frameBuffer, size_t maxLength);
 
+    /**
+     * @brief HDLCフレームの作成（複数バイトのコントロールフィールド）
+     * @param address アドレス
+     * @param control コントロールフィールド
+     * @param controlLength コントロールフィールド長
+     * @param info 情報フィールド
+     * @param infoLength 情報フィールド長
+     * @param frameBuffer 出力バッファ
+     * @param maxLength 最大長
+     * @return フレーム長
+     */
+    size_t _createHDLCFrame(uint8_t address, const uint8_t *control, size_t controlLength,
+                            const uint8_t *info, size_t infoLength,
+                            uint8_t *frameBuffer, size_t maxLength);
+
+    /**
+     * @brief 選択中のセッションのI/S形式フレームを作成
+     * @param command CMD_I/CMD_RR/CMD_REJ
+     * @param sendSequence N(S)（I形式のみ）
+     * @param pollFinal P/Fビット
+     * @param info 情報フィールド
+     * @param infoLength 情報フィールド長
+     * @param frameBuffer 出力バッファ
+     * @param maxLength 最大長
+     * @return フレーム長（0は失敗）
+     */
+    size_t _createSequencedFrame(uint8_t command, uint8_t sendSequence, bool pollFinal,
+                                 const uint8_t *info, size_t infoLength,
+                                 uint8_t *frameBuffer, size_t maxLength);
+
+    /**
+     * @brief 受信フレームのコントロールフィールドを解析
+     * @param frame フレーム（アドレスから）
+     * @param length フレーム長
+     * @param control 解析結果（出力）
+     * @return true 成功, false 長さ不足
+     */
+    bool _parseControl(const uint8_t *frame, size_t length, ControlField &control) const;
+
+    /**
+     * @brief 選択中のセッションが拡張モードか
+     */
+    bool _isExtended() const
+    {
+#if HDLC_ENABLE_EXTENDED_MODE
+        return this->m_session->extendedMode;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief シーケンス番号のマスク（モジュロ8: 0x07, 拡張モード: 0x7F）
+     */
+    uint8_t _sequenceMask() const { return this->_isExtended() ? 0x7F : 0x07; }
+
+    /**
+     * @brief 二次局のRR/REJ応答（F=1, N(R)=V(R)）を送信
+     * @param reject true REJ, false RR
+     */
+    void _transmitSupervisoryResponse(bool reject);
+
     /**
      * @brief 受信ビットの処理
      * @param bit 受信したビット
@@ -250,6 +1287,117 @@ private:
     void _processReceivedFrame();
 
     // 受信フレーム処理の分割メソッド
+    /**
+     * @brief フレーム受信の本体（receiveFrameWithBitControlから呼ぶ）
+     * @param timeoutMs タイムアウト時間（ミリ秒）
+     * @return true フレーム受信成功, false タイムアウトまたはエラー
+     */
+    bool _receiveFrame(uint32_t timeoutMs);
+
+    /**
+     * @brief ビット毎の受信ループ
+     *
+     * タイムアウトまで、受信途中のフレームがあれば完了まで（最大長のフレームの送信時間まで）受信を続ける。
+     * @param context 受信コンテキスト
+     * @param timeoutMs タイムアウト時間（ミリ秒）
+     * @param startedFrame true 開始したフレームの受信（開始フラグの後のオクテットまで待つ）。
+     *                     受信中のコンテキストを渡すと、前回の標本点の間隔で続きを受信する
+     * @return true フレーム受信成功, false タイムアウトまたはエラー
+     */
+    bool _receiveBits(ReceiveContext &context, uint32_t timeoutMs, bool startedFrame);
+
+    /**
+     * @brief 受信済みの応答でUAを確認し、リンクを確立
+     * @param extended SNRMEへの応答か
+     * @return true UA受信, false それ以外
+     */
+    bool _handleUAResponse(bool extended);
+
+    /**
+     * @brief 受信済みのIフレームへの応答（RR/REJ/I）を処理
+     * @return 確認されればREQUEST_COMPLETED、REJはREQUEST_REJECTED
+     */
+    RequestStatus _handleIResponse();
+
+    /**
+     * @brief 非同期要求のフレームを送信し、応答待ちに移る
+     * @param request 要求
+     * @return true 送信した, false 失敗
+     */
+    bool _startRequest(const AsyncRequest &request);
+
+    /**
+     * @brief 回線上で開始したフレームを受信（service()から呼ぶ）
+     *
+     * 受信出力が0になった時点で呼び、ビット中央から受信する。フラグしか来ない、
+     * 0のまま、またはアイドルに戻った場合は数オクテット分で戻る（ブロックしない）。
+     * フラグの直後で戻った場合は、次の呼び出しで_receiveAfterFlag()が続きを受信する。
+     * @return true フレーム受信成功, false フレームが無かった、または受信エラー
+     */
+    bool _receiveStartedFrame();
+
+    /**
+     * @brief フラグの直後で戻った受信の続きを受信（service()から呼ぶ）
+     *
+     * フラグフィルの後のフレームを取りこぼさないよう、前回の標本点の間隔のまま続ける。
+     * @return true フレーム受信成功, false フレームが無かった、または受信エラー
+     */
+    bool _receiveAfterFlag();
+
+    /**
+     * @brief 届いているフレームを受信（service()から呼ぶ）
+     *
+     * ビット同期では回線が0ならフレームの終わりまで受信する。
+     * 非同期フレーミングではストリームに届いているバイトだけを処理する。
+     * @return true フレーム受信成功
+     */
+    bool _receiveAvailableFrame();
+
+    /**
+     * @brief ストリームに届いているバイトを処理（非同期フレーミング）
+     *
+     * 受信途中のフレームは次の呼び出しに持ち越す。
+     * @return true 有効なフレームを受信した（残りのバイトは次の呼び出しで処理）
+     */
+    bool _pollByteStream();
+
+    /**
+     * @brief 受信した1オクテットの処理（非同期フレーミング）
+     * @param byte 受信バイト
+     * @return true 有効なフレームを受信した
+     */
+    bool _processReceivedOctet(uint8_t byte);
+
+    /**
+     * @brief 非同期フレーミングの受信状態を初期化
+     */
+    void _resetOctetReceiver();
+
+    /**
+     * @brief 二次局として受信済みのフレームを処理して応答
+     * @return true Iフレームを受理した, false それ以外
+     */
+    bool _handleSecondaryFrame();
+
+    /**
+     * @brief 受信フレームを通知用のスロットへコピー
+     * @param frame フレーム（CRCを除く）
+     * @param length フレーム長
+     * @param valid CRCチェックの結果
+     */
+    void _queueReceivedFrame(const uint8_t *frame, size_t length, bool valid);
+
+    /**
+     * @brief 受信スロットのフレームをコールバックへ通知
+     */
+    void _dispatchReceivedFrames();
+
+    /**
+     * @brief 先頭の非同期要求を完了して通知
+     * @param status 結果
+     */
+    void _completeRequest(RequestStatus status);
+
     /**
      * @brief 受信状態の初期化
      */
@@ -294,6 +1442,16 @@ private:
      */
     void _startFrame(ReceiveContext &context);
 
+    /**
+     * @brief 開始フラグの後にフレームのデータを受信し始めたか
+     *
+     * フラグの後に保存されるのは次のフラグの先頭7ビットまでのため、
+     * 1オクテット以上保存していればフラグの連続（フラグフィル）ではない。
+     * @param context 受信コンテキスト
+     * @return true データ受信中, false フラグ探索中または開始フラグの直後
+     */
+    bool _hasFrameData(const ReceiveContext &context) const;
+
     /**
      * @brief フレーム終了処理
      * @param context 受信コンテキスト
@@ -307,6 +1465,20 @@ private:
      */
     void _storeBitInFrame(uint8_t bit, ReceiveContext &context);
 
+    /**
+     * @brief アドレスバイトの組み立てとフィルタ判定
+     * @param bit 受信ビット
+     * @param context 受信コンテキスト
+     * @return true 受信継続, false 他局宛てとして破棄した
+     */
+    bool _filterAddressBit(uint8_t bit, ReceiveContext &context);
+
+    /**
+     * @brief 受信途中のフレームを破棄してフラグ探索に戻る
+     * @param context 受信コンテキスト
+     */
+    void _dropFrame(ReceiveContext &context);
+
     /**
      * @brief 完了フレームの処理
      * @param rawData 生データ
@@ -315,6 +1487,13 @@ private:
      */
     bool _processCompleteFrame(const uint8_t *rawData, size_t rawBitCount);
 
+    /**
+     * @brief m_receiveBufferに受信したフレームの検査と保存（ビット同期・非同期で共通）
+     * @param frameLength フレーム長（CRCを含む）
+     * @return true 有効フレーム, false 無効フレーム
+     */
+    bool _acceptReceivedFrame(size_t frameLength);
+
     /**
      * @brief フレームCRCの検証
      * @param frameLength フレーム長
@@ -344,11 +1523,94 @@ private:
     bool _isREJFrame(uint8_t control);
 
     /**
-     * @brief レスポンスフレームからシーケンス番号を抽出
-     * @param control コントロールフィールド
-     * @return シーケンス番号（0-7）
+     * @brief 受信したN(R)で送信済みIフレームを確認
+     *
+     * N(R)-1までの未確認フレームをまとめて確認済みにする。
+     * @param receiveSequence 相手局のN(R)
+     * @return true 未確認のIフレームが1つ以上確認された, false それ以外
+     */
+    bool _acknowledge(uint8_t receiveSequence);
+
+    /**
+     * @brief 二次局の送信待ちデータをIフレーム（F=1）で送信
+     */
+    void _transmitPendingResponse();
+
+    /**
+     * @brief 二次局の応答フレームを事前作成
+     */
+    void _precomputeResponses();
+
+    /**
+     * @brief XIDで圧縮パラメータを含めない場合の値
+     */
+    static const uint8_t XID_COMPRESSION_ABSENT = 0xFF;
+
+    /**
+     * @brief XID情報フィールドを作成
+     * @param baudRate 通信速度（bps、0の場合は含めない）
+     * @param compression 圧縮パラメータ（XID_COMPRESSION_ABSENTの場合は含めない）
+     * @param info 出力バッファ
+     * @param maxLength 最大長
+     * @return 情報フィールド長（0はバッファ不足）
+     */
+    static size_t _buildXidInfo(uint32_t baudRate, uint8_t compression, uint8_t *info, size_t maxLength);
+
+    /**
+     * @brief XID情報フィールドからパラメータを探す
+     * @param info 情報フィールド
+     * @param length 情報フィールド長
+     * @param parameter パラメータ識別子
+     * @param value 値の先頭（出力）
+     * @param valueLength 値の長さ（出力）
+     * @return true 見つかった, false 形式不正またはパラメータなし
+     */
+    static bool _findXidParameter(const uint8_t *info, size_t length, uint8_t parameter,
+                                  const uint8_t *&value, uint8_t &valueLength);
+
+    /**
+     * @brief XIDで応答を受け取る（一次局）
+     * @param info 送信するXID情報フィールド
+     * @param length 情報フィールド長
+     * @return true XID(F)を受信した（情報フィールドはm_frameQueueに残る）
+     */
+    bool _exchangeXid(const uint8_t *info, size_t length);
+
+    /**
+     * @brief XID情報フィールドから通信速度を取り出す
+     * @param info 情報フィールド
+     * @param length 情報フィールド長
+     * @param baudRate 通信速度（出力）
+     * @return true 取得できた, false 形式不正またはパラメータなし
+     */
+    static bool _parseXidBaudRate(const uint8_t *info, size_t length, uint32_t &baudRate);
+
+    /**
+     * @brief 受信したIフレームの情報フィールドを伸長（受信バッファ内で置き換える）
+     * @param frameLength CRCを含むフレーム長
+     * @return CRCを含む伸長後のフレーム長（伸長できない場合は0）
+     */
+    size_t _decompressReceivedFrame(size_t frameLength);
+
+    /**
+     * @brief 二次局のXID応答（受理した速度・圧縮を返してから切り替える）
+     * @param info 受信したXIDの情報フィールド
+     * @param length 情報フィールド長
+     */
+    void _answerXid(const uint8_t *info, size_t length);
+
+    /**
+     * @brief TEST(P)を送り、同じ情報フィールドの折り返しを確認
+     * @param attempts 試行回数
+     * @return true 折り返しを受信した, false 応答なしまたは不一致
+     */
+    bool _verifyLinkWithTest(uint8_t attempts);
+
+    /**
+     * @brief 二次局の速度切り替えが確認されないまま期限を過ぎていれば元に戻す
+     * @return 期限までの残り時間（ミリ秒、確認待ちでなければ0xFFFFFFFF）
      */
-    uint8_t _extractSequenceNumber(uint8_t control);
+    uint32_t _checkBaudFallback();
 };
 
 #endif // HDLC_H
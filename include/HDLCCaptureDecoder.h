@@ -0,0 +1,106 @@
+#ifndef HDLC_CAPTURE_DECODER_H
+#define HDLC_CAPTURE_DECODER_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief キャプチャ済みビット列のオフライン並列デコーダ（ネイティブ専用）
+ *
+ * 1ビット/ビット時間でサンプリングしMSBファーストで詰めたビット列から
+ * フラグ（0x7E）を探し、フラグ間の区間を独立したフレームとして
+ * スレッドプール上でデスタッフィング・CRC検証する。
+ * ビットスタッフィングによりフレーム内に6個連続の1は現れないため、
+ * フラグ探索は区間を分割して並列に行える。
+ * 結果はキャプチャ内の順序でフレームインデックスとして返す。
+ */
+class HDLCCaptureDecoder
+{
+public:
+    /**
+     * @brief フレームの判定結果
+     */
+    enum FrameStatus
+    {
+        FRAME_OK,        ///< CRC正常
+        FRAME_CRC_ERROR, ///< CRC異常
+        FRAME_ABORTED,   ///< 7個以上連続する1（アボート）を含む
+        FRAME_TOO_SHORT, ///< アドレス+CRCに満たない
+        FRAME_TOO_LONG   ///< 最大フレームサイズ超過
+    };
+
+    /**
+     * @brief フレームインデックスの1エントリ
+     */
+    struct FrameRecord
+    {
+        uint64_t bitOffset;        ///< 開始フラグ直後のビット位置
+        uint64_t bitLength;        ///< スタッフィング済みのビット数（終了フラグを除く）
+        FrameStatus status;        ///< 判定結果
+        std::vector<uint8_t> data; ///< デスタッフィング後のデータ（CRCを除く）
+    };
+
+    /**
+     * @brief デコード結果の集計
+     */
+    struct Summary
+    {
+        uint64_t flags;       ///< 検出したフラグ数
+        uint64_t frames;      ///< インデックスに載せたフレーム数
+        uint64_t validFrames; ///< CRC正常のフレーム数
+        uint64_t crcErrors;   ///< CRC異常のフレーム数
+        uint64_t aborted;     ///< アボートされたフレーム数
+        uint64_t idleSpans;   ///< アイドル（全て1）のため除外した区間数
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param threads ワーカースレッド数（0の場合はハードウェアスレッド数）
+     */
+    explicit HDLCCaptureDecoder(unsigned threads = 0);
+
+    /**
+     * @brief 最大フレームサイズの設定（CRCを含むバイト数、既定4096）
+     */
+    void setMaxFrameSize(size_t maxFrameSize) { this->m_maxFrameSize = maxFrameSize; }
+
+    /**
+     * @brief キャプチャのデコード
+     * @param packed MSBファーストで詰めたビット列
+     * @param bitCount ビット数
+     * @return キャプチャ順のフレームインデックス
+     */
+    std::vector<FrameRecord> decode(const uint8_t *packed, uint64_t bitCount);
+
+    /**
+     * @brief 直前のdecode()の集計を取得
+     */
+    const Summary &getSummary() const { return this->m_summary; }
+
+    /**
+     * @brief 指定範囲のフラグ開始位置を列挙（単一スレッド）
+     * @param packed MSBファーストで詰めたビット列
+     * @param bitCount 全体のビット数
+     * @param firstByte 探索開始バイト
+     * @param lastByte 探索終了バイト（このバイトは含まない）
+     * @param positions 見つかったビット位置の追加先
+     */
+    static void findFlags(const uint8_t *packed, uint64_t bitCount,
+                          uint64_t firstByte, uint64_t lastByte,
+                          std::vector<uint64_t> &positions);
+
+private:
+    /**
+     * @brief 1区間のデスタッフィングとCRC検証
+     * @return true インデックスに載せる区間, false アイドル区間
+     */
+    bool _decodeSpan(const uint8_t *packed, uint64_t startBit, uint64_t endBit,
+                     FrameRecord &record, std::vector<uint8_t> &scratch) const;
+
+    unsigned m_threads;
+    size_t m_maxFrameSize;
+    Summary m_summary;
+};
+
+#endif // HDLC_CAPTURE_DECODER_H
@@ -0,0 +1,136 @@
+#ifndef HDLC_POLLER_H
+#define HDLC_POLLER_H
+
+#include "HDLC.h"
+
+/**
+ * @brief 管理できる二次局の最大数
+ */
+#ifndef HDLC_MAX_STATIONS
+#if defined(__AVR__)
+#define HDLC_MAX_STATIONS 8
+#else
+#define HDLC_MAX_STATIONS 32
+#endif
+#endif
+
+/**
+ * @brief 複数の二次局を巡回する一次局ポーリングスケジューラ
+ *
+ * 局毎にHDLC::StationSession（リンク状態、V(S)、V(R)、未確認フレーム数、
+ * 最終応答時刻）を保持し、重み付きラウンドロビンで局を選んでポーリングする。
+ * 未接続の局にはSNRMを送り、接続済みの局はRR(P)でポーリングする。
+ * 1回のポーリングで更新されるのは選んだ局のセッションだけである。
+ * 局の領域は削除されるまで移動しないので、findStation()のポインタや
+ * selectSession()・非同期要求に渡したセッションは局を削除するまで有効である。
+ */
+class HDLCPoller
+{
+public:
+    /**
+     * @brief 1局分の管理情報
+     */
+    struct Station
+    {
+        HDLC::StationSession session; ///< プロトコル状態
+        uint8_t weight;               ///< ポーリング重み（0で巡回対象外）
+        int16_t currentWeight;        ///< 重み付きラウンドロビンの累積値
+        uint8_t consecutiveFailures;  ///< 連続した無応答の回数
+        bool active;                  ///< 登録中（falseの領域は空き）
+    };
+
+    /**
+     * @brief 連続無応答でリンクを切断扱いにする回数
+     */
+    static const uint8_t MAX_CONSECUTIVE_FAILURES = 3;
+
+    /**
+     * @brief コンストラクタ
+     * @param hdlc ポーリングに使うHDLCインスタンス
+     */
+    explicit HDLCPoller(HDLC &hdlc);
+
+    /**
+     * @brief 局の追加
+     * @param address 局アドレス
+     * @param weight ポーリング重み（大きいほど頻繁にポーリング）
+     * @return true 成功, false 登録数上限または重複
+     */
+    bool addStation(uint8_t address, uint8_t weight = 1);
+
+    /**
+     * @brief 局の削除
+     *
+     * 他の局の領域は移動しない。削除した局へのポインタは無効になるので、
+     * セッションを選択中または非同期要求が未完了の局は削除しない。
+     * @param address 局アドレス
+     * @return true 成功, false 未登録、選択中または要求が未完了
+     */
+    bool removeStation(uint8_t address);
+
+    /**
+     * @brief ポーリング重みの変更
+     * @param address 局アドレス
+     * @param weight ポーリング重み（0で巡回対象外）
+     * @return true 成功, false 未登録
+     */
+    bool setPollWeight(uint8_t address, uint8_t weight);
+
+    /**
+     * @brief 局の管理情報を取得
+     * @param address 局アドレス
+     * @return 管理情報（未登録の場合はnullptr）
+     */
+    Station *findStation(uint8_t address);
+
+    /**
+     * @brief 登録局数
+     */
+    size_t stationCount() const { return this->m_stationCount; }
+
+    /**
+     * @brief ポーリング応答のタイムアウト時間を設定
+     *
+     * 既定の0は局毎に測定した応答遅延によるタイムアウト（HDLC::responseTimeoutMs）。
+     */
+    void setPollTimeout(uint32_t timeoutMs) { this->m_pollTimeoutMs = timeoutMs; }
+
+    /**
+     * @brief 次の局を選んで1回ポーリング
+     *
+     * POLL_DATAの場合、受信したIフレームはHDLC::readFrameで読み出せる。
+     * @param polledAddress ポーリングした局アドレス（出力、省略可）
+     * @return ポーリング結果（対象局が無い場合はPOLL_NO_RESPONSE）
+     */
+    HDLC::PollResult pollNext(uint8_t *polledAddress = nullptr);
+
+    /**
+     * @brief 指定局へIフレームを送信
+     *
+     * 未接続の局にはまずSNRMを送る。他の局のセッションは変更しない。
+     * @param address 局アドレス
+     * @param data 送信データ
+     * @param length データ長
+     * @return true 成功, false 失敗
+     */
+    bool sendTo(uint8_t address, const uint8_t *data, size_t length);
+
+private:
+    /**
+     * @brief 重み付きラウンドロビンで次の局を選ぶ
+     * @return 局（対象が無い場合はnullptr）
+     */
+    Station *_selectNext();
+
+    /**
+     * @brief 応答結果を局の状態へ反映
+     */
+    void _recordResult(Station &station, bool responded);
+
+    HDLC &m_hdlc;
+    Station m_stations[HDLC_MAX_STATIONS];
+    size_t m_stationCount;
+    uint32_t m_pollTimeoutMs;
+};
+
+#endif // HDLC_POLLER_H
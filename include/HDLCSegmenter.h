@@ -0,0 +1,176 @@
+#ifndef HDLC_SEGMENTER_H
+#define HDLC_SEGMENTER_H
+
+#include "HDLC.h"
+
+/**
+ * @brief sendMessageが1回のsendIFramesで送る断片数
+ *
+ * 断片用の一時バッファ（(この数+1)×断片長）は関数内でスタックに置く。
+ */
+#ifndef HDLC_SEGMENT_BATCH
+#if defined(__AVR__)
+#define HDLC_SEGMENT_BATCH 2
+#else
+#define HDLC_SEGMENT_BATCH 7
+#endif
+#endif
+
+/**
+ * @brief 1フレームに入らないメッセージの分割送信と再組み立て
+ *
+ * メッセージを断片に分け、各Iフレームの情報フィールドの先頭に1バイトの
+ * 断片ヘッダ（FIRST/MOREフラグ + 6ビットの断片番号）を付けて送る。
+ * 順序と再送はHDLCのN(S)/N(R)が保証するため、断片番号は欠落の検出だけに使う。
+ *
+ * 送信はsendIFramesでウィンドウ単位にまとめて送る（一次局）。
+ * 受信したIフレームはprocessFrame()へ渡し、呼び出し側のバッファへの
+ * 再組み立て（setMessageBuffer）か、断片毎の逐次通知（setMessageSink）を選ぶ。
+ */
+class HDLCSegmenter
+{
+public:
+    /**
+     * @brief 断片ヘッダのフラグ
+     */
+    enum FragmentFlag
+    {
+        FRAGMENT_FIRST = 0x80, ///< メッセージの先頭の断片
+        FRAGMENT_MORE = 0x40,  ///< 後続の断片がある
+        FRAGMENT_INDEX_MASK = 0x3F
+    };
+
+    /**
+     * @brief 1断片のデータ長
+     *
+     * アドレス + コントロール(最大2) + 圧縮方式(1、圧縮時) + 断片ヘッダ + CRC(2) を除く。
+     */
+    static const size_t MAX_FRAGMENT_DATA = HDLC::MAX_FRAME_SIZE - 7;
+
+    /**
+     * @brief 送信データを順に取り出すコールバック
+     * @param buffer 書き込み先
+     * @param maxLength 書き込める最大長
+     * @param context sendMessageで渡した値
+     * @return 書き込んだ長さ（0でメッセージの終わり）
+     */
+    typedef size_t (*MessageSource)(uint8_t *buffer, size_t maxLength, void *context);
+
+    /**
+     * @brief 再組み立てを終えたメッセージの通知
+     * @param message メッセージ（setMessageBufferのバッファ）
+     * @param length メッセージ長
+     * @param context setMessageBufferで渡した値
+     */
+    typedef void (*MessageCallback)(const uint8_t *message, size_t length, void *context);
+
+    /**
+     * @brief 受信した断片の逐次通知
+     * @param data 断片のデータ（呼び出し中のみ有効）
+     * @param length データ長
+     * @param offset メッセージ内の位置
+     * @param last true メッセージの最後の断片
+     * @param context setMessageSinkで渡した値
+     */
+    typedef void (*MessageSink)(const uint8_t *data, size_t length, size_t offset, bool last, void *context);
+
+    /**
+     * @brief コンストラクタ
+     * @param hdlc 送受信に使うHDLCインスタンス
+     */
+    explicit HDLCSegmenter(HDLC &hdlc);
+
+    /**
+     * @brief バッファのメッセージを分割して送信
+     *
+     * 未接続の場合はまずSNRMを送る。
+     * @param data メッセージ
+     * @param length メッセージ長（1以上）
+     * @return true 全ての断片が確認された, false 失敗
+     */
+    bool sendMessage(const uint8_t *data, size_t length);
+
+    /**
+     * @brief コールバックから取り出したメッセージを分割して送信
+     *
+     * 最後の断片を判定するため、送信中の断片の1つ先まで取り出す。
+     * @param source 送信データの取り出し元
+     * @param context sourceへ渡す値
+     * @return true 全ての断片が確認された, false 失敗（空のメッセージを含む）
+     */
+    bool sendMessage(MessageSource source, void *context);
+
+    /**
+     * @brief 再組み立て先のバッファを設定
+     * @param buffer 再組み立て先（nullptrで解除）
+     * @param size バッファサイズ（超えるメッセージは破棄）
+     * @param callback メッセージ完成時の通知先
+     * @param context callbackへ渡す値
+     */
+    void setMessageBuffer(uint8_t *buffer, size_t size, MessageCallback callback, void *context = nullptr);
+
+    /**
+     * @brief 断片を逐次受け取る通知先を設定（設定中は再組み立てバッファを使わない）
+     * @param sink 通知先（nullptrで解除）
+     * @param context sinkへ渡す値
+     */
+    void setMessageSink(MessageSink sink, void *context = nullptr);
+
+    /**
+     * @brief 受信フレームの処理
+     *
+     * HDLC::readFrameや受信コールバックで得たフレーム（アドレスからCRC前まで）を渡す。
+     * Iフレーム以外は無視する。
+     * @param frame フレーム
+     * @param length フレーム長
+     * @return true メッセージの最後の断片を受け取った
+     */
+    bool processFrame(const uint8_t *frame, size_t length);
+
+    /**
+     * @brief 断片の欠落・順序異常・バッファ超過で破棄したメッセージ数
+     */
+    uint32_t droppedMessages() const { return this->m_droppedMessages; }
+
+private:
+    /**
+     * @brief 断片の一時バッファ（断片ヘッダ + データ）
+     */
+    struct Fragment
+    {
+        uint8_t data[1 + MAX_FRAGMENT_DATA];
+        size_t length; ///< データ長（断片ヘッダを除く）
+    };
+
+    /**
+     * @brief 断片をまとめて送信
+     * @param fragments 断片（断片ヘッダは未設定）
+     * @param count 断片数
+     * @param first true 先頭の断片がメッセージの先頭
+     * @param last true 末尾の断片がメッセージの最後
+     * @return true 全て確認された
+     */
+    bool _sendFragments(Fragment *fragments, size_t count, bool first, bool last);
+
+    /**
+     * @brief 受信中のメッセージを破棄
+     */
+    void _dropMessage();
+
+    HDLC &m_hdlc;
+    uint8_t m_sendIndex; ///< 次に送る断片番号
+
+    uint8_t *m_messageBuffer;
+    size_t m_messageBufferSize;
+    MessageCallback m_messageCallback;
+    void *m_messageContext;
+    MessageSink m_messageSink;
+    void *m_sinkContext;
+
+    bool m_receiving;        ///< メッセージの途中
+    uint8_t m_receiveIndex;  ///< 次に受け取る断片番号
+    size_t m_receivedLength; ///< 受信済みのメッセージ長
+    uint32_t m_droppedMessages;
+};
+
+#endif // HDLC_SEGMENTER_H
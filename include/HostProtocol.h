@@ -0,0 +1,149 @@
+#ifndef HOST_PROTOCOL_H
+#define HOST_PROTOCOL_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief ホストパケットの最大ペイロード長（長さフィールドが1バイトのため255以下）
+ */
+#ifndef HOST_MAX_PAYLOAD
+#if defined(__AVR__)
+#define HOST_MAX_PAYLOAD 64
+#else
+#define HOST_MAX_PAYLOAD 255
+#endif
+#endif
+
+/**
+ * @brief ホスト（PC）とのバイナリパケットプロトコル
+ *
+ * パケットは 種別(1) + シーケンス番号(1) + ペイロード長(1) + ペイロード + CRC-16(2, ビッグエンディアン)
+ * をCOBSで符号化し、区切りの0x00を付けて送る。0x00はパケット内に現れないため、
+ * 受信側は途中から読み始めても次の0x00で同期できる。
+ * CRCはHDLCのFCSと同じCRC-16-CCITT（HDLC::calculateCRC16）を使う。
+ *
+ * 符号化はencode()、復号はfeed()に1バイトずつ渡して行う（受信バッファはインスタンス内）。
+ */
+class HostProtocol
+{
+public:
+    /**
+     * @brief パケット種別（0x80以上はデバイスからホストへの通知）
+     */
+    enum PacketType
+    {
+        HOST_CMD_SEND_I = 0x01,    ///< ペイロードをIフレームで送信
+        HOST_CMD_STATUS = 0x02,    ///< 状態の問い合わせ
+        HOST_CMD_TEXT_MODE = 0x03, ///< テキストコンソールへ戻る
+        HOST_EVT_COMPLETED = 0x81, ///< 送信完了（ペイロード: HDLC::RequestStatus 1バイト）
+        HOST_EVT_FRAME = 0x82,     ///< 受信フレーム（ペイロード: CRC正常なら1 + フレーム）
+        HOST_EVT_STATUS = 0x83,    ///< 状態（ペイロード: 速度4バイトBE + アドレス + リンク状態 + 待ち要求数。速度の変更時はシーケンス0で通知）
+        HOST_EVT_ERROR = 0x84      ///< コマンドを受け付けられない（ペイロード: ErrorCode 1バイト）
+    };
+
+    /**
+     * @brief HOST_EVT_ERRORのエラーコード
+     */
+    enum ErrorCode
+    {
+        HOST_ERROR_UNKNOWN_COMMAND = 0x01, ///< 未知の種別
+        HOST_ERROR_BAD_LENGTH = 0x02       ///< ペイロードが空、またはIフレームに入らない
+    };
+
+    /**
+     * @brief パケットの区切りバイト
+     */
+    static const uint8_t DELIMITER = 0x00;
+
+    /**
+     * @brief ヘッダ長（種別 + シーケンス番号 + ペイロード長）
+     */
+    static const size_t HEADER_SIZE = 3;
+
+    /**
+     * @brief COBS符号化後の最大長（区切りを含む）
+     */
+    static const size_t MAX_ENCODED_SIZE = HEADER_SIZE + HOST_MAX_PAYLOAD + 2 + (HEADER_SIZE + HOST_MAX_PAYLOAD + 2) / 254 + 2;
+
+    /**
+     * @brief コンストラクタ
+     */
+    HostProtocol();
+
+    /**
+     * @brief パケットの符号化
+     * @param type 種別
+     * @param sequence シーケンス番号（応答は対応するコマンドの番号を返す）
+     * @param payload ペイロード（長さ0の場合はnullptr可）
+     * @param length ペイロード長
+     * @param out 出力先
+     * @param outSize 出力先サイズ（MAX_ENCODED_SIZEあれば常に足りる）
+     * @return 区切りを含む符号化後の長さ（ペイロード長超過・出力先不足の場合は0）
+     */
+    static size_t encode(uint8_t type, uint8_t sequence, const uint8_t *payload, size_t length,
+                         uint8_t *out, size_t outSize);
+
+    /**
+     * @brief 受信した1バイトを復号器へ渡す
+     * @param byte 受信バイト
+     * @return true 正しいパケットを受信した（packetType()等で参照、次のfeed()まで有効）
+     */
+    bool feed(uint8_t byte);
+
+    /**
+     * @brief 受信途中のパケットを破棄
+     */
+    void reset();
+
+    /**
+     * @brief 受信したパケットの種別
+     */
+    uint8_t packetType() const { return this->m_buffer[0]; }
+
+    /**
+     * @brief 受信したパケットのシーケンス番号
+     */
+    uint8_t packetSequence() const { return this->m_buffer[1]; }
+
+    /**
+     * @brief 受信したパケットのペイロード
+     */
+    const uint8_t *payload() const { return this->m_buffer + HEADER_SIZE; }
+
+    /**
+     * @brief 受信したパケットのペイロード長
+     */
+    size_t payloadLength() const { return this->m_buffer[2]; }
+
+    /**
+     * @brief CRC異常で破棄したパケット数
+     */
+    uint32_t crcErrors() const { return this->m_crcErrors; }
+
+    /**
+     * @brief 符号化・長さの異常で破棄したパケット数
+     */
+    uint32_t framingErrors() const { return this->m_framingErrors; }
+
+private:
+    /**
+     * @brief 区切りまでに受信したパケットの検証
+     * @return true 正しいパケット
+     */
+    bool _finishPacket();
+
+    uint8_t m_buffer[HEADER_SIZE + HOST_MAX_PAYLOAD + 2]; ///< COBS復号後のパケット
+    size_t m_length;      ///< 復号済みのバイト数
+    uint8_t m_blockCode;  ///< 受信中のCOBSブロックのコードバイト
+    uint8_t m_blockLeft;  ///< 受信中のCOBSブロックの残りバイト数
+    bool m_overflow;      ///< バッファ超過（区切りまで読み捨てる）
+    uint32_t m_crcErrors;
+    uint32_t m_framingErrors;
+};
+
+#endif // HOST_PROTOCOL_H
@@ -0,0 +1,92 @@
+#ifndef I_BYTE_SINK_H
+#define I_BYTE_SINK_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#include <cstdio>
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief バイト列の書き込み先インターフェース
+ *
+ * ネイティブ環境ではファイル、実機ではSDカードやシリアル等を差し替えて使う。
+ */
+class IByteSink
+{
+public:
+    virtual ~IByteSink() = default;
+
+    /**
+     * @brief バイト列の書き込み
+     * @param data 書き込むデータ
+     * @param length データ長
+     * @return 書き込めたバイト数（非ブロッキング実装では部分書き込みもあり得る）
+     */
+    virtual size_t write(const uint8_t *data, size_t length) = 0;
+};
+
+#ifdef NATIVE_TEST
+/**
+ * @brief ファイルへ書き込むバイトシンク（ネイティブ専用）
+ */
+class FileByteSink : public IByteSink
+{
+public:
+    FileByteSink() : m_file(nullptr) {}
+    ~FileByteSink() override { this->close(); }
+
+    /**
+     * @brief ファイルを開く
+     * @param path 出力先パス
+     * @return true 成功, false 失敗
+     */
+    bool open(const char *path)
+    {
+        this->close();
+        this->m_file = fopen(path, "wb");
+        return this->m_file != nullptr;
+    }
+
+    /**
+     * @brief ファイルを閉じる
+     */
+    void close()
+    {
+        if (this->m_file)
+        {
+            fclose(this->m_file);
+            this->m_file = nullptr;
+        }
+    }
+
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        return this->m_file ? fwrite(data, 1, length, this->m_file) : 0;
+    }
+
+private:
+    FILE *m_file;
+};
+#else
+/**
+ * @brief ArduinoのPrint（Serial、SDのFile等）へ書き込むバイトシンク
+ */
+class PrintByteSink : public IByteSink
+{
+public:
+    explicit PrintByteSink(Print &output) : m_output(output) {}
+
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        return this->m_output.write(data, length);
+    }
+
+private:
+    Print &m_output;
+};
+#endif
+
+#endif // I_BYTE_SINK_H
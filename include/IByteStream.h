@@ -0,0 +1,307 @@
+#ifndef I_BYTE_STREAM_H
+#define I_BYTE_STREAM_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief 双方向のバイトストリームインターフェース
+ *
+ * 非同期（オクテット単位）HDLCの送受信に使う。実機ではUART（HardwareSerial）、
+ * ネイティブ環境では疑似端末やソケットペアを差し替えて使う。
+ */
+class IByteStream
+{
+public:
+    virtual ~IByteStream() = default;
+
+    /**
+     * @brief 待たずに読み出せるバイト数
+     */
+    virtual int available() = 0;
+
+    /**
+     * @brief 1バイト読み出し（ブロックしない）
+     * @return 読み出したバイト、無ければ-1
+     */
+    virtual int read() = 0;
+
+    /**
+     * @brief バイト列の書き込み
+     * @param data 書き込むデータ
+     * @param length データ長
+     * @return 書き込めたバイト数
+     */
+    virtual size_t write(const uint8_t *data, size_t length) = 0;
+
+    /**
+     * @brief 書き込んだバイトが回線へ送り出されるまで待つ（DE解除の前に呼ぶ）
+     */
+    virtual void flush() = 0;
+
+    /**
+     * @brief 通信速度の変更
+     * @param baudRate 通信速度（bps）
+     * @return true 成功, false 対応していない速度
+     */
+    virtual bool setBaudRate(uint32_t baudRate) = 0;
+};
+
+#ifdef NATIVE_TEST
+/**
+ * @brief ファイルディスクリプタ（シリアルデバイス、疑似端末、ソケット）のバイトストリーム（ネイティブ専用）
+ */
+class FdByteStream : public IByteStream
+{
+public:
+    FdByteStream() : m_fd(-1) {}
+    ~FdByteStream() override { this->close(); }
+
+    FdByteStream(const FdByteStream &) = delete;
+    FdByteStream &operator=(const FdByteStream &) = delete;
+
+    /**
+     * @brief シリアルデバイスを生の8ビットモードで開く
+     * @param path デバイスのパス（/dev/ttyUSB0、疑似端末のスレーブ等）
+     * @param baudRate 通信速度（bps）
+     * @return true 成功, false 失敗
+     */
+    bool open(const char *path, uint32_t baudRate)
+    {
+        this->close();
+        int fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0)
+        {
+            return false;
+        }
+        this->m_fd = fd;
+        if (!this->_makeRaw() || !this->setBaudRate(baudRate))
+        {
+            this->close();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 疑似端末を作成し、マスター側を開く
+     * @param slaveName スレーブ側のパスの書き込み先（open()で相手側として開く）
+     * @param size slaveNameのサイズ
+     * @return true 成功, false 失敗
+     */
+    bool openPty(char *slaveName, size_t size)
+    {
+        this->close();
+        int fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        this->m_fd = fd;
+        const char *name = nullptr;
+        if (grantpt(fd) != 0 || unlockpt(fd) != 0 || (name = ptsname(fd)) == nullptr ||
+            strlen(name) >= size || !this->_makeRaw() ||
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+        {
+            this->close();
+            return false;
+        }
+        strcpy(slaveName, name);
+        return true;
+    }
+
+    /**
+     * @brief 接続済みのソケットペアを作成
+     * @param a 一方の端
+     * @param b もう一方の端
+     * @return true 成功, false 失敗
+     */
+    static bool createPair(FdByteStream &a, FdByteStream &b)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            return false;
+        }
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+        a.close();
+        b.close();
+        a.m_fd = fds[0];
+        b.m_fd = fds[1];
+        return true;
+    }
+
+    /**
+     * @brief 閉じる
+     */
+    void close()
+    {
+        if (this->m_fd >= 0)
+        {
+            ::close(this->m_fd);
+            this->m_fd = -1;
+        }
+    }
+
+    /**
+     * @brief ファイルディスクリプタ（閉じていれば-1）
+     */
+    int fd() const { return this->m_fd; }
+
+    int available() override
+    {
+        int count = 0;
+        if (this->m_fd < 0 || ioctl(this->m_fd, FIONREAD, &count) != 0)
+        {
+            return 0;
+        }
+        return count;
+    }
+
+    int read() override
+    {
+        uint8_t byte;
+        if (this->m_fd < 0 || ::read(this->m_fd, &byte, 1) != 1)
+        {
+            return -1;
+        }
+        return byte;
+    }
+
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        size_t written = 0;
+        while (this->m_fd >= 0 && written < length)
+        {
+            ssize_t result = ::write(this->m_fd, data + written, length - written);
+            if (result > 0)
+            {
+                written += (size_t)result;
+                continue;
+            }
+            // 非ブロッキングのため、送信バッファが空くまで待つ
+            struct pollfd descriptor = {this->m_fd, POLLOUT, 0};
+            if (poll(&descriptor, 1, 1000) <= 0)
+            {
+                break;
+            }
+        }
+        return written;
+    }
+
+    void flush() override
+    {
+        if (this->m_fd >= 0 && isatty(this->m_fd))
+        {
+            tcdrain(this->m_fd);
+        }
+    }
+
+    bool setBaudRate(uint32_t baudRate) override
+    {
+        if (this->m_fd < 0)
+        {
+            return false;
+        }
+        if (!isatty(this->m_fd))
+        {
+            return true; // ソケットには速度が無い
+        }
+        speed_t speed;
+        switch (baudRate)
+        {
+        case 1200: speed = B1200; break;
+        case 2400: speed = B2400; break;
+        case 4800: speed = B4800; break;
+        case 9600: speed = B9600; break;
+        case 19200: speed = B19200; break;
+        case 38400: speed = B38400; break;
+        case 57600: speed = B57600; break;
+        case 115200: speed = B115200; break;
+        case 230400: speed = B230400; break;
+        default: return false;
+        }
+        struct termios attributes;
+        if (tcgetattr(this->m_fd, &attributes) != 0)
+        {
+            return false;
+        }
+        cfsetispeed(&attributes, speed);
+        cfsetospeed(&attributes, speed);
+        return tcsetattr(this->m_fd, TCSANOW, &attributes) == 0;
+    }
+
+private:
+    /**
+     * @brief 改行変換・エコー等を無効にする
+     */
+    bool _makeRaw()
+    {
+        struct termios attributes;
+        if (tcgetattr(this->m_fd, &attributes) != 0)
+        {
+            return false;
+        }
+        cfmakeraw(&attributes);
+        attributes.c_cflag |= CLOCAL | CREAD;
+        return tcsetattr(this->m_fd, TCSANOW, &attributes) == 0;
+    }
+
+    int m_fd;
+};
+#else
+/**
+ * @brief UART（HardwareSerial）のバイトストリーム
+ *
+ * 送受信はUARTの割り込みとバッファで行われるため、CPUはフレームの
+ * 組み立て・検査だけを行う。
+ */
+class HardwareSerialByteStream : public IByteStream
+{
+public:
+    explicit HardwareSerialByteStream(HardwareSerial &serial) : m_serial(serial) {}
+
+    /**
+     * @brief UARTを開始
+     * @param baudRate 通信速度（bps）
+     */
+    void begin(uint32_t baudRate) { this->m_serial.begin(baudRate); }
+
+    int available() override { return this->m_serial.available(); }
+
+    int read() override { return this->m_serial.read(); }
+
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        return this->m_serial.write(data, length);
+    }
+
+    void flush() override { this->m_serial.flush(); }
+
+    bool setBaudRate(uint32_t baudRate) override
+    {
+        this->m_serial.flush();
+        this->m_serial.end();
+        this->m_serial.begin(baudRate);
+        return true;
+    }
+
+private:
+    HardwareSerial &m_serial;
+};
+#endif
+
+#endif // I_BYTE_STREAM_H
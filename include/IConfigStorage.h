@@ -0,0 +1,132 @@
+#ifndef I_CONFIG_STORAGE_H
+#define I_CONFIG_STORAGE_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#else
+#include <Arduino.h>
+#if defined(ESP32)
+#include <Preferences.h>
+#else
+#include <EEPROM.h>
+#endif
+#endif
+
+/**
+ * @brief 設定の保存先インターフェース
+ *
+ * 設定は固定長のバイト列としてまとめて読み書きする（内容の検証は呼び出し側で行う）。
+ * 実機ではEEPROM（AVR）やNVS（ESP32）、テストではMockConfigStorageを使う。
+ */
+class IConfigStorage
+{
+public:
+    virtual ~IConfigStorage() = default;
+
+    /**
+     * @brief 保存済みのバイト列を読み出す
+     * @param data 読み出し先
+     * @param length 読み出すバイト数
+     * @return true 成功, false 未保存または読み出し失敗
+     */
+    virtual bool read(uint8_t *data, size_t length) = 0;
+
+    /**
+     * @brief バイト列を保存
+     * @param data 保存するデータ
+     * @param length データ長
+     * @return true 成功, false 失敗
+     */
+    virtual bool write(const uint8_t *data, size_t length) = 0;
+};
+
+#ifndef NATIVE_TEST
+#if defined(ESP32)
+/**
+ * @brief NVS（Preferences）へ保存する設定ストレージ
+ */
+class NvsConfigStorage : public IConfigStorage
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param nameSpace NVSの名前空間
+     */
+    explicit NvsConfigStorage(const char *nameSpace = "hdlc") : m_nameSpace(nameSpace) {}
+
+    bool read(uint8_t *data, size_t length) override
+    {
+        Preferences preferences;
+        if (!preferences.begin(this->m_nameSpace, true))
+        {
+            return false;
+        }
+        size_t readLength = preferences.getBytes("link", data, length);
+        preferences.end();
+        return readLength == length;
+    }
+
+    bool write(const uint8_t *data, size_t length) override
+    {
+        Preferences preferences;
+        if (!preferences.begin(this->m_nameSpace, false))
+        {
+            return false;
+        }
+        size_t written = preferences.putBytes("link", data, length);
+        preferences.end();
+        return written == length;
+    }
+
+private:
+    const char *m_nameSpace;
+};
+#else
+/**
+ * @brief 内蔵EEPROMへ保存する設定ストレージ
+ *
+ * 書き込みはEEPROM.update()で値の変わるバイトだけに行う（書き換え回数の節約）。
+ */
+class EEPROMConfigStorage : public IConfigStorage
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param offset 保存先の先頭アドレス
+     */
+    explicit EEPROMConfigStorage(int offset = 0) : m_offset(offset) {}
+
+    bool read(uint8_t *data, size_t length) override
+    {
+        if (this->m_offset + length > EEPROM.length())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = EEPROM.read(this->m_offset + i);
+        }
+        return true;
+    }
+
+    bool write(const uint8_t *data, size_t length) override
+    {
+        if (this->m_offset + length > EEPROM.length())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            EEPROM.update(this->m_offset + i, data[i]);
+        }
+        return true;
+    }
+
+private:
+    int m_offset;
+};
+#endif
+#endif
+
+#endif // I_CONFIG_STORAGE_H
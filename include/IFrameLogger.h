@@ -0,0 +1,35 @@
+#ifndef I_FRAME_LOGGER_H
+#define I_FRAME_LOGGER_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#else
+#include <stddef.h>
+#endif
+
+/**
+ * @brief 送受信フレームの記録先インターフェース
+ *
+ * HDLCクラスは送信直前と受信完了時にフレーム（アドレスからCRCまで）を渡す。
+ * 実装はビット処理の合間に呼ばれるため、ここでは待ちが発生する処理を行わず、
+ * 記録のバッファリングだけに留めること。
+ */
+class IFrameLogger
+{
+public:
+    virtual ~IFrameLogger() = default;
+
+    /**
+     * @brief フレームの記録
+     * @param timestampMicros 記録時刻（ピンインターフェースのmicros()）
+     * @param received true 受信フレーム, false 送信フレーム
+     * @param crcValid CRC検証結果（送信フレームは常にtrue）
+     * @param frame フレームデータ（CRCを含む）
+     * @param length フレーム長
+     */
+    virtual void logFrame(uint32_t timestampMicros, bool received, bool crcValid,
+                          const uint8_t *frame, size_t length) = 0;
+};
+
+#endif // I_FRAME_LOGGER_H
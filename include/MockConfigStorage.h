@@ -0,0 +1,48 @@
+#ifndef MOCK_CONFIG_STORAGE_H
+#define MOCK_CONFIG_STORAGE_H
+
+#include "IConfigStorage.h"
+#include <cstring>
+
+/**
+ * @brief テスト用のメモリ上の設定ストレージ
+ *
+ * 未保存の状態（消去済みEEPROMと同じ0xFF）から始まり、書き込み回数を数える。
+ */
+class MockConfigStorage : public IConfigStorage
+{
+public:
+    static const size_t CAPACITY = 64;
+
+    MockConfigStorage() : writeCount(0), failWrites(false)
+    {
+        memset(this->data, 0xFF, sizeof(this->data));
+    }
+
+    bool read(uint8_t *buffer, size_t length) override
+    {
+        if (length > CAPACITY)
+        {
+            return false;
+        }
+        memcpy(buffer, this->data, length);
+        return true;
+    }
+
+    bool write(const uint8_t *buffer, size_t length) override
+    {
+        if (this->failWrites || length > CAPACITY)
+        {
+            return false;
+        }
+        memcpy(this->data, buffer, length);
+        this->writeCount++;
+        return true;
+    }
+
+    uint8_t data[CAPACITY]; ///< 保存内容
+    size_t writeCount;      ///< write()が成功した回数
+    bool failWrites;        ///< trueの間はwrite()を失敗させる
+};
+
+#endif // MOCK_CONFIG_STORAGE_H
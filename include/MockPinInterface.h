@@ -4,6 +4,7 @@
 #include "IPinInterface.h"
 #include <vector>
 #include <functional>
+#include <cstddef>
 
 // Arduino定数の定義（テスト環境用）
 #ifndef HIGH
@@ -56,15 +57,117 @@ public:
         uint32_t timestamp;
     };
 
+    /**
+     * @brief 記録モード
+     */
+    enum CaptureMode
+    {
+        CAPTURE_FULL_LOG, ///< 全呼び出しをLogEntryとして記録（既定）
+        CAPTURE_RLE       ///< ピン毎のレベル変化をランレングスで有界リングに記録
+    };
+
+    /**
+     * @brief ランレングス記録の1区間（同一レベルが続いた区間）
+     */
+    struct LevelRun
+    {
+        uint8_t value;      ///< レベル
+        uint32_t startTime; ///< 区間開始時のタイムスタンプ
+        uint32_t lastTime;  ///< 区間内最後のアクセスのタイムスタンプ
+        uint32_t accesses;  ///< 区間内のアクセス回数（読み書き合計）
+    };
+
 private:
+    // ピン毎の実行カウンタ（両モード共通、O(1)で参照可能）
+    struct PinCounters
+    {
+        uint32_t writes = 0;                ///< 書き込み総数
+        uint32_t writesByLevel[2] = {0, 0}; ///< LOW/HIGH別の書き込み数
+        uint32_t reads = 0;                 ///< 読み取り総数
+    };
+
+    // ピン毎のランレングスリング
+    struct PinCapture
+    {
+        std::vector<LevelRun> runs; ///< リングバッファ本体
+        size_t head = 0;            ///< 最古の区間の位置
+        size_t count = 0;           ///< 保持している区間数
+        uint32_t droppedRuns = 0;   ///< 溢れて破棄した区間数
+    };
+
     std::vector<PinState> m_pinStates;
     std::vector<LogEntry> m_log;
     std::function<void()> m_interruptCallback;
     uint8_t m_currentInterruptNum;
     uint32_t m_timeCounter;
 
+    CaptureMode m_captureMode;
+    size_t m_runCapacity;
+    std::vector<PinCounters> m_counters;
+    std::vector<PinCapture> m_captures;
+    uint32_t m_delayCount;
+    uint64_t m_totalDelayMicros;
+
+    /**
+     * @brief ランレングスリングへのレベル記録
+     */
+    void _captureLevel(uint8_t pin, uint8_t value)
+    {
+        PinCapture &capture = m_captures[pin];
+        if (capture.count > 0)
+        {
+            size_t last = (capture.head + capture.count - 1) % m_runCapacity;
+            LevelRun &run = capture.runs[last];
+            if (run.value == value)
+            {
+                // 同一レベルの継続は区間を伸ばすだけ
+                run.lastTime = m_timeCounter;
+                run.accesses++;
+                return;
+            }
+        }
+
+        if (capture.runs.size() != m_runCapacity)
+        {
+            capture.runs.resize(m_runCapacity);
+        }
+
+        LevelRun run = {value, m_timeCounter, m_timeCounter, 1};
+        if (capture.count < m_runCapacity)
+        {
+            capture.runs[(capture.head + capture.count) % m_runCapacity] = run;
+            capture.count++;
+        }
+        else
+        {
+            // 満杯の場合は最古の区間を上書き
+            capture.runs[capture.head] = run;
+            capture.head = (capture.head + 1) % m_runCapacity;
+            capture.droppedRuns++;
+        }
+    }
+
+    /**
+     * @brief 記録モードに応じたログ追加
+     */
+    void _record(LogEntry::Type type, uint8_t pin, uint8_t value)
+    {
+        if (m_captureMode == CAPTURE_FULL_LOG)
+        {
+            m_log.push_back({type, pin, value, m_timeCounter});
+        }
+        else if (type == LogEntry::DIGITAL_WRITE || type == LogEntry::DIGITAL_READ)
+        {
+            _captureLevel(pin, value);
+        }
+        m_timeCounter++;
+    }
+
 public:
-    MockPinInterface() : m_pinStates(256), m_currentInterruptNum(255), m_timeCounter(0) {}
+    MockPinInterface()
+        : m_pinStates(256), m_currentInterruptNum(255), m_timeCounter(0),
+          m_captureMode(CAPTURE_FULL_LOG), m_runCapacity(1024),
+          m_counters(256), m_captures(256), m_delayCount(0), m_totalDelayMicros(0) {}
 
     /**
      * @brief ピンモードの設定
@@ -75,7 +178,7 @@ public:
         {
             m_pinStates[pin].mode = mode;
         }
-        m_log.push_back({LogEntry::PIN_MODE, pin, mode, m_timeCounter++});
+        _record(LogEntry::PIN_MODE, pin, mode);
     }
 
     /**
@@ -87,7 +190,13 @@ public:
         {
             m_pinStates[pin].value = value;
         }
-        m_log.push_back({LogEntry::DIGITAL_WRITE, pin, value, m_timeCounter++});
+        PinCounters &counters = m_counters[pin];
+        counters.writes++;
+        if (value <= 1)
+        {
+            counters.writesByLevel[value]++;
+        }
+        _record(LogEntry::DIGITAL_WRITE, pin, value);
     }
 
     /**
@@ -100,7 +209,8 @@ public:
         {
             value = m_pinStates[pin].value;
         }
-        m_log.push_back({LogEntry::DIGITAL_READ, pin, value, m_timeCounter++});
+        m_counters[pin].reads++;
+        _record(LogEntry::DIGITAL_READ, pin, value);
         return value;
     }
 
@@ -111,7 +221,7 @@ public:
     {
         m_currentInterruptNum = interruptNum;
         m_interruptCallback = callback;
-        m_log.push_back({LogEntry::ATTACH_INTERRUPT, interruptNum, mode, m_timeCounter++});
+        _record(LogEntry::ATTACH_INTERRUPT, interruptNum, mode);
     }
 
     /**
@@ -124,7 +234,7 @@ public:
             m_interruptCallback = nullptr;
             m_currentInterruptNum = 255;
         }
-        m_log.push_back({LogEntry::DETACH_INTERRUPT, interruptNum, 0, m_timeCounter++});
+        _record(LogEntry::DETACH_INTERRUPT, interruptNum, 0);
     }
 
     /**
@@ -132,8 +242,9 @@ public:
      */
     void delayMicroseconds(uint32_t microseconds) override
     {
-        (void)microseconds; // 未使用パラメータ警告を回避
-        m_log.push_back({LogEntry::DELAY_MICROS, 0, 0, m_timeCounter++});
+        m_delayCount++;
+        m_totalDelayMicros += microseconds;
+        _record(LogEntry::DELAY_MICROS, 0, 0);
         // 実際の遅延は行わない（テスト高速化のため）
     }
 
@@ -210,6 +321,88 @@ public:
     {
         m_log.clear();
         m_timeCounter = 0;
+        for (auto &counters : m_counters)
+        {
+            counters = PinCounters();
+        }
+        for (auto &capture : m_captures)
+        {
+            capture = PinCapture();
+        }
+        m_delayCount = 0;
+        m_totalDelayMicros = 0;
+    }
+
+    /**
+     * @brief 記録モードの設定
+     *
+     * CAPTURE_RLEではLogEntryを蓄積せず、ピン毎のレベル変化だけを
+     * 最大runCapacity区間のリングに保持する。長時間のシミュレーションでも
+     * メモリ使用量が一定になる。モード変更時は既存の記録をクリアする。
+     * @param mode 記録モード
+     * @param runCapacity ピン毎に保持する区間数（RLE時のみ有効）
+     */
+    void setCaptureMode(CaptureMode mode, size_t runCapacity = 1024)
+    {
+        m_captureMode = mode;
+        m_runCapacity = (runCapacity > 0) ? runCapacity : 1;
+        clearLog();
+    }
+
+    /**
+     * @brief 現在の記録モードを取得
+     */
+    CaptureMode getCaptureMode() const
+    {
+        return m_captureMode;
+    }
+
+    /**
+     * @brief 保持しているランレングス区間数を取得
+     */
+    size_t getRunCount(uint8_t pin) const
+    {
+        return m_captures[pin].count;
+    }
+
+    /**
+     * @brief ランレングス区間を取得（0が保持中で最古）
+     *
+     * indexがgetRunCount(pin)以上の場合は空の区間（accessesが0）を返す。
+     */
+    const LevelRun &getRun(uint8_t pin, size_t index) const
+    {
+        static const LevelRun emptyRun = {0, 0, 0, 0};
+        const PinCapture &capture = m_captures[pin];
+        if (index >= capture.count || m_runCapacity == 0 || capture.runs.size() != m_runCapacity)
+        {
+            return emptyRun;
+        }
+        return capture.runs[(capture.head + index) % m_runCapacity];
+    }
+
+    /**
+     * @brief リング溢れで破棄された区間数を取得
+     */
+    uint32_t getDroppedRunCount(uint8_t pin) const
+    {
+        return m_captures[pin].droppedRuns;
+    }
+
+    /**
+     * @brief 特定のピンからの読み取り回数を取得
+     */
+    uint32_t countDigitalReads(uint8_t pin) const
+    {
+        return m_counters[pin].reads;
+    }
+
+    /**
+     * @brief 遅延要求時間の合計を取得（マイクロ秒）
+     */
+    uint64_t getTotalDelayMicros() const
+    {
+        return m_totalDelayMicros;
     }
 
     /**
@@ -233,12 +426,23 @@ public:
      */
     int countDigitalWrites(uint8_t pin, uint8_t value = 255) const
     {
+        const PinCounters &counters = m_counters[pin];
+        if (value == 255)
+        {
+            return (int)counters.writes;
+        }
+        if (value <= 1)
+        {
+            return (int)counters.writesByLevel[value];
+        }
+
+        // HIGH/LOW以外の値はログを走査（CAPTURE_FULL_LOG時のみ有効）
         int count = 0;
         for (const auto &entry : m_log)
         {
             if (entry.type == LogEntry::DIGITAL_WRITE && entry.pin == pin)
             {
-                if (value == 255 || entry.value == value)
+                if (entry.value == value)
                 {
                     count++;
                 }
@@ -252,15 +456,7 @@ public:
      */
     int countDelays() const
     {
-        int count = 0;
-        for (const auto &entry : m_log)
-        {
-            if (entry.type == LogEntry::DELAY_MICROS)
-            {
-                count++;
-            }
-        }
-        return count;
+        return (int)m_delayCount;
     }
 };
 
@@ -0,0 +1,124 @@
+#ifndef OCTET_STUFFING_H
+#define OCTET_STUFFING_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief 複数バイト単位でエスケープ対象を探すカーネルの有効化
+ *
+ * 既定ではホスト（ネイティブ）ビルドでだけ有効。無効の場合は1バイトずつの
+ * ループ（KERNEL_SCALAR）だけをビルドする。
+ */
+#ifndef OCTET_STUFFING_WIDE_KERNELS
+#ifdef NATIVE_TEST
+#define OCTET_STUFFING_WIDE_KERNELS 1
+#else
+#define OCTET_STUFFING_WIDE_KERNELS 0
+#endif
+#endif
+
+/**
+ * @brief 非同期（オクテット単位）HDLCのバイトスタッフィング
+ *
+ * ISO/IEC 13239の調歩同期フレーミング。フレームを0x7Eで囲み、
+ * データ中の0x7Eと0x7Dは0x7Dの後に0x20との排他的論理和で送る。
+ * 制御文字のエスケープ（ACCM）は行わない（8ビット透過な回線を前提とする）。
+ *
+ * ホストビルドでは0x7E/0x7Dの候補を8〜32バイト単位で探し、対象を含まない区間を
+ * まとめてコピーするカーネル（SWAR、SSE2、AVX2）を使う。どのカーネルも出力は
+ * KERNEL_SCALARと同じ。
+ */
+class OctetStuffing
+{
+public:
+    /**
+     * @brief フラグ（フレームの区切り）
+     */
+    static const uint8_t FLAG = 0x7E;
+
+    /**
+     * @brief エスケープ（次のバイトを0x20との排他的論理和で戻す）
+     */
+    static const uint8_t ESCAPE = 0x7D;
+
+    /**
+     * @brief エスケープしたバイトに掛ける値
+     */
+    static const uint8_t ESCAPE_XOR = 0x20;
+
+    /**
+     * @brief decodeの異常（不完全なエスケープ、フラグの混入、出力先不足）
+     */
+    static const size_t DECODE_ERROR = (size_t)-1;
+
+    /**
+     * @brief エスケープ対象の探索方法
+     */
+    enum Kernel
+    {
+        KERNEL_SCALAR, ///< 1バイトずつ（参照実装、全環境）
+        KERNEL_SWAR,   ///< 64ビット整数で8バイトずつ
+        KERNEL_SSE2,   ///< SSE2で16バイトずつ（x86）
+        KERNEL_AVX2    ///< AVX2で32バイトずつ（実行時にCPUを判定）
+    };
+
+    /**
+     * @brief 実行中の環境で使える最速のカーネル
+     */
+    static Kernel activeKernel();
+
+    /**
+     * @brief カーネルが実行中の環境で使えるか
+     * @param kernel カーネル
+     */
+    static bool isKernelSupported(Kernel kernel);
+
+    /**
+     * @brief encodeFrameの出力に必要な最大長
+     * @param length フレーム長
+     */
+    static size_t maxEncodedSize(size_t length) { return length * 2 + 2; }
+
+    /**
+     * @brief フレームをエスケープし、前後にフラグを付ける
+     * @param data フレーム（アドレスからCRCまで）
+     * @param length フレーム長
+     * @param out 出力先
+     * @param outSize 出力先サイズ（maxEncodedSize(length)あれば常に足りる）
+     * @return 出力した長さ（出力先不足の場合は0）
+     */
+    static size_t encodeFrame(const uint8_t *data, size_t length, uint8_t *out, size_t outSize)
+    {
+        return encodeFrame(activeKernel(), data, length, out, outSize);
+    }
+
+    /**
+     * @brief カーネルを指定したencodeFrame（使えないカーネルはKERNEL_SCALARで処理）
+     */
+    static size_t encodeFrame(Kernel kernel, const uint8_t *data, size_t length, uint8_t *out, size_t outSize);
+
+    /**
+     * @brief フラグの間のバイト列のエスケープを戻す
+     * @param in 受信したバイト列（フラグを含まない）
+     * @param length 入力長
+     * @param out 出力先（inと同じでもよい）
+     * @param outSize 出力先サイズ
+     * @return 出力した長さ（異常の場合はDECODE_ERROR）
+     */
+    static size_t decode(const uint8_t *in, size_t length, uint8_t *out, size_t outSize)
+    {
+        return decode(activeKernel(), in, length, out, outSize);
+    }
+
+    /**
+     * @brief カーネルを指定したdecode（使えないカーネルはKERNEL_SCALARで処理）
+     */
+    static size_t decode(Kernel kernel, const uint8_t *in, size_t length, uint8_t *out, size_t outSize);
+};
+
+#endif // OCTET_STUFFING_H
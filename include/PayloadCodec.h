@@ -0,0 +1,83 @@
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <stdint.h>
+#ifdef NATIVE_TEST
+#include <cstddef> // size_t用
+#include <cstring> // memcpy用
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief Iフレーム情報フィールドの軽量圧縮
+ *
+ * 圧縮後の先頭1バイトが方式（Codec）を示す。方式はRLE（PackBits形式）と、
+ * 前のバイトとの差分を取ってからRLEする差分RLEの2種類で、短い方を選ぶ。
+ * どちらも縮まない場合は無圧縮（CODEC_NONE + 元のデータ）になる。
+ * 辞書を持たないため、作業用RAMは呼び出し側の入出力バッファとスタック上の
+ * 入力長分の一時バッファだけで済む。
+ *
+ * RLEの符号: 制御バイト0x00-0x7Fは続く(n+1)バイトのリテラル、
+ * 0x80-0xFFは続く1バイトを(n-0x80+3)回繰り返す。
+ */
+class PayloadCodec
+{
+public:
+    /**
+     * @brief 圧縮方式（圧縮後の先頭バイト）
+     */
+    enum Codec
+    {
+        CODEC_NONE = 0x00,     ///< 無圧縮
+        CODEC_RLE = 0x01,      ///< RLE
+        CODEC_DELTA_RLE = 0x02 ///< 差分 + RLE（増加するカウンタ等）
+    };
+
+    /**
+     * @brief 一時バッファを使う最大入力長（これを超える入力はRLEのみ試す）
+     */
+    static const size_t MAX_DELTA_INPUT = 64;
+
+    /**
+     * @brief 圧縮
+     * @param input 入力データ
+     * @param length 入力長（1以上）
+     * @param output 出力先（length + 1バイトあれば常に足りる）
+     * @param maxOutput 出力先サイズ
+     * @return 方式バイトを含む出力長（出力先不足の場合は0）
+     */
+    static size_t compress(const uint8_t *input, size_t length, uint8_t *output, size_t maxOutput);
+
+    /**
+     * @brief 伸長
+     * @param input compressの出力
+     * @param length 入力長
+     * @param output 出力先
+     * @param maxOutput 出力先サイズ
+     * @return 伸長後の長さ（未知の方式・符号の破損・出力先不足の場合は0）
+     */
+    static size_t decompress(const uint8_t *input, size_t length, uint8_t *output, size_t maxOutput);
+
+private:
+    /**
+     * @brief RLE符号化
+     * @param input 入力データ
+     * @param length 入力長
+     * @param delta true 前のバイトとの差分を符号化
+     * @param output 出力先
+     * @param limit 出力の上限（これ以上になる場合は打ち切る）
+     * @return 出力長（上限に達した場合は0）
+     */
+    static size_t _encodeRle(const uint8_t *input, size_t length, bool delta, uint8_t *output, size_t limit);
+
+    /**
+     * @brief 符号化する値（差分の場合は前のバイトとの差）
+     */
+    static uint8_t _valueAt(const uint8_t *input, size_t index, bool delta)
+    {
+        return delta ? (uint8_t)(input[index] - (index ? input[index - 1] : 0)) : input[index];
+    }
+};
+
+#endif // PAYLOAD_CODEC_H
@@ -0,0 +1,107 @@
+#ifndef PCAP_WRITER_H
+#define PCAP_WRITER_H
+
+#include "IFrameLogger.h"
+#include "IByteSink.h"
+
+/**
+ * @brief 送受信フレームをpcap形式で記録するロガー
+ *
+ * LINKTYPE_LAPB_WITH_DIR（207）を使い、各パケットの先頭に方向を示す
+ * 1バイトの疑似ヘッダ（0x00 送信, 0x01 受信）を付ける。後続はアドレスから
+ * 情報フィールドまでで、FCSは含めない。CRC異常の受信フレームはこのリンクタイプで
+ * 表せないため記録せず、crcErrorFrames()で数だけを返す。
+ * WiresharkはLAPB（modulo-8）として解析するので、SNRMEで確立したリンク
+ * （modulo-128、2バイトのコントロールフィールド）のフレームは正しく解釈されない。
+ *
+ * logFrame()は呼び出し側が用意したバッファへ追記するだけで、シンクへの
+ * 書き込みはflush()でまとめて行う。バッファに入りきらない記録は破棄して
+ * 数を数える（リンクの処理を止めない）。
+ */
+class PcapWriter : public IFrameLogger
+{
+public:
+    /**
+     * @brief pcapのリンクタイプ（LINKTYPE_LAPB_WITH_DIR）
+     */
+    static const uint32_t LINKTYPE = 207;
+
+    /**
+     * @brief 方向疑似ヘッダの値
+     */
+    enum Direction
+    {
+        DIRECTION_SENT = 0x00,    ///< 送信フレーム
+        DIRECTION_RECEIVED = 0x01 ///< 受信フレーム
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param sink 書き込み先
+     * @param buffer 記録用バッファ
+     * @param bufferSize バッファサイズ（1レコードは17バイト+FCSを除いたフレーム長）
+     */
+    PcapWriter(IByteSink &sink, uint8_t *buffer, size_t bufferSize);
+
+    /**
+     * @brief pcapファイルヘッダをバッファへ書き込む
+     * @return true 成功, false バッファ不足
+     */
+    bool begin();
+
+    /**
+     * @brief タイムスタンプの基準時刻を設定（既定は0=起動時）
+     * @param unixSeconds micros()が0の時点のUNIX時刻（秒）
+     */
+    void setTimeBase(uint32_t unixSeconds) { this->m_timeBaseSeconds = unixSeconds; }
+
+    void logFrame(uint32_t timestampMicros, bool received, bool crcValid,
+                  const uint8_t *frame, size_t length) override;
+
+    /**
+     * @brief バッファの内容をシンクへ書き出す
+     *
+     * リンクが送受信していない時（loop()の合間等）に呼ぶこと。
+     * @return 書き出したバイト数
+     */
+    size_t flush();
+
+    /**
+     * @brief 未書き出しのバイト数
+     */
+    size_t pendingBytes() const { return this->m_used; }
+
+    /**
+     * @brief バッファ不足で破棄した記録数
+     */
+    uint32_t droppedFrames() const { return this->m_droppedFrames; }
+
+    /**
+     * @brief 記録しなかったCRC異常の受信フレーム数
+     */
+    uint32_t crcErrorFrames() const { return this->m_crcErrorFrames; }
+
+private:
+    /**
+     * @brief リトルエンディアンの32ビット値を追記
+     */
+    void _put32(uint32_t value);
+
+    /**
+     * @brief リトルエンディアンの16ビット値を追記
+     */
+    void _put16(uint16_t value);
+
+    IByteSink &m_sink;
+    uint8_t *m_buffer;
+    size_t m_bufferSize;
+    size_t m_used;
+
+    uint32_t m_timeBaseSeconds;
+    uint32_t m_lastMicros;
+    uint32_t m_wrapCount; ///< micros()の桁あふれ回数（約71.6分毎）
+    uint32_t m_droppedFrames;
+    uint32_t m_crcErrorFrames;
+};
+
+#endif // PCAP_WRITER_H
@@ -0,0 +1,90 @@
+#ifndef PIN_TRACE_RECORDER_H
+#define PIN_TRACE_RECORDER_H
+
+#include "IPinInterface.h"
+#include "BitTraceFormat.h"
+#include <cstdio>
+
+/**
+ * @brief TX/RX/DEピンの波形を記録するピンインターフェース（ネイティブ専用）
+ *
+ * 任意のIPinInterfaceをラップし、対象ピンのレベル変化だけを時刻付きで
+ * VCDまたはHBT1バイナリ形式のファイルへ書き出す。それ以外の呼び出しは
+ * そのままラップ先へ委譲する。時刻はラップ先のmicros()を64ビットに拡張して使う。
+ */
+class PinTraceRecorder : public IPinInterface
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param inner ラップするピンインターフェース
+     * @param txPin 送信ピン
+     * @param rxPin 受信ピン
+     * @param dePin ドライバイネーブルピン
+     */
+    PinTraceRecorder(IPinInterface &inner, uint8_t txPin, uint8_t rxPin, uint8_t dePin);
+
+    ~PinTraceRecorder() override;
+
+    /**
+     * @brief 記録ファイルを開く
+     * @param path 出力先パス
+     * @param format 出力形式
+     * @return true 成功, false 失敗
+     */
+    bool open(const char *path, BitTrace::Format format);
+
+    /**
+     * @brief 記録ファイルを閉じる（バッファをフラッシュ）
+     */
+    void close();
+
+    /**
+     * @brief 記録中かどうか
+     */
+    bool isOpen() const { return this->m_file != nullptr; }
+
+    /**
+     * @brief 書き出したレベル変化の数
+     */
+    uint64_t getEdgeCount() const { return this->m_edgeCount; }
+
+    void pinMode(uint8_t pin, uint8_t mode) override;
+    void digitalWrite(uint8_t pin, uint8_t value) override;
+    uint8_t digitalRead(uint8_t pin) override;
+    void attachInterrupt(uint8_t interruptNum, void (*callback)(), uint8_t mode) override;
+    void detachInterrupt(uint8_t interruptNum) override;
+    void delayMicroseconds(uint32_t microseconds) override;
+    uint32_t millis() override;
+    uint32_t micros() override;
+
+private:
+    /**
+     * @brief ピン番号からチャネルを取得
+     * @return チャネル、対象外の場合はCHANNEL_COUNT
+     */
+    uint8_t _channelOf(uint8_t pin) const;
+
+    /**
+     * @brief レベル変化の記録
+     */
+    void _recordLevel(uint8_t channel, uint8_t level);
+
+    /**
+     * @brief 64ビットに拡張した現在時刻（記録開始からの経過）
+     */
+    uint64_t _now();
+
+    IPinInterface &m_inner;
+    uint8_t m_pins[BitTrace::CHANNEL_COUNT];
+    uint8_t m_levels[BitTrace::CHANNEL_COUNT]; ///< 直前のレベル（0xFFは未記録）
+
+    FILE *m_file;
+    BitTrace::Format m_format;
+    uint32_t m_lastRawMicros;
+    uint64_t m_elapsedMicros;
+    uint64_t m_lastRecordMicros;
+    uint64_t m_edgeCount;
+};
+
+#endif // PIN_TRACE_RECORDER_H
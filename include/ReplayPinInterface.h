@@ -0,0 +1,133 @@
+#ifndef REPLAY_PIN_INTERFACE_H
+#define REPLAY_PIN_INTERFACE_H
+
+#include "IPinInterface.h"
+#include "BitTraceFormat.h"
+#include <vector>
+#include <string>
+
+/**
+ * @brief 記録済み波形を受信ピンへ再生するピンインターフェース（ネイティブ専用）
+ *
+ * HBT1バイナリ（大容量はメモリマップで読み込み）またはVCDファイルを読み込み、
+ * 選択したチャネルのレベルをdigitalRead(rxPin)の結果として返す。
+ * 時刻は仮想クロックで、delayMicroseconds()で進む。実時間の待機を行わないため、
+ * HDLCの受信処理をCPUの限界速度で駆動できる。
+ * ファイルを開かずに使うと、常にアイドル（HIGH）を返す仮想クロック付きのピンになる。
+ */
+class ReplayPinInterface : public IPinInterface
+{
+public:
+    /**
+     * @brief コンストラクタ
+     * @param rxPin 再生したレベルを返す受信ピン
+     */
+    explicit ReplayPinInterface(uint8_t rxPin);
+
+    ~ReplayPinInterface() override;
+
+    /**
+     * @brief キャプチャファイルを開く（HBT1またはVCDを自動判別）
+     * @param path ファイルパス
+     * @return true 成功, false 失敗
+     */
+    bool open(const char *path);
+
+    /**
+     * @brief メモリ上のHBT1データを再生対象にする（データは呼び出し側が保持）
+     * @param data HBT1データ
+     * @param length データ長
+     * @return true 成功, false 形式不正
+     */
+    bool openMemory(const uint8_t *data, size_t length);
+
+    /**
+     * @brief キャプチャを閉じる
+     */
+    void close();
+
+    /**
+     * @brief 再生位置と仮想クロックを先頭に戻す
+     */
+    void rewind();
+
+    /**
+     * @brief 受信ピンへ再生するチャネルを選択（既定はRX、再生位置は先頭に戻る）
+     */
+    void setReplayChannel(BitTrace::Channel channel)
+    {
+        this->m_replayChannel = channel;
+        this->rewind();
+    }
+
+    /**
+     * @brief VCD読み込み時にチャネルへ割り当てる信号名を設定（open前に呼ぶ）
+     * @param channel チャネル
+     * @param name VCDの$var名（既定はtx/rx/de）
+     */
+    void setVcdSignalName(BitTrace::Channel channel, const char *name);
+
+    /**
+     * @brief キャプチャの最後まで再生したか
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief 仮想クロックの現在時刻（マイクロ秒）
+     */
+    uint64_t getVirtualMicros() const { return this->m_nowMicros; }
+
+    void pinMode(uint8_t pin, uint8_t mode) override;
+    void digitalWrite(uint8_t pin, uint8_t value) override;
+    uint8_t digitalRead(uint8_t pin) override;
+    void attachInterrupt(uint8_t interruptNum, void (*callback)(), uint8_t mode) override;
+    void detachInterrupt(uint8_t interruptNum) override;
+    void delayMicroseconds(uint32_t microseconds) override;
+    uint32_t millis() override;
+    uint32_t micros() override;
+
+private:
+    /**
+     * @brief 次のレコードを先読みする
+     * @return true 読み込めた, false 終端
+     */
+    bool _loadNextEdge();
+
+    /**
+     * @brief 現在時刻までの変化を適用する
+     */
+    void _advance();
+
+    /**
+     * @brief VCDファイルを読み込み、HBT1へ変換して保持する
+     */
+    bool _loadVcd(const char *path);
+
+    /**
+     * @brief マップしたファイルを解放する
+     */
+    void _unmap();
+
+    uint8_t m_rxPin;
+    BitTrace::Channel m_replayChannel;
+    std::string m_vcdNames[BitTrace::CHANNEL_COUNT];
+    uint8_t m_pinValues[256];
+
+    // 再生データ（マップ領域・所有バッファ・外部メモリのいずれか）
+    const uint8_t *m_data;
+    size_t m_length;
+    size_t m_position;
+    void *m_mappedBase;
+    size_t m_mappedLength;
+    std::vector<uint8_t> m_ownedData;
+
+    // 先読みしたレコード
+    BitTrace::Edge m_nextEdge;
+    bool m_hasNextEdge;
+    uint64_t m_edgeTimeMicros;
+
+    uint64_t m_nowMicros;
+    uint8_t m_level;
+};
+
+#endif // REPLAY_PIN_INTERFACE_H
@@ -1,4 +1,5 @@
 #include "HDLC.h"
+#include "OctetStuffing.h"
 #include <stdlib.h> // malloc, free用
 
 #ifdef NATIVE_TEST
@@ -17,6 +18,93 @@
 #endif
 #endif
 
+const uint32_t HDLC::MAX_RESPONSE_TIMEOUT_MS;
+const uint32_t HDLC::BAUD_FALLBACK_MS;
+const HDLC::RequestHandle HDLC::INVALID_HANDLE;
+const uint8_t HDLC::DEFAULT_ADDRESS;
+const size_t HDLC::LINK_CONFIG_SIZE;
+
+static_assert((HDLC_RX_QUEUE_SLOTS & (HDLC_RX_QUEUE_SLOTS - 1)) == 0 && HDLC_RX_QUEUE_SLOTS <= 128,
+              "HDLC_RX_QUEUE_SLOTS must be a power of two up to 128");
+
+namespace
+{
+    // 自動速度検出で丸める標準の通信速度
+    const uint32_t STANDARD_BAUD_RATES[] = {1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200};
+
+    // 自動速度検出のRXポーリング間隔（マイクロ秒）
+    const uint32_t AUTOBAUD_POLL_MICROS = 2;
+
+    // NRZI受信で標本点の間にエッジを監視する間隔（マイクロ秒）
+    const uint32_t RESYNC_POLL_MICROS = 2;
+
+    // 速度確定を解除するまでの連続受信エラー回数
+    const uint8_t AUTOBAUD_MAX_FAILURES = 3;
+
+    // フラグフィル（LOW 2ビット・HIGH 6ビットの繰り返し）から速度を確定するのに必要な周期数
+    const uint8_t AUTOBAUD_FILL_CYCLES = 4;
+
+    // 検出した速度を、標準の速度から±4%以内なら丸める
+    uint32_t roundToStandardBaudRate(uint32_t baudRate)
+    {
+        for (size_t i = 0; i < sizeof(STANDARD_BAUD_RATES) / sizeof(STANDARD_BAUD_RATES[0]); i++)
+        {
+            uint32_t standard = STANDARD_BAUD_RATES[i];
+            if (baudRate * 25 >= standard * 24 && baudRate * 25 <= standard * 26)
+            {
+                return standard;
+            }
+        }
+        return baudRate;
+    }
+
+    const size_t STANDARD_BAUD_RATE_COUNT = sizeof(STANDARD_BAUD_RATES) / sizeof(STANDARD_BAUD_RATES[0]);
+
+    // 速度を上げる/下げるCRC異常率（千分率）
+    const uint32_t BAUD_STEP_UP_PERMILLE = 5;
+    const uint32_t BAUD_STEP_DOWN_PERMILLE = 50;
+
+    // tuneBaudRateで判定に必要な最小受信フレーム数
+    const uint32_t BAUD_TUNE_MIN_FRAMES = 32;
+
+    // 開始したフレームの受信で、フレームのデータを待つ最大ビット数（開始フラグ + 重複したフラグ + 1オクテット）
+    const size_t FRAME_HUNT_BITS = 24;
+
+    // 維持できなかった速度を再び試すまでに続けて必要な、CRC異常率が低いtuneBaudRateの区間数
+    const uint8_t BAUD_CEILING_DECAY_INTERVALS = 16;
+
+    // 速度切り替え後、相手局が新しい速度で受信を始めるまでの待機時間（ミリ秒）
+    const uint32_t BAUD_SWITCH_DELAY_MS = 2;
+
+    // 新しい速度でのTEST試行回数
+    const uint8_t BAUD_TEST_ATTEMPTS = 2;
+
+    // TEST折り返しの確認パターン（フラグ・スタッフィング・連続した0/1を含む）
+    const uint8_t TEST_PATTERN[] = {0x7E, 0xFF, 0x00, 0x55, 0xAA, 0x7D, 0x0F, 0xF0};
+
+    // 保存するリンク設定の識別子と形式のバージョン
+    const uint8_t LINK_CONFIG_MAGIC[] = {'H', 'L'};
+    const uint8_t LINK_CONFIG_VERSION = 1;
+
+    // リンク設定のフラグ
+    const uint8_t LINK_CONFIG_ADAPTIVE_TIMEOUT = 0x01;
+    const uint8_t LINK_CONFIG_EXTENDED_MODE = 0x02;
+    const uint8_t LINK_CONFIG_NRZI = 0x04;
+
+    void putLE32(uint8_t *out, uint32_t value)
+    {
+        out[0] = value & 0xFF;
+        out[1] = (value >> 8) & 0xFF;
+        out[2] = (value >> 16) & 0xFF;
+        out[3] = (value >> 24) & 0xFF;
+    }
+
+    uint32_t getLE32(const uint8_t *data)
+    {
+        return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+}
+
 HDLC::HDLC(IPinInterface &pinInterface, uint8_t txPin, uint8_t rxPin,
            uint8_t dePin, uint8_t rePin, uint32_t baudRate)
     : m_pinInterface(pinInterface),
@@ -28,19 +116,65 @@ HDLC::HDLC(IPinInterface &pinInterface, uint8_t txPin, uint8_t rxPin,
       m_bitTimeMicros(1000000UL / baudRate),
       m_halfBitTimeMicros((1000000UL / baudRate) / 2),
       m_isTransmitting(false),
+      m_settleMicros((1000000UL / baudRate) / 2 + 100),
+      m_turnaroundMicros((1000000UL / baudRate) / 2),
+      m_driverTimingSet(false),
+      m_lineCoding(LINE_NRZ),
+      m_txLevel(1),
+      m_rxLevel(1),
+      m_resumeAfterFlag(false),
+      m_resumeMicros(0),
+      m_autoBaud(false),
+      m_baudLocked(false),
+      m_autoBaudFailures(0),
+      m_maxBaudRate(STANDARD_BAUD_RATES[STANDARD_BAUD_RATE_COUNT - 1]),
+      m_baudCeiling(0),
+      m_fallbackBaudRate(0),
+      m_baudChangeMillis(0),
+      m_tuneValidBase(0),
+      m_tuneErrorBase(0),
+      m_cleanTuneIntervals(0),
+      m_requestHead(0),
+      m_requestCount(0),
+      m_nextHandle(1),
+      m_asyncState(ASYNC_IDLE),
+      m_asyncStartMillis(0),
+      m_asyncSentMicros(0),
+      m_asyncTimeoutMs(0),
+      m_completionCallback(nullptr),
+      m_completionContext(nullptr),
+      m_preambleFlags(1),
+      m_receiveHead(0),
+      m_receiveTail(0),
+      m_receiveCallback(nullptr),
       m_initialized(false),
-      m_targetAddress(0),
-      m_sendSequence(0),
-      m_receiveSequence(0),
+      m_session(&m_defaultSession),
       m_receiveIndex(0),
       m_currentByte(0),
       m_bitCount(0),
-      m_consecutiveOnes(0)
+      m_consecutiveOnes(0),
+      m_frameLogger(nullptr),
+      m_configStorage(nullptr),
+      m_byteStream(nullptr),
+      m_octetLength(0),
+      m_octetEscape(false),
+      m_octetDiscard(false),
+      m_role(ROLE_PRIMARY),
+      m_responseTimeoutMs(50),
+      m_adaptiveTimeout(true),
+      m_addressFilterEnabled(false),
+      m_windowSize(7),
+      m_extendedRequested(false),
+      m_pendingLength(0)
 {
     this->m_frameQueue.hasData = false;
     this->m_frameQueue.valid = false;
     this->m_frameQueue.length = 0;
 
+    HDLC::initSession(this->m_defaultSession, 0);
+    this->clearAcceptedAddresses();
+    this->resetReceiveStatistics();
+
     // 待機時間を事前計算
     this->m_shortDelayMicros = (1000000UL / baudRate) / 8; // 1/8ビット時間
 }
@@ -63,54 +197,23 @@ bool HDLC::begin()
 
     this->m_initialized = true;
 
-#ifndef NATIVE_TEST
-    // アドレス入力（不正な場合は繰り返し）
-    bool validAddress = false;
-    while (!validAddress)
+    // 保存済みのリンク設定があれば適用（入力待ちはしない）
+    LinkConfig config;
+    uint8_t stored[LINK_CONFIG_SIZE];
+    if (this->m_configStorage && this->m_configStorage->read(stored, sizeof(stored)) &&
+        HDLC::decodeLinkConfig(stored, config))
     {
-        Serial.println("Enter target address (0-255):");
-        while (!Serial.available())
-        {
-            delay(100);
-        }
-
-        String addressStr = Serial.readStringUntil('\n');
-        addressStr.trim();
-
-        // 空文字列チェック
-        if (addressStr.length() == 0)
-        {
-            Serial.println("Error: Empty input. Please enter a number between 0-255.");
-            continue;
-        }
-
-        // 数値変換と範囲チェック
-        int address = addressStr.toInt();
-
-        // toInt()は不正な文字列の場合0を返すため、"0"と不正文字列を区別する
-        if (address == 0 && addressStr != "0")
-        {
-            Serial.println("Error: Invalid input. Please enter a valid number between 0-255.");
-            continue;
-        }
-
-        if (address >= 0 && address <= 255)
-        {
-            this->m_targetAddress = (uint8_t)address;
-            Serial.print("Target address set to: ");
-            Serial.println(this->m_targetAddress);
-            validAddress = true;
-        }
-        else
-        {
-            Serial.println("Error: Address out of range. Please enter a number between 0-255.");
-        }
+        this->applyLinkConfig(config);
+    }
+    else
+    {
+        this->m_session->address = DEFAULT_ADDRESS;
     }
 
-    Serial.println("Ready for I-frame data input");
-#else
-    this->m_targetAddress = 1; // テスト用デフォルト
-#endif
+    if (this->m_role == ROLE_SECONDARY)
+    {
+        this->_precomputeResponses();
+    }
 
     return true;
 }
@@ -122,9 +225,11 @@ bool HDLC::sendSNRMAndWaitUA()
         return false;
     }
 
-    // SNRMフレームの作成
+    // SNRM（拡張モード要求時はSNRME）フレームの作成
+    bool extended = HDLC_ENABLE_EXTENDED_MODE && this->m_extendedRequested;
     uint8_t snrmFrame[MAX_FRAME_SIZE];
-    size_t frameLength = this->_createHDLCFrame(this->m_targetAddress, CMD_SNRM, nullptr, 0, snrmFrame, MAX_FRAME_SIZE);
+    size_t frameLength = this->_createHDLCFrame(this->m_session->address, extended ? CMD_SNRME : CMD_SNRM,
+                                                nullptr, 0, snrmFrame, MAX_FRAME_SIZE);
 
     if (frameLength == 0)
     {
@@ -137,21 +242,36 @@ bool HDLC::sendSNRMAndWaitUA()
         return false;
     }
 
-    // UA応答を待機（5秒タイムアウト）
-    if (!this->receiveFrameWithBitControl(50))
+    // UA応答を待機
+    uint32_t sentMicros = this->m_pinInterface.micros();
+    bool received = this->receiveFrameWithBitControl(this->responseTimeoutMs());
+    this->_recordResponseTime(sentMicros, received);
+    if (!received)
     {
         return false;
     }
+    return this->_handleUAResponse(extended);
+}
 
+bool HDLC::_handleUAResponse(bool extended)
+{
     // 受信フレームの検証
     uint8_t buffer[MAX_FRAME_SIZE];
     size_t receivedLength = this->readFrame(buffer, MAX_FRAME_SIZE);
 
-    if (receivedLength >= 3) // アドレス + コントロール + 最低限のCRC
+    if (receivedLength >= 2) // アドレス + コントロール（CRCは除去済み）
     {
-        // UAフレームかチェック（アドレスとコントロールフィールド）
-        if (buffer[0] == this->m_targetAddress && buffer[1] == CMD_UA)
+        // UAフレームかチェック（アドレスとコントロールフィールド、Fビットは問わない）
+        if (buffer[0] == this->m_session->address && (buffer[1] & ~POLL_FINAL_BIT) == CMD_UA)
         {
+            // 接続確立: シーケンス番号をリセット
+            this->m_session->linkState = LINK_CONNECTED;
+            this->m_session->sendSequence = 0;
+            this->m_session->receiveSequence = 0;
+            this->m_session->outstandingFrames = 0;
+            this->m_session->lastSeenMillis = this->m_pinInterface.millis();
+            this->m_session->extendedMode = extended;
+            this->m_session->compression = false;
             return true;
         }
     }
@@ -161,7 +281,7 @@ bool HDLC::sendSNRMAndWaitUA()
 
 bool HDLC::sendICommand(const uint8_t *data, size_t length)
 {
-    return this->sendICommand(data, length, 50);
+    return this->sendICommand(data, length, this->responseTimeoutMs());
 }
 
 bool HDLC::sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs)
@@ -171,10 +291,10 @@ bool HDLC::sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs)
         return false;
     }
 
-    // Iコマンドフレームの作成（送信シーケンス番号を含む）
-    uint8_t control = CMD_I | (this->m_sendSequence << 1); // 送信シーケンス番号をビット1-3に設定
+    // Iコマンドフレームの作成（N(S)、N(R)、Pビット）
     uint8_t iFrame[MAX_FRAME_SIZE];
-    size_t frameLength = this->_createHDLCFrame(this->m_targetAddress, control, data, length, iFrame, MAX_FRAME_SIZE);
+    size_t frameLength = this->_createSequencedFrame(CMD_I, this->m_session->sendSequence, true,
+                                                     data, length, iFrame, MAX_FRAME_SIZE);
 
     if (frameLength == 0)
     {
@@ -186,27 +306,36 @@ bool HDLC::sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs)
     {
         return false;
     }
+    this->m_session->outstandingFrames = 1;
 
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
     Serial.print("I-frame sent, waiting for response (timeout: ");
     Serial.print(timeoutMs);
     Serial.println("ms)");
 #endif
 
     // レスポンス待機（RRまたはREJフレーム）
-    if (!this->receiveFrameWithBitControl(timeoutMs))
+    uint32_t sentMicros = this->m_pinInterface.micros();
+    bool received = this->receiveFrameWithBitControl(timeoutMs);
+    this->_recordResponseTime(sentMicros, received);
+    if (!received)
     {
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
         Serial.println("Response timeout");
 #endif
         return false; // タイムアウト
     }
 
-    // レスポンスの検証
-    uint8_t responseBuffer[MAX_FRAME_SIZE];
-    size_t responseLength = this->readFrame(responseBuffer, MAX_FRAME_SIZE);
+    return this->_handleIResponse() == REQUEST_COMPLETED;
+}
+
+HDLC::RequestStatus HDLC::_handleIResponse()
+{
+    // レスポンスの検証（Iフレームのデータは受信キューに残すため直接参照する）
+    const uint8_t *responseBuffer = this->m_frameQueue.data;
+    size_t responseLength = this->m_frameQueue.length;
 
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
     Serial.print("Response length: ");
     Serial.println(responseLength);
     Serial.println("Response frame: ");
@@ -218,60 +347,78 @@ bool HDLC::sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs)
     Serial.println();
 #endif
 
-    if (responseLength >= 2) // アドレス + コントロール 最低限
+    ControlField response;
+    if (this->_parseControl(responseBuffer, responseLength, response))
     {
         uint8_t responseAddress = responseBuffer[0];
-        uint8_t responseControl = responseBuffer[1];
 
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
         Serial.print("Response received - Address: 0x");
         Serial.print(responseAddress, HEX);
         Serial.print(", Control: 0x");
-        Serial.println(responseControl, HEX);
+        Serial.println(responseBuffer[1], HEX);
 #endif
 
         // アドレスが一致するかチェック
-        if (responseAddress != this->m_targetAddress)
+        if (responseAddress != this->m_session->address)
         {
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
             Serial.println("Address mismatch in response");
 #endif
             // アドレス不一致は一旦無視
             // return false; // アドレス不一致
         }
 
+        // Iフレーム応答: N(R)で確認応答を兼ねる（ピギーバック）
+        if (response.format == FORMAT_I)
+        {
+            bool acknowledged = this->_acknowledge(response.receiveSequence);
+            if (response.sendSequence == this->m_session->receiveSequence)
+            {
+                // 次のコマンドのN(R)で相手局へ確認を返す
+                this->m_session->receiveSequence = (this->m_session->receiveSequence + 1) & this->_sequenceMask();
+            }
+            else
+            {
+                this->m_frameQueue.hasData = false; // 順序外のデータは破棄
+            }
+#if HDLC_SERIAL_TRACE
+            Serial.println("I-frame response received");
+#endif
+            return acknowledged ? REQUEST_COMPLETED : REQUEST_FAILED;
+        }
+
+        // S形式の応答はキューから取り除く
+        this->m_frameQueue.hasData = false;
+
         // RRフレーム（正常応答）かチェック
-        if (this->_isRRFrame(responseControl))
+        if (response.format == FORMAT_S && response.command == CMD_RR)
         {
-            // 受信シーケンス番号を確認
-            uint8_t receivedSeq = this->_extractSequenceNumber(responseControl);
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
             Serial.print("RR frame received, sequence: ");
-            Serial.print(receivedSeq);
+            Serial.print(response.receiveSequence);
             Serial.print(", expected: ");
-            Serial.println(this->m_sendSequence);
+            Serial.println((this->m_session->sendSequence + 1) & this->_sequenceMask());
 #endif
-
-            if (receivedSeq == this->m_sendSequence)
+            // N(R)が送信したIフレームの次の番号なら確認応答
+            if (this->_acknowledge(response.receiveSequence))
             {
-                // 送信シーケンス番号を次に進める（0-7で循環）
-                this->m_sendSequence = (this->m_sendSequence + 1) & 0x07;
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
                 Serial.println("I-frame acknowledged successfully");
 #endif
-                return true; // 正常応答
+                return REQUEST_COMPLETED; // 正常応答
             }
         }
         // REJフレーム（再送要求）かチェック
-        else if (this->_isREJFrame(responseControl))
+        else if (response.format == FORMAT_S && response.command == CMD_REJ)
         {
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
             Serial.println("REJ frame received (retransmission required)");
 #endif
-            // REJフレームの場合は再送が必要だが、ここでは失敗として扱う
-            return false; // 再送要求（エラー扱い）
+            // 再送は呼び出し側で行う
+            return REQUEST_REJECTED;
         }
-#ifndef NATIVE_TEST
+#if HDLC_SERIAL_TRACE
         else
         {
             Serial.println("Unknown response frame type");
@@ -280,303 +427,2064 @@ bool HDLC::sendICommand(const uint8_t *data, size_t length, uint32_t timeoutMs)
     }
     else
     {
-#ifndef NATIVE_TEST
+        this->m_frameQueue.hasData = false;
+#if HDLC_SERIAL_TRACE
         Serial.println("Invalid response length");
 #endif
     }
 
-    return false; // 不正なレスポンス
+    return REQUEST_FAILED; // 不正なレスポンス
 }
 
-void HDLC::setAddress(uint8_t address)
+bool HDLC::_acknowledge(uint8_t receiveSequence)
 {
-    this->m_targetAddress = address;
+    // N(R)と未確認の先頭N(S)との差が新たに確認されたフレーム数
+    uint8_t acknowledged = (receiveSequence - this->m_session->sendSequence) & this->_sequenceMask();
+    if (acknowledged == 0 || acknowledged > this->m_session->outstandingFrames)
+    {
+        return false;
+    }
+
+    this->m_session->sendSequence = receiveSequence;
+    this->m_session->outstandingFrames -= acknowledged;
+    this->m_session->lastSeenMillis = this->m_pinInterface.millis();
+    if (this->m_role == ROLE_SECONDARY)
+    {
+        this->m_pendingLength = 0;
+    }
+    return true;
 }
 
-bool HDLC::receiveFrameWithBitControl(uint32_t timeoutMs)
+size_t HDLC::sendIFrames(const uint8_t *const *payloads, const size_t *lengths, size_t count,
+                         uint8_t maxRetries)
 {
-    if (!this->m_initialized)
+    if (!this->m_initialized || !payloads || !lengths || count == 0)
     {
-        return false;
+        return 0;
     }
 
-    // 受信状態を初期化
-    this->_initializeReceiveState();
-    this->_enableReceive();
+    uint8_t mask = this->_sequenceMask();
+    uint8_t window = this->m_windowSize < mask ? this->m_windowSize : mask;
+    size_t confirmed = 0;
+    uint8_t retries = 0;
+    this->m_session->outstandingFrames = 0;
 
-    uint32_t startTime = this->m_pinInterface.millis();
-    uint32_t bitStartTime;
-    ReceiveContext context;
-    this->_initializeReceiveContext(context);
+    while (confirmed < count)
+    {
+        // ウィンドウが埋まるまでバーストに詰め、最後のフレームでPビットを立てる
+        uint8_t burst[HDLC_BURST_BUFFER_SIZE];
+        size_t burstLengths[HDLC_BURST_BUFFER_SIZE / 4]; // フレームは最短4バイト
+        size_t burstUsed = 0;
+        size_t burstCount = 0;
+        while (this->m_session->outstandingFrames < window &&
+               confirmed + this->m_session->outstandingFrames < count)
+        {
+            size_t index = confirmed + this->m_session->outstandingFrames;
+            uint8_t sendSequence = (this->m_session->sendSequence + this->m_session->outstandingFrames) & mask;
+            bool poll = (this->m_session->outstandingFrames + 1 == window) || (index + 1 == count);
+
+            size_t room = sizeof(burst) - burstUsed;
+            size_t frameLength = this->_createSequencedFrame(CMD_I, sendSequence, poll, payloads[index], lengths[index],
+                                                             burst + burstUsed, room < MAX_FRAME_SIZE ? room : MAX_FRAME_SIZE);
+            if (frameLength == 0 && burstCount > 0)
+            {
+                // バッファが一杯: ここまでを送信して詰め直す
+                if (!this->_transmitFrames(burst, burstLengths, burstCount))
+                {
+                    this->m_session->outstandingFrames = 0;
+                    return confirmed;
+                }
+                burstUsed = 0;
+                burstCount = 0;
+                frameLength = this->_createSequencedFrame(CMD_I, sendSequence, poll, payloads[index], lengths[index],
+                                                          burst, MAX_FRAME_SIZE);
+            }
+            if (frameLength == 0)
+            {
+                this->m_session->outstandingFrames = 0;
+                return confirmed;
+            }
+            burstLengths[burstCount++] = frameLength;
+            burstUsed += frameLength;
+            this->m_session->outstandingFrames++;
+        }
+        if (burstCount > 0 && !this->_transmitFrames(burst, burstLengths, burstCount))
+        {
+            this->m_session->outstandingFrames = 0;
+            return confirmed;
+        }
 
-    while ((this->m_pinInterface.millis() - startTime) < timeoutMs)
+        // Pビットに対する応答を待つ
+        ControlField response;
+        uint32_t sentMicros = this->m_pinInterface.micros();
+        bool received = this->receiveFrameWithBitControl(this->responseTimeoutMs());
+        this->_recordResponseTime(sentMicros, received);
+        bool answered = received &&
+                        this->m_frameQueue.data[0] == this->m_session->address &&
+                        this->_parseControl(this->m_frameQueue.data, this->m_frameQueue.length, response) &&
+                        response.format != FORMAT_U;
+        // 応答のIフレームは受理しない（V(R)を進めないので相手局が再送する）
+        this->m_frameQueue.hasData = false;
+
+        bool progressed = false;
+        if (answered)
+        {
+            uint8_t before = this->m_session->outstandingFrames;
+            progressed = this->_acknowledge(response.receiveSequence);
+            confirmed += before - this->m_session->outstandingFrames;
+        }
+        if (this->m_session->outstandingFrames > 0)
+        {
+            // REJ・一部未確認・無応答: 未確認の先頭から再送（Go-Back-N）
+            this->m_session->outstandingFrames = 0;
+            if (!progressed && ++retries > maxRetries)
+            {
+                break;
+            }
+        }
+        if (progressed)
+        {
+            retries = 0;
+        }
+    }
+    return confirmed;
+}
+
+void HDLC::setAddress(uint8_t address)
+{
+    this->m_session->address = address;
+    if (this->m_role == ROLE_SECONDARY)
     {
-        bitStartTime = this->m_pinInterface.micros();
-        uint8_t bit = this->_readBit();
+        this->_precomputeResponses();
+    }
+}
 
-#ifndef NATIVE_TEST
-        Serial.print("Received bit: ");
-        Serial.println(bit);
-#endif
+void HDLC::acceptAddress(uint8_t address, bool accept)
+{
+    uint8_t mask = (uint8_t)(1 << (address & 0x07));
+    if (accept)
+    {
+        this->m_acceptMap[address >> 3] |= mask;
+    }
+    else
+    {
+        this->m_acceptMap[address >> 3] &= (uint8_t)~mask;
+    }
+}
 
-        // フラグシーケンス検出処理
-        this->_processReceivedBit(bit, context);
+void HDLC::clearAcceptedAddresses()
+{
+    memset(this->m_acceptMap, 0, sizeof(this->m_acceptMap));
+}
 
-        // フレーム処理が完了した場合
-        if (context.frameComplete)
-        {
-            return true;
-        }
+void HDLC::resetReceiveStatistics()
+{
+    memset(&this->m_receiveStatistics, 0, sizeof(this->m_receiveStatistics));
+    this->m_tuneValidBase = 0;
+    this->m_tuneErrorBase = 0;
+}
 
-        // 経過時間を考慮したビット待機
-        uint32_t elapsedMicros = this->m_pinInterface.micros() - bitStartTime;
-        this->_waitBitTime(elapsedMicros);
+void HDLC::setRole(Role role)
+{
+    this->m_role = role;
+    if (role == ROLE_SECONDARY)
+    {
+        this->_precomputeResponses();
     }
+}
 
-    return false;
+HDLC::LinkConfig HDLC::getLinkConfig() const
+{
+    LinkConfig config;
+    config.address = this->m_session->address;
+    config.role = this->m_role;
+    config.baudRate = this->m_baudRate;
+    config.maxBaudRate = this->m_maxBaudRate;
+    config.responseTimeoutMs = this->m_responseTimeoutMs;
+    config.adaptiveTimeout = this->m_adaptiveTimeout;
+    config.windowSize = this->m_windowSize;
+    config.extendedMode = this->m_extendedRequested;
+    config.lineCoding = this->m_lineCoding;
+    return config;
 }
 
-void HDLC::_initializeReceiveState()
+void HDLC::applyLinkConfig(const LinkConfig &config)
 {
-    this->m_receiveIndex = 0;
-    this->m_currentByte = 0;
-    this->m_bitCount = 0;
-    this->m_consecutiveOnes = 0;
-    this->m_frameQueue.hasData = false;
+    this->m_session->address = config.address;
+    this->setRole(config.role); // 二次局の応答フレームはアドレス設定後に作成
+    this->setBaudRate(config.baudRate);
+    this->setMaxBaudRate(config.maxBaudRate);
+    this->m_responseTimeoutMs = config.responseTimeoutMs;
+    this->m_adaptiveTimeout = config.adaptiveTimeout;
+    this->setWindowSize(config.windowSize);
+    this->m_extendedRequested = HDLC_ENABLE_EXTENDED_MODE && config.extendedMode;
+    this->m_lineCoding = config.lineCoding;
 }
 
-void HDLC::_initializeReceiveContext(ReceiveContext &context)
+bool HDLC::saveLinkConfig()
 {
-    context.flagBuffer = 0;
-    context.flagBitCount = 0;
-    context.inFrame = false;
-    context.rawBitIndex = 0;
-    context.frameComplete = false;
-    // rawDataをゼロ初期化
-    memset(context.rawData, 0, sizeof(context.rawData));
+    if (!this->m_configStorage)
+    {
+        return false;
+    }
+
+    uint8_t encoded[LINK_CONFIG_SIZE];
+    HDLC::encodeLinkConfig(this->getLinkConfig(), encoded);
+
+    // 同じ内容なら書き込まない（EEPROM/フラッシュの書き換え回数の節約）
+    uint8_t stored[LINK_CONFIG_SIZE];
+    if (this->m_configStorage->read(stored, sizeof(stored)) && memcmp(stored, encoded, sizeof(encoded)) == 0)
+    {
+        return true;
+    }
+    return this->m_configStorage->write(encoded, sizeof(encoded));
 }
 
-void HDLC::_processReceivedBit(uint8_t bit, ReceiveContext &context)
+void HDLC::encodeLinkConfig(const LinkConfig &config, uint8_t *out)
 {
-    // フラグシーケンス検出
-    this->_updateFlagDetection(bit, context);
+    out[0] = LINK_CONFIG_MAGIC[0];
+    out[1] = LINK_CONFIG_MAGIC[1];
+    out[2] = LINK_CONFIG_VERSION;
+    out[3] = config.address;
+    out[4] = (uint8_t)config.role;
+    putLE32(out + 5, config.baudRate);
+    putLE32(out + 9, config.maxBaudRate);
+    putLE32(out + 13, config.responseTimeoutMs);
+    out[17] = (config.adaptiveTimeout ? LINK_CONFIG_ADAPTIVE_TIMEOUT : 0) |
+              (config.extendedMode ? LINK_CONFIG_EXTENDED_MODE : 0) |
+              (config.lineCoding == LINE_NRZI ? LINK_CONFIG_NRZI : 0);
+    out[18] = config.windowSize;
+
+    uint16_t crc = HDLC::calculateCRC16(out, LINK_CONFIG_SIZE - 2);
+    out[LINK_CONFIG_SIZE - 2] = (crc >> 8) & 0xFF;
+    out[LINK_CONFIG_SIZE - 1] = crc & 0xFF;
+}
 
-    if (this->_isFlagSequence(context))
+bool HDLC::decodeLinkConfig(const uint8_t *data, LinkConfig &config)
+{
+    if (data[0] != LINK_CONFIG_MAGIC[0] || data[1] != LINK_CONFIG_MAGIC[1] || data[2] != LINK_CONFIG_VERSION)
     {
-        this->_handleFlagSequence(context);
+        return false;
     }
-    else if (context.inFrame)
+    uint16_t storedCRC = ((uint16_t)data[LINK_CONFIG_SIZE - 2] << 8) | data[LINK_CONFIG_SIZE - 1];
+    if (storedCRC != HDLC::calculateCRC16(data, LINK_CONFIG_SIZE - 2))
     {
-        this->_storeBitInFrame(bit, context);
+        return false;
+    }
+    if (data[4] > ROLE_SECONDARY || getLE32(data + 5) == 0 || data[18] == 0)
+    {
+        return false;
     }
+
+    config.address = data[3];
+    config.role = (Role)data[4];
+    config.baudRate = getLE32(data + 5);
+    config.maxBaudRate = getLE32(data + 9);
+    config.responseTimeoutMs = getLE32(data + 13);
+    config.adaptiveTimeout = (data[17] & LINK_CONFIG_ADAPTIVE_TIMEOUT) != 0;
+    config.extendedMode = (data[17] & LINK_CONFIG_EXTENDED_MODE) != 0;
+    config.lineCoding = (data[17] & LINK_CONFIG_NRZI) ? LINE_NRZI : LINE_NRZ;
+    config.windowSize = data[18];
+    return true;
 }
 
-void HDLC::_updateFlagDetection(uint8_t bit, ReceiveContext &context)
+bool HDLC::queueResponseData(const uint8_t *data, size_t length)
 {
-    context.flagBuffer = (context.flagBuffer << 1) | bit;
-    context.flagBitCount++;
-    if (context.flagBitCount > 8)
+    // アドレス + コントロール(最大2) + CRC(2) の分を残す
+    if (!data || length == 0 || length > MAX_FRAME_SIZE - 5 || this->m_pendingLength > 0)
     {
-        context.flagBitCount = 8;
+        return false;
     }
+    memcpy(this->m_pendingData, data, length);
+    this->m_pendingLength = length;
+    return true;
 }
 
-bool HDLC::_isFlagSequence(const ReceiveContext &context)
+void HDLC::_transmitPendingResponse()
 {
-    const uint8_t FLAG_SEQUENCE = 0x7E; // 01111110
-    return (context.flagBuffer == FLAG_SEQUENCE && context.flagBitCount >= 8);
+    // N(R)は送信時点のV(R)を使うため毎回作成する（未確認なら同じN(S)で再送）
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t frameLength = this->_createSequencedFrame(CMD_I, this->m_session->sendSequence, true, this->m_pendingData,
+                                                     this->m_pendingLength, frame, MAX_FRAME_SIZE);
+    if (frameLength > 0 && this->_transmitFrame(frame, frameLength))
+    {
+        this->m_session->outstandingFrames = 1;
+    }
 }
 
-void HDLC::_handleFlagSequence(ReceiveContext &context)
+void HDLC::_transmitSupervisoryResponse(bool reject)
 {
-    if (!context.inFrame)
+    if (!this->_isExtended())
     {
-        // フレーム開始
-        this->_startFrame(context);
+        const uint8_t *response = reject ? this->m_rejResponses[this->m_session->receiveSequence]
+                                         : this->m_rrResponses[this->m_session->receiveSequence];
+        this->_transmitFrame(response, RESPONSE_FRAME_SIZE);
+        return;
     }
-    else
+
+    // 拡張モードはN(R)が128通りあるため都度作成する
+    uint8_t frame[RESPONSE_FRAME_SIZE + 1];
+    size_t frameLength = this->_createSequencedFrame(reject ? CMD_REJ : CMD_RR, 0, true,
+                                                     nullptr, 0, frame, sizeof(frame));
+    this->_transmitFrame(frame, frameLength);
+}
+
+void HDLC::_precomputeResponses()
+{
+    // 応答は常に1フレームで送信権を返すためFビットを立てる
+    uint8_t address = this->m_session->address;
+    this->_createHDLCFrame(address, CMD_UA | POLL_FINAL_BIT, nullptr, 0,
+                           this->m_uaResponse, RESPONSE_FRAME_SIZE);
+    for (uint8_t nr = 0; nr < 8; nr++)
     {
-        // フレーム終了
-        this->_endFrame(context);
+        uint8_t sequenceBits = (uint8_t)(nr << 5);
+        this->_createHDLCFrame(address, CMD_RR | POLL_FINAL_BIT | sequenceBits, nullptr, 0,
+                               this->m_rrResponses[nr], RESPONSE_FRAME_SIZE);
+        this->_createHDLCFrame(address, CMD_REJ | POLL_FINAL_BIT | sequenceBits, nullptr, 0,
+                               this->m_rejResponses[nr], RESPONSE_FRAME_SIZE);
     }
 }
 
-void HDLC::_startFrame(ReceiveContext &context)
+bool HDLC::listen(uint32_t timeoutMs)
 {
-    context.inFrame = true;
-    context.rawBitIndex = 0;
-    this->m_consecutiveOnes = 0;
+    if (!this->m_initialized || this->m_role != ROLE_SECONDARY)
+    {
+        return false;
+    }
+
+    // 速度切り替えの確認待ち中は期限で受信を打ち切り、元の速度に戻す
+    uint32_t fallbackMs = this->_checkBaudFallback();
+    if (!this->receiveFrameWithBitControl(timeoutMs < fallbackMs ? timeoutMs : fallbackMs) ||
+        this->m_frameQueue.length < 2)
+    {
+        this->_checkBaudFallback();
+        return false;
+    }
+
+    bool accepted = this->_handleSecondaryFrame();
+    if (this->m_isTransmitting)
+    {
+        this->_enableReceive(); // 応答を送った後は受信に戻す
+    }
+    return accepted;
 }
 
-void HDLC::_endFrame(ReceiveContext &context)
-{
-    if (context.rawBitIndex > 0)
+bool HDLC::_handleSecondaryFrame()
+{
+    uint8_t address = this->m_frameQueue.data[0];
+    bool broadcast = (address == BROADCAST_ADDRESS);
+    if (address != this->m_session->address && !broadcast)
+    {
+        this->m_frameQueue.hasData = false; // 他局宛て
+        this->_checkBaudFallback();
+        return false;
+    }
+    this->m_session->lastSeenMillis = this->m_pinInterface.millis();
+    this->m_fallbackBaudRate = 0; // 新しい速度で受信できた
+
+    ControlField control;
+    if (!this->_parseControl(this->m_frameQueue.data, this->m_frameQueue.length, control))
+    {
+        this->m_frameQueue.hasData = false;
+        return false;
+    }
+
+    if (control.format == FORMAT_U &&
+        (control.command == CMD_SNRM || (HDLC_ENABLE_EXTENDED_MODE && control.command == CMD_SNRME)))
+    {
+        // 接続確立: シーケンス番号をリセットしてUAを返す
+        this->m_frameQueue.hasData = false;
+        this->m_session->linkState = LINK_CONNECTED;
+        this->m_session->sendSequence = 0;
+        this->m_session->receiveSequence = 0;
+        this->m_session->outstandingFrames = 0;
+        this->m_session->extendedMode = (control.command == CMD_SNRME);
+        this->m_session->compression = false;
+        if (!broadcast)
+        {
+            this->_transmitFrame(this->m_uaResponse, RESPONSE_FRAME_SIZE);
+        }
+        return false;
+    }
+
+    if (control.format == FORMAT_U && (control.command == CMD_XID || control.command == CMD_TEST))
+    {
+        // XID/TESTはリンク状態によらず応答する
+        this->m_frameQueue.hasData = false;
+        if (broadcast || !control.pollFinal)
+        {
+            return false;
+        }
+        const uint8_t *info = this->m_frameQueue.data + 2;
+        size_t infoLength = this->m_frameQueue.length - 2;
+        if (control.command == CMD_XID)
+        {
+            this->_answerXid(info, infoLength);
+        }
+        else
+        {
+            uint8_t frame[MAX_FRAME_SIZE];
+            size_t frameLength = this->_createHDLCFrame(address, CMD_TEST | POLL_FINAL_BIT, info, infoLength,
+                                                        frame, MAX_FRAME_SIZE);
+            this->_transmitFrame(frame, frameLength);
+        }
+        return false;
+    }
+
+    if (control.format == FORMAT_I)
+    {
+        if (this->m_session->linkState != LINK_CONNECTED)
+        {
+            this->m_frameQueue.hasData = false;
+            return false;
+        }
+
+        // 一次局のN(R)は順序外のIフレームでも有効
+        this->_acknowledge(control.receiveSequence);
+
+        bool inSequence = (control.sendSequence == this->m_session->receiveSequence);
+        if (inSequence)
+        {
+            this->m_session->receiveSequence = (this->m_session->receiveSequence + 1) & this->_sequenceMask();
+        }
+        else
+        {
+            this->m_frameQueue.hasData = false;
+        }
+        // ウィンドウ送信中はPビット付きのフレームにだけ応答する
+        if (!broadcast && control.pollFinal)
+        {
+            if (inSequence && this->m_pendingLength > 0)
+            {
+                this->_transmitPendingResponse(); // N(R)で受信確認を兼ねる
+            }
+            else
+            {
+                this->_transmitSupervisoryResponse(!inSequence);
+            }
+        }
+        return inSequence;
+    }
+
+    // RR(P)によるポーリングには送信データか現在のN(R)で応答
+    this->m_frameQueue.hasData = false;
+    if (control.format == FORMAT_S)
+    {
+        this->_acknowledge(control.receiveSequence);
+    }
+    if (control.format == FORMAT_S && control.command == CMD_RR && control.pollFinal && !broadcast)
+    {
+        if (this->m_pendingLength > 0)
+        {
+            this->_transmitPendingResponse();
+        }
+        else
+        {
+            this->_transmitSupervisoryResponse(false);
+        }
+    }
+    return false;
+}
+
+void HDLC::selectSession(StationSession *session)
+{
+    this->m_session = session ? session : &this->m_defaultSession;
+}
+
+void HDLC::initSession(StationSession &session, uint8_t address)
+{
+    session.address = address;
+    session.linkState = LINK_DISCONNECTED;
+    session.sendSequence = 0;
+    session.receiveSequence = 0;
+    session.outstandingFrames = 0;
+    session.lastSeenMillis = 0;
+    session.extendedMode = false;
+    session.srttMicros = 0;
+    session.rttVarMicros = 0;
+    session.timeoutBackoff = 0;
+    session.compression = false;
+}
+
+void HDLC::updateRttEstimate(StationSession &session, uint32_t sampleMicros)
+{
+    if (sampleMicros == 0)
+    {
+        sampleMicros = 1; // 0は未測定を表すため
+    }
+    if (session.srttMicros == 0)
+    {
+        session.srttMicros = sampleMicros;
+        session.rttVarMicros = sampleMicros / 2;
+    }
+    else
+    {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        uint32_t deviation = (session.srttMicros > sampleMicros) ? session.srttMicros - sampleMicros
+                                                                 : sampleMicros - session.srttMicros;
+        session.rttVarMicros = (3 * session.rttVarMicros + deviation) / 4;
+        session.srttMicros = (7 * session.srttMicros + sampleMicros) / 8;
+    }
+    session.timeoutBackoff = 0;
+}
+
+uint32_t HDLC::responseTimeoutMs() const
+{
+    const StationSession &session = *this->m_session;
+    uint32_t timeoutMs = this->m_responseTimeoutMs;
+    if (!this->m_adaptiveTimeout)
+    {
+        return timeoutMs; // 固定値（バックオフ・上限とも適用しない）
+    }
+    if (session.srttMicros > 0)
+    {
+        // 応答開始までの推定時間 + フラグ検出の余裕（16ビット時間）
+        uint32_t rtoMicros = session.srttMicros + 4 * session.rttVarMicros + 16 * this->m_bitTimeMicros;
+        timeoutMs = (rtoMicros + 999) / 1000 + 1; // millis()の分解能分を加える
+    }
+    timeoutMs <<= session.timeoutBackoff;
+    return (timeoutMs < MAX_RESPONSE_TIMEOUT_MS) ? timeoutMs : MAX_RESPONSE_TIMEOUT_MS;
+}
+
+void HDLC::_recordResponseTime(uint32_t sentMicros, bool received)
+{
+    if (!received)
+    {
+        if (this->m_session->timeoutBackoff < 6)
+        {
+            this->m_session->timeoutBackoff++;
+        }
+        return;
+    }
+
+    // 受信完了までの時間から応答フレーム自体の送信時間を除く
+    uint32_t elapsed = this->m_pinInterface.micros() - sentMicros;
+    uint32_t airtime = this->_airtimeMicros(this->m_frameQueue.length + 2); // CRC分
+    HDLC::updateRttEstimate(*this->m_session, elapsed > airtime ? elapsed - airtime : 0);
+}
+
+HDLC::PollResult HDLC::pollStation(uint32_t timeoutMs)
+{
+    if (!this->m_initialized)
+    {
+        return POLL_NO_RESPONSE;
+    }
+
+    // RR(P=1, N(R)=V(R))でポーリング
+    uint8_t rrFrame[MAX_FRAME_SIZE];
+    size_t frameLength = this->_createSequencedFrame(CMD_RR, 0, true, nullptr, 0, rrFrame, MAX_FRAME_SIZE);
+    if (frameLength == 0 || !this->_transmitFrame(rrFrame, frameLength))
+    {
+        return POLL_NO_RESPONSE;
+    }
+
+    uint32_t sentMicros = this->m_pinInterface.micros();
+    bool received = this->receiveFrameWithBitControl(timeoutMs ? timeoutMs : this->responseTimeoutMs());
+    if (!received)
+    {
+        this->_recordResponseTime(sentMicros, false);
+        return POLL_NO_RESPONSE;
+    }
+
+    // 他局のフレームは選択中のセッションに反映しない
+    ControlField response;
+    if (this->m_frameQueue.length < 2 || this->m_frameQueue.data[0] != this->m_session->address ||
+        !this->_parseControl(this->m_frameQueue.data, this->m_frameQueue.length, response))
+    {
+        return POLL_NO_RESPONSE;
+    }
+
+    this->_recordResponseTime(sentMicros, true);
+    this->m_session->lastSeenMillis = this->m_pinInterface.millis();
+
+    if (response.format == FORMAT_I)
+    {
+        this->_acknowledge(response.receiveSequence);
+        if (response.sendSequence == this->m_session->receiveSequence)
+        {
+            this->m_session->receiveSequence = (this->m_session->receiveSequence + 1) & this->_sequenceMask();
+            return POLL_DATA; // フレームはキューに残す
+        }
+        // 順序外のIフレームは破棄（次のポーリングのN(R)で再送を促す）
+        this->m_frameQueue.hasData = false;
+        return POLL_READY;
+    }
+
+    // S形式の応答はキューから取り除く
+    this->m_frameQueue.hasData = false;
+    if (response.format == FORMAT_S)
+    {
+        this->_acknowledge(response.receiveSequence);
+        if (response.command == CMD_REJ)
+        {
+            return POLL_REJECTED;
+        }
+    }
+    return POLL_READY;
+}
+
+HDLC::RequestHandle HDLC::connect()
+{
+    if (this->m_requestCount >= HDLC_ASYNC_QUEUE_SIZE)
+    {
+        return INVALID_HANDLE;
+    }
+    AsyncRequest &request = this->m_requests[(this->m_requestHead + this->m_requestCount) % HDLC_ASYNC_QUEUE_SIZE];
+    request.handle = this->m_nextHandle;
+    request.type = REQUEST_CONNECT;
+    request.session = this->m_session;
+    request.data = nullptr;
+    request.length = 0;
+    request.extended = HDLC_ENABLE_EXTENDED_MODE && this->m_extendedRequested;
+    this->m_requestCount++;
+    this->m_nextHandle = (this->m_nextHandle == 0xFF) ? 1 : this->m_nextHandle + 1;
+    return request.handle;
+}
+
+HDLC::RequestHandle HDLC::submitI(const uint8_t *data, size_t length)
+{
+    if (!data || length == 0 || length > MAX_FRAME_SIZE - 5 || this->m_requestCount >= HDLC_ASYNC_QUEUE_SIZE)
+    {
+        return INVALID_HANDLE;
+    }
+    AsyncRequest &request = this->m_requests[(this->m_requestHead + this->m_requestCount) % HDLC_ASYNC_QUEUE_SIZE];
+    request.handle = this->m_nextHandle;
+    request.type = REQUEST_I;
+    request.session = this->m_session;
+    request.data = data;
+    request.length = length;
+    request.extended = false;
+    this->m_requestCount++;
+    this->m_nextHandle = (this->m_nextHandle == 0xFF) ? 1 : this->m_nextHandle + 1;
+    return request.handle;
+}
+
+bool HDLC::isPending(RequestHandle handle) const
+{
+    for (size_t i = 0; i < this->m_requestCount; i++)
+    {
+        if (this->m_requests[(this->m_requestHead + i) % HDLC_ASYNC_QUEUE_SIZE].handle == handle)
+        {
+            return handle != INVALID_HANDLE;
+        }
+    }
+    return false;
+}
+
+bool HDLC::hasPendingRequests(const StationSession *session) const
+{
+    for (size_t i = 0; i < this->m_requestCount; i++)
+    {
+        if (this->m_requests[(this->m_requestHead + i) % HDLC_ASYNC_QUEUE_SIZE].session == session)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HDLC::setCompletionCallback(CompletionCallback callback, void *context)
+{
+    this->m_completionCallback = callback;
+    this->m_completionContext = context;
+}
+
+bool HDLC::_startRequest(const AsyncRequest &request)
+{
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t frameLength;
+    if (request.type == REQUEST_CONNECT)
+    {
+        frameLength = this->_createHDLCFrame(this->m_session->address, request.extended ? CMD_SNRME : CMD_SNRM,
+                                             nullptr, 0, frame, MAX_FRAME_SIZE);
+    }
+    else
+    {
+        frameLength = this->_createSequencedFrame(CMD_I, this->m_session->sendSequence, true,
+                                                  request.data, request.length, frame, MAX_FRAME_SIZE);
+    }
+    if (frameLength == 0 || !this->_transmitFrame(frame, frameLength))
+    {
+        return false;
+    }
+    if (request.type == REQUEST_I)
+    {
+        this->m_session->outstandingFrames = 1;
+    }
+
+    this->m_asyncSentMicros = this->m_pinInterface.micros();
+    this->_initializeReceiveState();
+    this->_enableReceive();
+    this->m_asyncStartMillis = this->m_pinInterface.millis();
+    this->m_asyncTimeoutMs = this->responseTimeoutMs();
+    this->m_asyncState = ASYNC_WAIT_RESPONSE;
+    return true;
+}
+
+void HDLC::_completeRequest(RequestStatus status)
+{
+    RequestHandle handle = this->m_requests[this->m_requestHead].handle;
+    this->m_requestHead = (this->m_requestHead + 1) % HDLC_ASYNC_QUEUE_SIZE;
+    this->m_requestCount--;
+    this->m_asyncState = ASYNC_IDLE;
+    if (this->m_completionCallback)
+    {
+        this->m_completionCallback(handle, status, this->m_completionContext);
+    }
+}
+
+bool HDLC::service()
+{
+    if (!this->m_initialized)
+    {
+        return false;
+    }
+
+    if (this->m_requestCount == 0)
+    {
+        // 要求外のフレーム（二次局へのコマンド、ブロードキャスト等）を受信
+        if (this->m_role == ROLE_SECONDARY)
+        {
+            this->_checkBaudFallback();
+        }
+        if (this->_receiveAvailableFrame() &&
+            this->m_role == ROLE_SECONDARY && this->m_frameQueue.length >= 2)
+        {
+            this->_handleSecondaryFrame();
+            if (this->m_isTransmitting)
+            {
+                this->_enableReceive(); // 応答を送った後は受信に戻す
+            }
+        }
+        this->_dispatchReceivedFrames();
+        return false;
+    }
+
+    // 要求のセッションで処理し、呼び出し側の選択は戻す
+    StationSession *selected = this->m_session;
+    const AsyncRequest &request = this->m_requests[this->m_requestHead];
+    this->m_session = request.session;
+
+    bool finished = false;
+    RequestStatus status = REQUEST_FAILED;
+    if (this->m_asyncState == ASYNC_IDLE)
+    {
+        // 先頭の要求を送信（フレームの送信中は戻らない）
+        finished = !this->_startRequest(request);
+    }
+    else if (this->_receiveAvailableFrame())
+    {
+        if (this->m_frameQueue.length < 2 || this->m_frameQueue.data[0] != request.session->address)
+        {
+            // 他局のフレームは応答ではない（受信コールバックには渡す）。タイムアウトまで待ち続ける
+            this->m_frameQueue.hasData = false;
+        }
+        else
+        {
+            this->_recordResponseTime(this->m_asyncSentMicros, true);
+            if (request.type == REQUEST_CONNECT)
+            {
+                status = this->_handleUAResponse(request.extended) ? REQUEST_COMPLETED : REQUEST_FAILED;
+            }
+            else
+            {
+                status = this->_handleIResponse();
+            }
+            finished = true;
+        }
+    }
+    if (!finished && this->m_asyncState == ASYNC_WAIT_RESPONSE &&
+        (this->m_pinInterface.millis() - this->m_asyncStartMillis) >= this->m_asyncTimeoutMs)
+    {
+        this->_recordResponseTime(this->m_asyncSentMicros, false);
+        status = REQUEST_TIMEOUT;
+        finished = true;
+    }
+
+    this->m_session = selected;
+    this->_dispatchReceivedFrames();
+    if (finished)
+    {
+        this->_completeRequest(status);
+    }
+    return this->m_requestCount > 0;
+}
+
+bool HDLC::_receiveAvailableFrame()
+{
+    if (this->m_byteStream)
+    {
+        return this->_pollByteStream();
+    }
+    if (this->m_resumeAfterFlag)
+    {
+        // 前回はフラグの直後で戻った: 次の標本点を半ビット以上過ぎていなければ続きを受信する
+        this->m_resumeAfterFlag = false;
+        if ((this->m_pinInterface.micros() - this->m_resumeMicros) < this->m_halfBitTimeMicros)
+        {
+            return this->_receiveAfterFlag();
+        }
+    }
+    return this->_readLevel() == 0 && this->_receiveStartedFrame();
+}
+
+bool HDLC::_receiveStartedFrame()
+{
+    // アイドル(1)の回線に0: 開始フラグの先頭。半ビット待ってビット中央から受信する
+    // （NRZIではアイドルからの反転が先頭の0になる）
+    this->_waitHalfBitTime();
+    this->m_rxLevel = 1;
+    this->_initializeReceiveState();
+    ReceiveContext context;
+    this->_initializeReceiveContext(context);
+    return this->_receiveBits(context, 0, true);
+}
+
+bool HDLC::_receiveAfterFlag()
+{
+    // 直前のフラグの後から: フラグ検出の履歴と回線レベル（NRZI）は引き継ぐ
+    this->_initializeReceiveState();
+    ReceiveContext context;
+    this->_initializeReceiveContext(context);
+    context.flagBuffer = 0x7E;
+    context.flagBitCount = 8;
+    this->_startFrame(context);
+    return this->_receiveBits(context, 0, true);
+}
+
+void HDLC::_queueReceivedFrame(const uint8_t *frame, size_t length, bool valid)
+{
+    if ((uint8_t)(this->m_receiveHead - this->m_receiveTail) >= HDLC_RX_QUEUE_SLOTS)
+    {
+        this->m_receiveStatistics.overrunFrames++;
+        return;
+    }
+    ReceiveSlot &slot = this->m_receiveSlots[this->m_receiveHead % HDLC_RX_QUEUE_SLOTS];
+    memcpy(slot.data, frame, length);
+    slot.length = length;
+    slot.valid = valid;
+    this->m_receiveHead = this->m_receiveHead + 1; // スロットを書き終えてから公開する
+}
+
+void HDLC::_dispatchReceivedFrames()
+{
+    while (this->m_receiveTail != this->m_receiveHead)
+    {
+        const ReceiveSlot &slot = this->m_receiveSlots[this->m_receiveTail % HDLC_RX_QUEUE_SLOTS];
+        if (this->m_receiveCallback)
+        {
+            this->m_receiveCallback(slot.data, slot.length, slot.valid);
+        }
+        this->m_receiveTail = this->m_receiveTail + 1; // コールバックから戻ってからスロットを返す
+    }
+}
+
+void HDLC::setFrameLogger(IFrameLogger *logger)
+{
+    this->m_frameLogger = logger;
+}
+
+bool HDLC::receiveFrameWithBitControl(uint32_t timeoutMs)
+{
+    if (!this->m_initialized)
+    {
+        return false;
+    }
+
+    if (this->m_autoBaud && !this->m_baudLocked)
+    {
+        // 速度が未確定: 回線上のフラグから検出して切り替える
+        uint32_t baudRate = this->detectBaudRate(timeoutMs);
+        if (baudRate == 0)
+        {
+            return false;
+        }
+        this->setBaudRate(baudRate);
+        this->m_baudLocked = true;
+        this->m_autoBaudFailures = 0;
+    }
+
+    uint32_t errorsBefore = this->m_receiveStatistics.crcErrors + this->m_receiveStatistics.abortedFrames +
+                            this->m_receiveStatistics.oversizeFrames;
+    bool received = this->_receiveFrame(timeoutMs);
+    if (this->m_autoBaud)
+    {
+        uint32_t errorsAfter = this->m_receiveStatistics.crcErrors + this->m_receiveStatistics.abortedFrames +
+                               this->m_receiveStatistics.oversizeFrames;
+        if (received)
+        {
+            this->m_autoBaudFailures = 0;
+        }
+        else if (errorsAfter != errorsBefore && ++this->m_autoBaudFailures >= AUTOBAUD_MAX_FAILURES)
+        {
+            this->m_baudLocked = false; // 速度が合っていない可能性があるので再検出
+        }
+    }
+    return received;
+}
+
+bool HDLC::_receiveFrame(uint32_t timeoutMs)
+{
+    if (this->m_byteStream)
+    {
+        // 受信途中のフレームは持ち越すため、状態は初期化しない
+        this->_enableReceive();
+        uint32_t startTime = this->m_pinInterface.millis();
+        do
+        {
+            if (this->_pollByteStream())
+            {
+                return true;
+            }
+            this->m_pinInterface.delayMicroseconds(this->m_bitTimeMicros * 10); // 1文字分
+        } while ((this->m_pinInterface.millis() - startTime) < timeoutMs);
+        return false;
+    }
+
+    // 受信状態を初期化
+    this->_initializeReceiveState();
+    this->_enableReceive();
+    this->m_rxLevel = this->_readLevel();
+
+    ReceiveContext context;
+    this->_initializeReceiveContext(context);
+    return this->_receiveBits(context, timeoutMs, false);
+}
+
+bool HDLC::_receiveBits(ReceiveContext &context, uint32_t timeoutMs, bool startedFrame)
+{
+    // タイムアウト後に受信を続けるのは最大長のフレームの送信時間まで
+    const size_t maxExtraBits = sizeof(context.rawData) * 8 + FRAME_HUNT_BITS;
+    uint32_t startTime = this->m_pinInterface.millis();
+    uint32_t bitStartTime;
+    bool resumed = context.inFrame; // _receiveAfterFlag(): 最初の標本点は前回から決まっている
+    size_t extraBits = 0;           // タイムアウト後に受信したビット数
+    size_t huntBits = 0;            // フレームのデータが無い間に受信したビット数
+    this->m_resumeAfterFlag = false;
+
+    for (;;)
+    {
+        // タイムアウト後は受信途中のフレームだけを完了まで受信する。開始したフレームは
+        // 開始フラグの後のオクテットまで待つが、フラグフィル・0固定・アイドルの回線ではすぐに戻る
+        if ((this->m_pinInterface.millis() - startTime) >= timeoutMs)
+        {
+            bool hunting = huntBits < FRAME_HUNT_BITS || (context.inFrame && context.rawBitIndex > 0);
+            bool receiving = this->_hasFrameData(context) ||
+                             (startedFrame && hunting && context.lineOnes < IDLE_ONES);
+            if (!receiving || extraBits >= maxExtraBits)
+            {
+                // フラグの直後（ここは次のビットの標本点）なら、次のservice()で続きを受信できる
+                if (startedFrame && context.inFrame && context.rawBitIndex == 0)
+                {
+                    this->m_resumeAfterFlag = true;
+                    this->m_resumeMicros = this->m_pinInterface.micros();
+                }
+                break;
+            }
+            extraBits++;
+        }
+
+        bitStartTime = resumed ? this->m_resumeMicros : this->m_pinInterface.micros();
+        resumed = false;
+        uint8_t bit = this->_readBit();
+
+#if HDLC_SERIAL_TRACE
+        Serial.print("Received bit: ");
+        Serial.println(bit);
+#endif
+
+        // フラグシーケンス検出処理
+        this->_processReceivedBit(bit, context);
+        if (!this->_hasFrameData(context))
+        {
+            huntBits++;
+        }
+
+        // フレーム処理が完了した場合
+        if (context.frameComplete)
+        {
+            return true;
+        }
+
+        // 破損フレームの後に回線がアイドルになった場合は応答が来ないので打ち切る
+        if (context.frameDropped && context.lineOnes >= IDLE_ONES)
+        {
+            return false;
+        }
+
+        if (this->m_lineCoding == LINE_NRZI)
+        {
+            this->_waitBitTimeWithResync(bitStartTime);
+            continue;
+        }
+
+        // 経過時間を考慮したビット待機
+        uint32_t elapsedMicros = this->m_pinInterface.micros() - bitStartTime;
+        this->_waitBitTime(elapsedMicros);
+    }
+
+    return false;
+}
+
+void HDLC::_initializeReceiveState()
+{
+    this->m_receiveIndex = 0;
+    this->m_currentByte = 0;
+    this->m_bitCount = 0;
+    this->m_consecutiveOnes = 0;
+    this->m_frameQueue.hasData = false;
+}
+
+void HDLC::_initializeReceiveContext(ReceiveContext &context)
+{
+    context.flagBuffer = 0;
+    context.flagBitCount = 0;
+    context.inFrame = false;
+    context.rawBitIndex = 0;
+    context.frameComplete = false;
+    context.addressByte = 0;
+    context.addressBitCount = 0;
+    context.addressOnes = 0;
+    context.lineOnes = 0;
+    context.stuffedBits = 0;
+    context.frameDropped = false;
+    // rawDataをゼロ初期化
+    memset(context.rawData, 0, sizeof(context.rawData));
+}
+
+void HDLC::_processReceivedBit(uint8_t bit, ReceiveContext &context)
+{
+    uint8_t previousOnes = context.lineOnes;
+    if (bit)
+    {
+        if (context.lineOnes < 255)
+        {
+            context.lineOnes++;
+        }
+    }
+    else
+    {
+        context.lineOnes = 0;
+    }
+
+    // フラグシーケンス検出
+    this->_updateFlagDetection(bit, context);
+
+    if (context.lineOnes == ABORT_ONES && context.inFrame)
+    {
+        if (this->_hasFrameData(context))
+        {
+            // アボート: 受信途中のフレームを即座に破棄
+            this->m_receiveStatistics.abortedFrames++;
+            this->_dropFrame(context);
+        }
+        else
+        {
+            // フラグの後のアイドル（無効・他局宛てフレームの終了フラグを含む）: フラグ探索に戻る
+            context.inFrame = false;
+            context.rawBitIndex = 0;
+        }
+    }
+    if (context.lineOnes == IDLE_ONES)
+    {
+        this->m_receiveStatistics.idleDetections++;
+    }
+
+    if (this->_isFlagSequence(context))
+    {
+        this->_handleFlagSequence(context);
+    }
+    else if (context.inFrame && this->_filterAddressBit(bit, context))
+    {
+        if (!bit && previousOnes == 5)
+        {
+            context.stuffedBits++;
+        }
+        this->_storeBitInFrame(bit, context);
+    }
+}
+
+void HDLC::_updateFlagDetection(uint8_t bit, ReceiveContext &context)
+{
+    context.flagBuffer = (context.flagBuffer << 1) | bit;
+    context.flagBitCount++;
+    if (context.flagBitCount > 8)
+    {
+        context.flagBitCount = 8;
+    }
+}
+
+bool HDLC::_isFlagSequence(const ReceiveContext &context)
+{
+    const uint8_t FLAG_SEQUENCE = 0x7E; // 01111110
+    return (context.flagBuffer == FLAG_SEQUENCE && context.flagBitCount >= 8);
+}
+
+void HDLC::_handleFlagSequence(ReceiveContext &context)
+{
+    if (!context.inFrame)
+    {
+        // フレーム開始
+        this->_startFrame(context);
+    }
+    else
+    {
+        // フレーム終了
+        this->_endFrame(context);
+    }
+}
+
+void HDLC::_startFrame(ReceiveContext &context)
+{
+    context.inFrame = true;
+    context.rawBitIndex = 0;
+    context.addressByte = 0;
+    context.addressBitCount = 0;
+    context.addressOnes = 0;
+    context.stuffedBits = 0;
+    this->m_consecutiveOnes = 0;
+}
+
+bool HDLC::_hasFrameData(const ReceiveContext &context) const
+{
+    return context.inFrame && context.rawBitIndex >= 8;
+}
+
+void HDLC::_dropFrame(ReceiveContext &context)
+{
+    context.inFrame = false;
+    context.rawBitIndex = 0;
+    context.frameDropped = true;
+}
+
+void HDLC::_endFrame(ReceiveContext &context)
+{
+    if (context.rawBitIndex > 0)
+    {
+        if (this->_processCompleteFrame(context.rawData, context.rawBitIndex))
+        {
+            context.frameComplete = true;
+            return;
+        }
+    }
+    if (this->_hasFrameData(context))
+    {
+        context.frameDropped = true; // CRC異常等。この後アイドルになれば応答は来ない
+    }
+    // 無効なフレームの終了フラグは次のフレームの開始フラグを兼ねる
+    this->_startFrame(context);
+}
+
+bool HDLC::_filterAddressBit(uint8_t bit, ReceiveContext &context)
+{
+    if (!this->m_addressFilterEnabled || context.addressBitCount >= 8)
+    {
+        return true;
+    }
+
+    // 先頭バイトだけを逐次デスタッフィング
+    if (bit)
+    {
+        context.addressOnes++;
+    }
+    else
+    {
+        bool stuffed = (context.addressOnes == 5);
+        context.addressOnes = 0;
+        if (stuffed)
+        {
+            return true; // スタッフィングされた0ビット
+        }
+    }
+    context.addressByte = (uint8_t)((context.addressByte << 1) | bit);
+    context.addressBitCount++;
+
+    if (context.addressBitCount == 8 && !this->isAddressAccepted(context.addressByte))
+    {
+        // 他局宛て: 残りは保存せずフラグ探索に戻る
+        this->m_receiveStatistics.filteredFrames++;
+        context.inFrame = false;
+        context.rawBitIndex = 0;
+        return false;
+    }
+    return true;
+}
+
+void HDLC::_storeBitInFrame(uint8_t bit, ReceiveContext &context)
+{
+    // デスタッフィング後の長さが最大長と終了フラグ分を超えたら即座に破棄
+    const size_t maxFrameBits = MAX_FRAME_SIZE * 8 + 7;
+    if (context.rawBitIndex >= sizeof(context.rawData) * 8 ||
+        context.rawBitIndex - context.stuffedBits >= maxFrameBits)
+    {
+        this->m_receiveStatistics.oversizeFrames++;
+        this->_dropFrame(context);
+        return;
+    }
+
+    size_t byteIndex = context.rawBitIndex / 8;
+    size_t bitPos = context.rawBitIndex % 8;
+
+    if (bit)
+    {
+        context.rawData[byteIndex] |= (1 << (7 - bitPos));
+    }
+    else
+    {
+        context.rawData[byteIndex] &= ~(1 << (7 - bitPos));
+    }
+    context.rawBitIndex++;
+}
+
+bool HDLC::_processCompleteFrame(const uint8_t *rawData, size_t rawBitCount)
+{
+    if (!rawData || rawBitCount == 0)
+    {
+        return false;
+    }
+
+    // ビットデスタッフィング
+    size_t outputByteIndex = HDLC::destuffBits(rawData, 0, rawBitCount, this->m_receiveBuffer, MAX_FRAME_SIZE);
+    if (outputByteIndex == DESTUFF_OVERFLOW)
+    {
+        return false; // バッファオーバーフロー
+    }
+    return this->_acceptReceivedFrame(outputByteIndex);
+}
+
+bool HDLC::_acceptReceivedFrame(size_t frameLength)
+{
+    size_t outputByteIndex = frameLength;
+
+    // 最低限のフレーム長チェック（アドレス+コントロール+CRC）
+    if (outputByteIndex < 3)
+    {
+        return false;
+    }
+
+    // CRC検証
+    bool crcValid = this->_validateFrameCRC(outputByteIndex);
+    if (this->m_frameLogger)
+    {
+        this->m_frameLogger->logFrame(this->m_pinInterface.micros(), true, crcValid,
+                                      this->m_receiveBuffer, outputByteIndex);
+    }
+    if (!crcValid)
+    {
+        if (this->m_receiveCallback)
+        {
+            this->_queueReceivedFrame(this->m_receiveBuffer, outputByteIndex - 2, false);
+        }
+        this->m_receiveStatistics.crcErrors++;
+        return false;
+    }
+
+#if HDLC_ENABLE_COMPRESSION
+    if (this->m_session->compression)
+    {
+        outputByteIndex = this->_decompressReceivedFrame(outputByteIndex);
+        if (outputByteIndex == 0)
+        {
+            this->m_receiveStatistics.codecErrors++;
+            return false;
+        }
+    }
+#endif
+    if (this->m_receiveCallback)
+    {
+        this->_queueReceivedFrame(this->m_receiveBuffer, outputByteIndex - 2, true);
+    }
+
+    // 有効なフレームをキューに保存
+    this->m_receiveStatistics.validFrames++;
+    this->_storeValidFrame(outputByteIndex);
+    return true;
+}
+
+void HDLC::setByteStream(IByteStream *stream)
+{
+    this->m_byteStream = stream;
+    this->_resetOctetReceiver();
+    this->m_octetDiscard = true; // 最初のフラグまでは途中から受信したフレームとみなす
+    if (stream)
+    {
+        stream->setBaudRate(this->m_baudRate);
+    }
+}
+
+void HDLC::_resetOctetReceiver()
+{
+    this->m_octetLength = 0;
+    this->m_octetEscape = false;
+    this->m_octetDiscard = false;
+}
+
+bool HDLC::_pollByteStream()
+{
+    while (this->m_byteStream->available() > 0)
+    {
+        int value = this->m_byteStream->read();
+        if (value < 0)
+        {
+            break;
+        }
+        if (this->_processReceivedOctet((uint8_t)value))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HDLC::_processReceivedOctet(uint8_t byte)
+{
+    if (byte == OctetStuffing::FLAG)
+    {
+        bool valid = false;
+        if (this->m_octetEscape)
+        {
+            // 0x7D 0x7E: アボート
+            this->m_receiveStatistics.abortedFrames++;
+        }
+        else if (this->m_octetLength > 0 && !this->m_octetDiscard)
+        {
+            valid = this->_acceptReceivedFrame(this->m_octetLength);
+        }
+        // フラグは前のフレームの終了と次のフレームの開始を兼ねる
+        this->_resetOctetReceiver();
+        return valid;
+    }
+
+    if (this->m_octetDiscard)
+    {
+        return false;
+    }
+    if (byte == OctetStuffing::ESCAPE)
+    {
+        this->m_octetEscape = true;
+        return false;
+    }
+    if (this->m_octetEscape)
+    {
+        byte ^= OctetStuffing::ESCAPE_XOR;
+        this->m_octetEscape = false;
+    }
+
+    if (this->m_octetLength >= MAX_FRAME_SIZE)
+    {
+        this->m_receiveStatistics.oversizeFrames++;
+        this->m_octetDiscard = true;
+        return false;
+    }
+    if (this->m_octetLength == 0 && this->m_addressFilterEnabled && !this->isAddressAccepted(byte))
+    {
+        // 他局宛て: 次のフラグまで保存しない
+        this->m_receiveStatistics.filteredFrames++;
+        this->m_octetDiscard = true;
+        return false;
+    }
+    this->m_receiveBuffer[this->m_octetLength++] = byte;
+    return false;
+}
+
+size_t HDLC::_decompressReceivedFrame(size_t frameLength)
+{
+    // 圧縮するのは選択中の局とのIフレームの情報フィールドだけ
+    ControlField control;
+    if (this->m_receiveBuffer[0] != this->m_session->address ||
+        !this->_parseControl(this->m_receiveBuffer, frameLength - 2, control) || control.format != FORMAT_I)
+    {
+        return frameLength;
+    }
+    size_t headerLength = 1 + control.length;
+    size_t infoLength = frameLength - 2 - headerLength;
+    if (infoLength == 0)
+    {
+        return frameLength;
+    }
+
+    uint8_t info[MAX_FRAME_SIZE];
+    size_t decompressed = PayloadCodec::decompress(this->m_receiveBuffer + headerLength, infoLength, info,
+                                                   MAX_FRAME_SIZE - headerLength - 2);
+    if (decompressed == 0)
+    {
+        return 0;
+    }
+    memcpy(this->m_receiveBuffer + headerLength, info, decompressed);
+    return headerLength + decompressed + 2; // CRC分（検証済みのため値は使わない）
+}
+
+size_t HDLC::destuffBits(const uint8_t *rawData, size_t startBit, size_t bitCount,
+                         uint8_t *output, size_t maxOutput)
+{
+    uint8_t consecutiveOnes = 0;
+    uint8_t currentByte = 0;
+    int8_t bitPosition = 7;
+    size_t outputByteIndex = 0;
+
+    // 入力バイト配列をビット単位で処理（bitCountまで）
+    for (size_t bitIdx = startBit; bitIdx < startBit + bitCount; bitIdx++)
+    {
+        // ビットインデックスからバイトインデックスとビット位置を計算
+        size_t byteIdx = bitIdx / 8;
+        int bitPos = 7 - (bitIdx % 8);
+        uint8_t bit = (rawData[byteIdx] >> bitPos) & 1;
+
+        if (bit == 1)
+        {
+            consecutiveOnes++;
+        }
+        else
+        {
+            if (consecutiveOnes == 5)
+            {
+                // スタッフィングされた0ビットなので無視
+                consecutiveOnes = 0;
+                continue;
+            }
+            consecutiveOnes = 0;
+        }
+
+        // 通常のデータビット
+        if (bit == 1)
+        {
+            currentByte |= (1 << bitPosition);
+        }
+
+        bitPosition--;
+
+        if (bitPosition < 0)
+        {
+            // 1バイト完成
+            if (outputByteIndex >= maxOutput)
+            {
+                return DESTUFF_OVERFLOW;
+            }
+            output[outputByteIndex++] = currentByte;
+            currentByte = 0;
+            bitPosition = 7;
+        }
+    }
+
+    return outputByteIndex;
+}
+
+bool HDLC::_validateFrameCRC(size_t frameLength)
+{
+    uint16_t receivedCRC = (this->m_receiveBuffer[frameLength - 2] << 8) | this->m_receiveBuffer[frameLength - 1];
+    uint16_t calculatedCRC = this->calculateCRC16(this->m_receiveBuffer, frameLength - 2);
+    return (receivedCRC == calculatedCRC);
+}
+
+void HDLC::_storeValidFrame(size_t frameLength)
+{
+    this->m_frameQueue.length = frameLength - 2; // CRCを除く
+    for (size_t i = 0; i < this->m_frameQueue.length && i < MAX_FRAME_SIZE; i++)
+    {
+        this->m_frameQueue.data[i] = this->m_receiveBuffer[i];
+    }
+    this->m_frameQueue.valid = true;
+    this->m_frameQueue.hasData = true;
+}
+
+size_t HDLC::readFrame(uint8_t *buffer, size_t bufferSize)
+{
+    if (!buffer || bufferSize == 0 || !this->m_frameQueue.hasData)
+    {
+        return 0;
+    }
+
+    size_t copyLength = (this->m_frameQueue.length < bufferSize) ? this->m_frameQueue.length : bufferSize;
+    for (size_t i = 0; i < copyLength; i++)
+    {
+        buffer[i] = this->m_frameQueue.data[i];
+    }
+
+    // フレームキューをクリア
+    this->m_frameQueue.hasData = false;
+    this->m_frameQueue.valid = false;
+    this->m_frameQueue.length = 0;
+
+    return copyLength;
+}
+
+// RS485制御メソッド
+void HDLC::_enableTransmit()
+{
+    if (this->m_lineCoding == LINE_NRZI)
+    {
+        // アイドル(1)のレベルから符号化を始める
+        this->m_txLevel = 1;
+        this->m_pinInterface.digitalWrite(this->m_txPin, HIGH);
+    }
+    this->m_pinInterface.digitalWrite(this->m_dePin, HIGH);
+    this->m_pinInterface.digitalWrite(this->m_rePin, HIGH);
+    this->m_isTransmitting = true;
+    this->m_pinInterface.delayMicroseconds(this->m_settleMicros);
+}
+
+void HDLC::_enableReceive()
+{
+    this->m_pinInterface.digitalWrite(this->m_dePin, LOW);
+    this->m_pinInterface.digitalWrite(this->m_rePin, LOW);
+    this->m_isTransmitting = false;
+    this->m_pinInterface.delayMicroseconds(this->m_turnaroundMicros);
+}
+
+void HDLC::setDriverTiming(uint32_t settleMicros, uint32_t turnaroundMicros)
+{
+    this->m_settleMicros = settleMicros;
+    this->m_turnaroundMicros = turnaroundMicros;
+    this->m_driverTimingSet = true;
+}
+
+void HDLC::setBaudRate(uint32_t baudRate)
+{
+    if (baudRate == 0)
+    {
+        return;
+    }
+    this->m_baudRate = baudRate;
+    if (this->m_byteStream)
+    {
+        this->m_byteStream->setBaudRate(baudRate);
+    }
+    this->m_bitTimeMicros = 1000000UL / baudRate;
+    this->m_halfBitTimeMicros = this->m_bitTimeMicros / 2;
+    this->m_shortDelayMicros = this->m_bitTimeMicros / 8;
+    if (!this->m_driverTimingSet)
+    {
+        this->m_settleMicros = this->m_halfBitTimeMicros + 100;
+        this->m_turnaroundMicros = this->m_halfBitTimeMicros;
+    }
+}
+
+void HDLC::setAutoBaud(bool enabled)
+{
+    this->m_autoBaud = enabled;
+    this->m_baudLocked = false;
+    this->m_autoBaudFailures = 0;
+}
+
+uint32_t HDLC::detectBaudRate(uint32_t timeoutMs)
+{
+    if (!this->m_initialized || this->m_byteStream)
+    {
+        return 0;
+    }
+    this->_enableReceive();
+
+    const uint32_t minRunMicros = AUTOBAUD_POLL_MICROS * 2; // これより短い区間はノイズとみなす
+    uint32_t startTime = this->m_pinInterface.millis();
+    uint8_t level = this->_readLevel();
+    uint32_t edgeMicros = 0;
+    bool haveEdge = false;
+    uint32_t shortestRun = 0;
+    uint8_t edgeCount = 0;
+    uint32_t lowRun = 0;    // 直前のLOW区間
+    uint8_t fillCycles = 0; // 続けて見つかったフラグフィルの周期数
+
+    while ((this->m_pinInterface.millis() - startTime) < timeoutMs)
+    {
+        this->m_pinInterface.delayMicroseconds(AUTOBAUD_POLL_MICROS);
+        uint8_t bit = this->_readLevel();
+        if (bit == level)
+        {
+            continue;
+        }
+
+        uint32_t now = this->m_pinInterface.micros();
+        uint32_t run = now - edgeMicros;
+        edgeMicros = now;
+        uint8_t runLevel = level;
+        level = bit;
+        if (!haveEdge)
+        {
+            haveEdge = true; // 最初のエッジまでの区間は長さが分からない
+            continue;
+        }
+        if (run < minRunMicros)
+        {
+            continue;
+        }
+        if (edgeCount < 255)
+        {
+            edgeCount++;
+        }
+
+        // 最短の区間を1ビットとみなす
+        if (shortestRun == 0 || run < shortestRun)
+        {
+            shortestRun = run;
+        }
+        if (runLevel == 0)
+        {
+            lowRun = run;
+            continue;
+        }
+
+        // 1ビットの6倍のHIGH区間（フラグ）が見つかれば確定
+        if (edgeCount >= 4 && run + shortestRun / 2 >= shortestRun * 6 && run <= shortestRun * 6 + shortestRun / 2)
+        {
+            return roundToStandardBaudRate((uint32_t)((6ULL * 1000000ULL + run / 2) / run));
+        }
+
+        // フラグフィルの途中から始めると1ビットの区間が無く、最短はフラグ間の0が2個続くLOW区間になる。
+        // LOW:HIGH = 2:6 の周期（8ビット）が続けば、周期/8をビット時間とする
+        bool fillCycle = lowRun <= shortestRun + shortestRun / 4 &&
+                         run + lowRun / 2 >= lowRun * 3 && run <= lowRun * 3 + lowRun / 2;
+        fillCycles = fillCycle ? fillCycles + 1 : 0;
+        if (fillCycles >= AUTOBAUD_FILL_CYCLES)
+        {
+            uint32_t period = run + lowRun;
+            return roundToStandardBaudRate((uint32_t)((8ULL * 1000000ULL + period / 2) / period));
+        }
+    }
+    return 0;
+}
+
+bool HDLC::_waitForLevel(uint8_t level, uint32_t limitMicros, uint32_t &elapsedMicros)
+{
+    uint32_t start = this->m_pinInterface.micros();
+    while (this->_readLevel() != level)
+    {
+        if ((this->m_pinInterface.micros() - start) > limitMicros)
+        {
+            return false;
+        }
+    }
+    elapsedMicros = this->m_pinInterface.micros() - start;
+    return true;
+}
+
+bool HDLC::calibrateDriverTiming(uint8_t samples)
+{
+    if (!this->m_initialized || samples == 0)
+    {
+        return false;
+    }
+
+    const uint32_t limitMicros = this->m_bitTimeMicros * 8;
+    uint32_t maxEnable = 0;
+    uint32_t maxDisable = 0;
+    bool success = true;
+
+    // 受信を有効にしたまま（ループバック）TXをLOWにしておく
+    this->m_pinInterface.digitalWrite(this->m_txPin, LOW);
+    this->m_pinInterface.digitalWrite(this->m_rePin, LOW);
+    for (uint8_t i = 0; i < samples && success; i++)
+    {
+        this->m_pinInterface.digitalWrite(this->m_dePin, LOW);
+        this->m_pinInterface.delayMicroseconds(this->m_bitTimeMicros);
+        uint32_t elapsed = 0;
+        if (this->_readLevel() != 1) // バイアスでアイドル(1)になっていない
+        {
+            success = false;
+            break;
+        }
+
+        // DE有効化から受信出力がLOWになるまで
+        this->m_pinInterface.digitalWrite(this->m_dePin, HIGH);
+        success = this->_waitForLevel(0, limitMicros, elapsed);
+        maxEnable = (elapsed > maxEnable) ? elapsed : maxEnable;
+
+        // DE解除から受信出力がアイドルに戻るまで
+        this->m_pinInterface.digitalWrite(this->m_dePin, LOW);
+        success = success && this->_waitForLevel(1, limitMicros, elapsed);
+        maxDisable = (elapsed > maxDisable) ? elapsed : maxDisable;
+    }
+
+    // アイドル状態に戻す
+    this->m_pinInterface.digitalWrite(this->m_txPin, HIGH);
+    this->_enableReceive();
+
+    if (!success)
+    {
+        return false;
+    }
+    this->setDriverTiming(maxEnable + this->m_shortDelayMicros, maxDisable + this->m_shortDelayMicros);
+    return true;
+}
+
+size_t HDLC::_buildXidInfo(uint32_t baudRate, uint8_t compression, uint8_t *info, size_t maxLength)
+{
+    // パラメータ識別子 + 長さ + 値
+    size_t groupLength = (baudRate ? 2 + 4 : 0) + (compression != XID_COMPRESSION_ABSENT ? 2 + 1 : 0);
+    if (!info || maxLength < 4 + groupLength)
+    {
+        return 0;
+    }
+    size_t index = 0;
+    info[index++] = XID_FORMAT_ID;
+    info[index++] = XID_GROUP_ID;
+    info[index++] = (uint8_t)(groupLength >> 8);
+    info[index++] = (uint8_t)groupLength;
+    if (baudRate)
+    {
+        info[index++] = XID_PARAM_BAUD_RATE;
+        info[index++] = 4;
+        info[index++] = (uint8_t)(baudRate >> 24);
+        info[index++] = (uint8_t)(baudRate >> 16);
+        info[index++] = (uint8_t)(baudRate >> 8);
+        info[index++] = (uint8_t)baudRate;
+    }
+    if (compression != XID_COMPRESSION_ABSENT)
+    {
+        info[index++] = XID_PARAM_COMPRESSION;
+        info[index++] = 1;
+        info[index++] = compression;
+    }
+    return index;
+}
+
+bool HDLC::_findXidParameter(const uint8_t *info, size_t length, uint8_t parameter,
+                             const uint8_t *&value, uint8_t &valueLength)
+{
+    if (!info || length < 4 || info[0] != XID_FORMAT_ID || info[1] != XID_GROUP_ID)
+    {
+        return false;
+    }
+    size_t groupEnd = 4 + (((size_t)info[2] << 8) | info[3]);
+    if (groupEnd > length)
+    {
+        return false;
+    }
+
+    // 知らないパラメータは読み飛ばす
+    for (size_t index = 4; index + 2 <= groupEnd;)
+    {
+        uint8_t current = info[index];
+        uint8_t currentLength = info[index + 1];
+        index += 2;
+        if (index + currentLength > groupEnd)
+        {
+            return false;
+        }
+        if (current == parameter)
+        {
+            value = info + index;
+            valueLength = currentLength;
+            return true;
+        }
+        index += currentLength;
+    }
+    return false;
+}
+
+bool HDLC::_parseXidBaudRate(const uint8_t *info, size_t length, uint32_t &baudRate)
+{
+    const uint8_t *value;
+    uint8_t valueLength;
+    if (!HDLC::_findXidParameter(info, length, XID_PARAM_BAUD_RATE, value, valueLength) || valueLength != 4)
+    {
+        return false;
+    }
+    baudRate = ((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) | ((uint32_t)value[2] << 8) | value[3];
+    return baudRate != 0;
+}
+
+void HDLC::_answerXid(const uint8_t *info, size_t length)
+{
+    // 提案以下で自局の上限までの速度を受理する（速度の提案が無ければ速度は返さない）
+    uint32_t proposed = 0;
+    uint32_t accepted = 0;
+    if (HDLC::_parseXidBaudRate(info, length, proposed))
+    {
+        accepted = (proposed < this->m_maxBaudRate) ? proposed : this->m_maxBaudRate;
+    }
+
+    // 圧縮は自局が対応している場合だけ受理する
+    const uint8_t *value;
+    uint8_t valueLength;
+    uint8_t compression = XID_COMPRESSION_ABSENT;
+    if (HDLC::_findXidParameter(info, length, XID_PARAM_COMPRESSION, value, valueLength) && valueLength == 1)
+    {
+        compression = (HDLC_ENABLE_COMPRESSION && value[0] == 1) ? 1 : 0;
+    }
+    if (accepted == 0 && compression == XID_COMPRESSION_ABSENT)
+    {
+        accepted = this->m_baudRate; // 解釈できなければ現在の速度を返す
+    }
+
+    uint8_t xidInfo[16];
+    size_t xidLength = HDLC::_buildXidInfo(accepted, compression, xidInfo, sizeof(xidInfo));
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t frameLength = this->_createHDLCFrame(this->m_session->address, CMD_XID | POLL_FINAL_BIT,
+                                                xidInfo, xidLength, frame, MAX_FRAME_SIZE);
+    if (frameLength == 0 || !this->_transmitFrame(frame, frameLength))
+    {
+        return;
+    }
+
+    if (compression != XID_COMPRESSION_ABSENT)
+    {
+        this->m_session->compression = (compression != 0);
+    }
+
+    // 応答の送信完了が切り替え点。確認されるまで元の速度を覚えておく
+    if (accepted != 0 && accepted != this->m_baudRate)
     {
-        if (this->_processCompleteFrame(context.rawData, context.rawBitIndex))
+        if (this->m_fallbackBaudRate == 0)
         {
-            context.frameComplete = true;
-            return;
+            this->m_fallbackBaudRate = this->m_baudRate;
         }
+        this->m_baudChangeMillis = this->m_pinInterface.millis();
+        this->setBaudRate(accepted);
     }
-    context.inFrame = false;
-    context.rawBitIndex = 0;
 }
 
-void HDLC::_storeBitInFrame(uint8_t bit, ReceiveContext &context)
+uint32_t HDLC::_checkBaudFallback()
 {
-    if (context.rawBitIndex < sizeof(context.rawData) * 8)
+    if (this->m_fallbackBaudRate == 0)
+    {
+        return 0xFFFFFFFFUL;
+    }
+    uint32_t elapsed = this->m_pinInterface.millis() - this->m_baudChangeMillis;
+    if (elapsed < BAUD_FALLBACK_MS)
     {
-        size_t byteIndex = context.rawBitIndex / 8;
-        size_t bitPos = context.rawBitIndex % 8;
+        return BAUD_FALLBACK_MS - elapsed;
+    }
+    this->setBaudRate(this->m_fallbackBaudRate);
+    this->m_fallbackBaudRate = 0;
+    return 0xFFFFFFFFUL;
+}
 
-        if (bit)
+bool HDLC::_verifyLinkWithTest(uint8_t attempts)
+{
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t frameLength = this->_createHDLCFrame(this->m_session->address, CMD_TEST | POLL_FINAL_BIT,
+                                                TEST_PATTERN, sizeof(TEST_PATTERN), frame, MAX_FRAME_SIZE);
+    for (uint8_t attempt = 0; attempt < attempts; attempt++)
+    {
+        if (!this->_transmitFrame(frame, frameLength))
         {
-            context.rawData[byteIndex] |= (1 << (7 - bitPos));
+            return false;
         }
-        else
+        uint32_t sentMicros = this->m_pinInterface.micros();
+        bool received = this->receiveFrameWithBitControl(this->responseTimeoutMs());
+        this->_recordResponseTime(sentMicros, received);
+        const uint8_t *response = this->m_frameQueue.data;
+        bool echoed = received && this->m_frameQueue.length == 2 + sizeof(TEST_PATTERN) &&
+                      response[0] == this->m_session->address &&
+                      (response[1] & (uint8_t)~POLL_FINAL_BIT) == CMD_TEST &&
+                      memcmp(response + 2, TEST_PATTERN, sizeof(TEST_PATTERN)) == 0;
+        this->m_frameQueue.hasData = false;
+        if (echoed)
         {
-            context.rawData[byteIndex] &= ~(1 << (7 - bitPos));
+            return true;
         }
-        context.rawBitIndex++;
     }
+    return false;
 }
 
-bool HDLC::_processCompleteFrame(const uint8_t *rawData, size_t rawBitCount)
+bool HDLC::_exchangeXid(const uint8_t *info, size_t length)
 {
-    if (!rawData || rawBitCount == 0)
+    uint8_t frame[MAX_FRAME_SIZE];
+    size_t frameLength = this->_createHDLCFrame(this->m_session->address, CMD_XID | POLL_FINAL_BIT,
+                                                info, length, frame, MAX_FRAME_SIZE);
+    if (frameLength == 0 || !this->_transmitFrame(frame, frameLength))
     {
         return false;
     }
+    uint32_t sentMicros = this->m_pinInterface.micros();
+    bool received = this->receiveFrameWithBitControl(this->responseTimeoutMs());
+    this->_recordResponseTime(sentMicros, received);
+    return received && this->m_frameQueue.length >= 2 &&
+           this->m_frameQueue.data[0] == this->m_session->address &&
+           (this->m_frameQueue.data[1] & (uint8_t)~POLL_FINAL_BIT) == CMD_XID;
+}
 
-    // ビットデスタッフィングを直接実行
-    uint8_t consecutiveOnes = 0;
-    uint8_t currentByte = 0;
-    int8_t bitPosition = 7;
-    size_t outputByteIndex = 0;
-
-    // 入力バイト配列をビット単位で処理（rawBitCountまで）
-    for (size_t bitIdx = 0; bitIdx < rawBitCount; bitIdx++)
+bool HDLC::negotiateCompression(bool enable)
+{
+    if (!this->m_initialized || (enable && !HDLC_ENABLE_COMPRESSION))
     {
-        // ビットインデックスからバイトインデックスとビット位置を計算
-        size_t byteIdx = bitIdx / 8;
-        int bitPos = 7 - (bitIdx % 8);
-        uint8_t bit = (rawData[byteIdx] >> bitPos) & 1;
-
-        if (bit == 1)
-        {
-            consecutiveOnes++;
-        }
-        else
-        {
-            if (consecutiveOnes == 5)
-            {
-                // スタッフィングされた0ビットなので無視
-                consecutiveOnes = 0;
-                continue;
-            }
-            consecutiveOnes = 0;
-        }
+        return false;
+    }
 
-        // 通常のデータビット
-        if (bit == 1)
-        {
-            currentByte |= (1 << bitPosition);
-        }
+    uint8_t xidInfo[8];
+    size_t xidLength = HDLC::_buildXidInfo(0, enable ? 1 : 0, xidInfo, sizeof(xidInfo));
+    const uint8_t *value;
+    uint8_t valueLength;
+    bool answered = this->_exchangeXid(xidInfo, xidLength) &&
+                    HDLC::_findXidParameter(this->m_frameQueue.data + 2, this->m_frameQueue.length - 2,
+                                            XID_PARAM_COMPRESSION, value, valueLength) &&
+                    valueLength == 1;
+    bool accepted = answered && value[0] == 1;
+    this->m_frameQueue.hasData = false;
+    if (!answered)
+    {
+        return false; // 相手局の状態が不明なため変更しない
+    }
+    this->m_session->compression = accepted;
+    return accepted == enable;
+}
 
-        bitPosition--;
+bool HDLC::negotiateBaudRate(uint32_t baudRate)
+{
+    if (!this->m_initialized || baudRate == 0 || baudRate == this->m_baudRate)
+    {
+        return false;
+    }
 
-        if (bitPosition < 0)
-        {
-            // 1バイト完成
-            if (outputByteIndex >= MAX_FRAME_SIZE)
-            {
-                return false; // バッファオーバーフロー
-            }
-            this->m_receiveBuffer[outputByteIndex++] = currentByte;
-            currentByte = 0;
-            bitPosition = 7;
-        }
+    // 現在の速度でXID(P)を送り、相手局が受理した速度を受け取る
+    uint8_t xidInfo[16];
+    size_t xidLength = HDLC::_buildXidInfo(baudRate, XID_COMPRESSION_ABSENT, xidInfo, sizeof(xidInfo));
+    uint32_t accepted = 0;
+    bool answered = this->_exchangeXid(xidInfo, xidLength) &&
+                    HDLC::_parseXidBaudRate(this->m_frameQueue.data + 2, this->m_frameQueue.length - 2, accepted);
+    this->m_frameQueue.hasData = false;
+    if (!answered || accepted == this->m_baudRate || accepted > baudRate)
+    {
+        return false; // 拒否（相手局は切り替えていない）
     }
 
-    // 最低限のフレーム長チェック（アドレス+コントロール+CRC）
-    if (outputByteIndex < 3)
+    // 相手局は応答の送信後に切り替えている。受信に戻るのを待ってTESTで確認する
+    uint32_t previous = this->m_baudRate;
+    this->setBaudRate(accepted);
+    this->m_pinInterface.delayMicroseconds(BAUD_SWITCH_DELAY_MS * 1000UL);
+    if (this->_verifyLinkWithTest(BAUD_TEST_ATTEMPTS))
     {
-        return false;
+        return true;
     }
 
-    // CRC検証
-    if (!this->_validateFrameCRC(outputByteIndex))
+    // 失敗: 元の速度に戻し、相手局が元に戻るのを待って確認する
+    this->setBaudRate(previous);
+    uint32_t start = this->m_pinInterface.millis();
+    while ((this->m_pinInterface.millis() - start) <= BAUD_FALLBACK_MS)
+    {
+        this->m_pinInterface.delayMicroseconds(1000);
+    }
+    if (this->_verifyLinkWithTest(1))
     {
         return false;
     }
 
-    // 有効なフレームをキューに保存
-    this->_storeValidFrame(outputByteIndex);
-    return true;
+    // 元の速度で応答が無い: 相手局はTESTを受信して新しい速度で確定している
+    this->setBaudRate(accepted);
+    if (this->_verifyLinkWithTest(1))
+    {
+        return true;
+    }
+    this->setBaudRate(previous);
+    return false;
 }
 
-bool HDLC::_validateFrameCRC(size_t frameLength)
+void HDLC::setMaxBaudRate(uint32_t baudRate)
 {
-    uint16_t receivedCRC = (this->m_receiveBuffer[frameLength - 2] << 8) | this->m_receiveBuffer[frameLength - 1];
-    uint16_t calculatedCRC = this->calculateCRC16(this->m_receiveBuffer, frameLength - 2);
-    return (receivedCRC == calculatedCRC);
+    this->m_maxBaudRate = baudRate;
+    this->m_baudCeiling = 0;
+    this->m_cleanTuneIntervals = 0;
 }
 
-void HDLC::_storeValidFrame(size_t frameLength)
+uint32_t HDLC::recommendBaudRate(uint32_t baudRate, uint32_t validFrames, uint32_t crcErrors,
+                                 uint32_t maxBaudRate)
 {
-    this->m_frameQueue.length = frameLength - 2; // CRCを除く
-    for (size_t i = 0; i < this->m_frameQueue.length && i < MAX_FRAME_SIZE; i++)
+    uint32_t total = validFrames + crcErrors;
+    if (total == 0)
     {
-        this->m_frameQueue.data[i] = this->m_receiveBuffer[i];
+        return baudRate;
     }
-    this->m_frameQueue.valid = true;
-    this->m_frameQueue.hasData = true;
+    uint32_t errorPermille = (uint32_t)(((uint64_t)crcErrors * 1000) / total);
+
+    if (errorPermille <= BAUD_STEP_UP_PERMILLE)
+    {
+        // 現在より速い最初の標準速度
+        for (size_t i = 0; i < STANDARD_BAUD_RATE_COUNT; i++)
+        {
+            if (STANDARD_BAUD_RATES[i] > baudRate)
+            {
+                return (STANDARD_BAUD_RATES[i] <= maxBaudRate) ? STANDARD_BAUD_RATES[i] : baudRate;
+            }
+        }
+    }
+    else if (errorPermille >= BAUD_STEP_DOWN_PERMILLE)
+    {
+        // 現在より遅い最初の標準速度
+        for (size_t i = STANDARD_BAUD_RATE_COUNT; i > 0; i--)
+        {
+            if (STANDARD_BAUD_RATES[i - 1] < baudRate)
+            {
+                return STANDARD_BAUD_RATES[i - 1];
+            }
+        }
+    }
+    return baudRate;
 }
 
-size_t HDLC::readFrame(uint8_t *buffer, size_t bufferSize)
+bool HDLC::tuneBaudRate()
 {
-    if (!buffer || bufferSize == 0 || !this->m_frameQueue.hasData)
+    if (!this->m_initialized || this->m_role != ROLE_PRIMARY)
     {
-        return 0;
+        return false;
     }
 
-    size_t copyLength = (this->m_frameQueue.length < bufferSize) ? this->m_frameQueue.length : bufferSize;
-    for (size_t i = 0; i < copyLength; i++)
+    uint32_t validFrames = this->m_receiveStatistics.validFrames - this->m_tuneValidBase;
+    uint32_t crcErrors = this->m_receiveStatistics.crcErrors - this->m_tuneErrorBase;
+    if (validFrames + crcErrors < BAUD_TUNE_MIN_FRAMES)
     {
-        buffer[i] = this->m_frameQueue.data[i];
+        return false;
     }
 
-    // フレームキューをクリア
-    this->m_frameQueue.hasData = false;
-    this->m_frameQueue.valid = false;
-    this->m_frameQueue.length = 0;
-
-    return copyLength;
-}
+    // CRC異常率の低い区間が長く続けば、維持できなかった速度を再び試す
+    bool clean = (uint64_t)crcErrors * 1000 <= (uint64_t)BAUD_STEP_UP_PERMILLE * (validFrames + crcErrors);
+    if (!clean)
+    {
+        this->m_cleanTuneIntervals = 0;
+    }
+    else if (this->m_baudCeiling != 0 && ++this->m_cleanTuneIntervals >= BAUD_CEILING_DECAY_INTERVALS)
+    {
+        this->m_baudCeiling = 0;
+        this->m_cleanTuneIntervals = 0;
+    }
 
-// RS485制御メソッド
-void HDLC::_enableTransmit()
-{
-    this->m_pinInterface.digitalWrite(this->m_dePin, HIGH);
-    this->m_pinInterface.digitalWrite(this->m_rePin, HIGH);
-    this->m_isTransmitting = true;
-    this->m_pinInterface.delayMicroseconds(this->m_halfBitTimeMicros);
-}
+    uint32_t maxBaudRate = this->m_maxBaudRate;
+    if (this->m_baudCeiling != 0 && this->m_baudCeiling <= maxBaudRate)
+    {
+        maxBaudRate = this->m_baudCeiling - 1;
+    }
+    uint32_t previous = this->m_baudRate;
+    uint32_t target = HDLC::recommendBaudRate(previous, validFrames, crcErrors, maxBaudRate);
+    bool changed = (target != previous) && this->negotiateBaudRate(target);
+    if (changed ? target < previous : target > previous)
+    {
+        // CRC異常で下げる前の速度と、上げられなかった速度は、しばらく試さない
+        this->m_baudCeiling = changed ? previous : target;
+        this->m_cleanTuneIntervals = 0;
+    }
 
-void HDLC::_enableReceive()
-{
-    this->m_pinInterface.digitalWrite(this->m_dePin, LOW);
-    this->m_pinInterface.digitalWrite(this->m_rePin, LOW);
-    this->m_isTransmitting = false;
-    this->m_pinInterface.delayMicroseconds(this->m_halfBitTimeMicros);
+    // 交渉中のフレームを含めず、次の区間を数え直す
+    this->m_tuneValidBase = this->m_receiveStatistics.validFrames;
+    this->m_tuneErrorBase = this->m_receiveStatistics.crcErrors;
+    return changed;
 }
 
 void HDLC::_transmitBit(uint8_t bit)
 {
+    if (this->m_lineCoding == LINE_NRZI)
+    {
+        // 0で反転、1で保持
+        if (bit == 0)
+        {
+            this->m_txLevel ^= 1;
+        }
+        bit = this->m_txLevel;
+    }
     this->m_pinInterface.digitalWrite(this->m_txPin, bit ? HIGH : LOW);
 }
 
 uint8_t HDLC::_readBit()
+{
+    uint8_t level = this->_readLevel();
+    if (this->m_lineCoding != LINE_NRZI)
+    {
+        return level;
+    }
+    uint8_t bit = (level == this->m_rxLevel) ? 1 : 0;
+    this->m_rxLevel = level;
+    return bit;
+}
+
+uint8_t HDLC::_readLevel()
 {
     return this->m_pinInterface.digitalRead(this->m_rxPin) ? 1 : 0;
 }
@@ -599,50 +2507,132 @@ void HDLC::_waitBitTime(uint32_t elapsedMicros)
     }
 }
 
+void HDLC::_waitBitTimeWithResync(uint32_t bitStartTime)
+{
+    // 標本点はビット中央なので、エッジは半ビット後に来るはず。
+    // 見つけたエッジの半ビット後を次の標本点にし、ずれは±1/4ビットまで補正する
+    uint32_t target = this->m_bitTimeMicros;
+    uint32_t quarterBit = this->m_halfBitTimeMicros / 2;
+    bool locked = false;
+    while (true)
+    {
+        uint32_t elapsed = this->m_pinInterface.micros() - bitStartTime;
+        if (elapsed >= target)
+        {
+            return;
+        }
+        if (!locked && this->_readLevel() != this->m_rxLevel)
+        {
+            locked = true;
+            uint32_t aligned = elapsed + this->m_halfBitTimeMicros;
+            if (aligned < this->m_bitTimeMicros - quarterBit)
+            {
+                aligned = this->m_bitTimeMicros - quarterBit;
+            }
+            else if (aligned > this->m_bitTimeMicros + quarterBit)
+            {
+                aligned = this->m_bitTimeMicros + quarterBit;
+            }
+            target = aligned;
+            continue;
+        }
+        uint32_t remaining = target - elapsed;
+        this->m_pinInterface.delayMicroseconds(remaining < RESYNC_POLL_MICROS ? remaining : RESYNC_POLL_MICROS);
+    }
+}
+
 // 内部フレーム送信メソッド
 bool HDLC::_transmitFrame(const uint8_t *data, size_t length)
 {
-    if (!this->m_initialized || !data || length == 0)
+    return this->_transmitFrames(data, &length, 1);
+}
+
+bool HDLC::_transmitFrames(const uint8_t *frames, const size_t *lengths, size_t count)
+{
+    if (!this->m_initialized || !frames || !lengths || count == 0)
     {
         return false;
     }
-
-#ifndef NATIVE_TEST
-    Serial.print("Transmitting HDLC frame (");
-    Serial.print(length);
-    Serial.println(" bytes of data)");
-    Serial.print("Data: ");
-    for (size_t i = 0; i < length; i++)
+    for (size_t i = 0; i < count; i++)
     {
-        Serial.print(data[i], HEX);
-        Serial.print(" ");
+        if (lengths[i] == 0)
+        {
+            return false;
+        }
     }
-    Serial.println();
+
+#if HDLC_SERIAL_TRACE
+    Serial.print("Transmitting ");
+    Serial.print(count);
+    Serial.println(" HDLC frame(s)");
 #endif
 
-    // 送信モードに切り替え
+    if (this->m_byteStream)
+    {
+        return this->_transmitOctetFrames(frames, lengths, count);
+    }
+
+    // 送信モードに切り替え（バースト全体で1回、安定化待機を含む）
     this->_enableTransmit();
-    this->m_pinInterface.delayMicroseconds(100); // 安定化待機
 
     // 開始フラグの送信 (0x7E = 01111110)
-    this->_transmitByte(HDLC::FLAG_SEQUENCE);
-
-    // データ送信（ビットスタッフィング付き）
-    uint8_t consecutiveOnes = 0;
-
-    for (size_t i = 0; i < length; i++)
+    for (uint8_t i = 0; i < this->m_preambleFlags; i++)
     {
-        this->_transmitByteWithStuffing(data[i], consecutiveOnes);
+        this->_transmitByte(HDLC::FLAG_SEQUENCE);
     }
 
-    // 終了フラグの送信 (0x7E = 01111110)
-    // フラグ送信前に連続1カウントをリセット
-    consecutiveOnes = 0;
-    this->_transmitByte(HDLC::FLAG_SEQUENCE);
+    const uint8_t *data = frames;
+    for (size_t frame = 0; frame < count; frame++)
+    {
+        size_t length = lengths[frame];
+        if (this->m_frameLogger)
+        {
+            this->m_frameLogger->logFrame(this->m_pinInterface.micros(), false, true, data, length);
+        }
+
+        // データ送信（ビットスタッフィング付き）
+        uint8_t consecutiveOnes = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            this->_transmitByteWithStuffing(data[i], consecutiveOnes);
+        }
+
+        // 終了フラグ（次のフレームの開始フラグを兼ねる）
+        this->_transmitByte(HDLC::FLAG_SEQUENCE);
+        data += length;
+    }
 
     return true;
 }
 
+bool HDLC::_transmitOctetFrames(const uint8_t *frames, const size_t *lengths, size_t count)
+{
+    this->_enableTransmit();
+
+    bool success = true;
+    const uint8_t *data = frames;
+    for (size_t frame = 0; frame < count && success; frame++)
+    {
+        size_t length = lengths[frame];
+        if (this->m_frameLogger)
+        {
+            this->m_frameLogger->logFrame(this->m_pinInterface.micros(), false, true, data, length);
+        }
+
+        uint8_t encoded[MAX_FRAME_SIZE * 2 + 2];
+        size_t encodedLength = OctetStuffing::encodeFrame(data, length, encoded, sizeof(encoded));
+        // 2フレーム目からは前のフレームの終了フラグを開始フラグとして共有する
+        size_t skip = (frame == 0) ? 0 : 1;
+        success = encodedLength > 0 &&
+                  this->m_byteStream->write(encoded + skip, encodedLength - skip) == encodedLength - skip;
+        data += length;
+    }
+
+    // DEを解除する前に送信を終える
+    this->m_byteStream->flush();
+    return success;
+}
+
 // HDLCフレーム作成メソッド
 size_t HDLC::_createHDLCFrame(
     uint8_t address,
@@ -652,7 +2642,19 @@ size_t HDLC::_createHDLCFrame(
     uint8_t *frameBuffer,
     size_t maxLength)
 {
-    if (!frameBuffer || maxLength < 4) // 最低限: アドレス + コントロール + CRC(2)
+    return this->_createHDLCFrame(address, &control, 1, info, infoLength, frameBuffer, maxLength);
+}
+
+size_t HDLC::_createHDLCFrame(
+    uint8_t address,
+    const uint8_t *control,
+    size_t controlLength,
+    const uint8_t *info,
+    size_t infoLength,
+    uint8_t *frameBuffer,
+    size_t maxLength)
+{
+    if (!frameBuffer || maxLength < 3 + controlLength) // 最低限: アドレス + コントロール + CRC(2)
     {
         return 0;
     }
@@ -663,7 +2665,10 @@ size_t HDLC::_createHDLCFrame(
     frameBuffer[frameIndex++] = address;
 
     // コントロールフィールド
-    frameBuffer[frameIndex++] = control;
+    for (size_t i = 0; i < controlLength; i++)
+    {
+        frameBuffer[frameIndex++] = control[i];
+    }
 
     // 情報フィールド（存在する場合）
     if (info && infoLength > 0)
@@ -687,6 +2692,90 @@ size_t HDLC::_createHDLCFrame(
     return frameIndex;
 }
 
+size_t HDLC::_createSequencedFrame(uint8_t command, uint8_t sendSequence, bool pollFinal,
+                                   const uint8_t *info, size_t infoLength,
+                                   uint8_t *frameBuffer, size_t maxLength)
+{
+    uint8_t receiveSequence = this->m_session->receiveSequence;
+    uint8_t control[2];
+    size_t controlLength;
+    if (this->_isExtended())
+    {
+        // 1バイト目: N(S)<<1（I形式）または監視種別、2バイト目: N(R)<<1 | P/F
+        control[0] = (command == CMD_I) ? (uint8_t)((sendSequence & 0x7F) << 1) : command;
+        control[1] = (uint8_t)(((receiveSequence & 0x7F) << 1) | (pollFinal ? 0x01 : 0x00));
+        controlLength = 2;
+    }
+    else
+    {
+        // N(S)はビット1-3、P/Fはビット4、N(R)はビット5-7
+        control[0] = (uint8_t)(command | (pollFinal ? POLL_FINAL_BIT : 0) | ((receiveSequence & 0x07) << 5));
+        if (command == CMD_I)
+        {
+            control[0] |= (uint8_t)((sendSequence & 0x07) << 1);
+        }
+        controlLength = 1;
+    }
+
+#if HDLC_ENABLE_COMPRESSION
+    uint8_t compressed[MAX_FRAME_SIZE];
+    if (command == CMD_I && this->m_session->compression && infoLength > 0)
+    {
+        infoLength = PayloadCodec::compress(info, infoLength, compressed, sizeof(compressed));
+        if (infoLength == 0)
+        {
+            return 0;
+        }
+        info = compressed;
+    }
+#endif
+    return this->_createHDLCFrame(this->m_session->address, control, controlLength,
+                                  info, infoLength, frameBuffer, maxLength);
+}
+
+bool HDLC::_parseControl(const uint8_t *frame, size_t length, ControlField &control) const
+{
+    if (!frame || length < 2)
+    {
+        return false;
+    }
+
+    uint8_t first = frame[1];
+    if ((first & 0x03) == 0x03)
+    {
+        // U形式は拡張モードでも1バイト
+        control.format = FORMAT_U;
+        control.command = first & (uint8_t)~POLL_FINAL_BIT;
+        control.pollFinal = (first & POLL_FINAL_BIT) != 0;
+        control.sendSequence = 0;
+        control.receiveSequence = 0;
+        control.length = 1;
+        return true;
+    }
+
+    control.format = (first & 0x01) ? FORMAT_S : FORMAT_I;
+    if (this->_isExtended())
+    {
+        if (length < 3)
+        {
+            return false;
+        }
+        control.command = (control.format == FORMAT_I) ? (uint8_t)CMD_I : (uint8_t)(first & 0x0F);
+        control.sendSequence = (control.format == FORMAT_I) ? (uint8_t)(first >> 1) : 0;
+        control.receiveSequence = frame[2] >> 1;
+        control.pollFinal = (frame[2] & 0x01) != 0;
+        control.length = 2;
+        return true;
+    }
+
+    control.command = (control.format == FORMAT_I) ? (uint8_t)CMD_I : (uint8_t)(first & 0x0F);
+    control.sendSequence = (control.format == FORMAT_I) ? (uint8_t)((first >> 1) & 0x07) : 0;
+    control.receiveSequence = (first >> 5) & 0x07;
+    control.pollFinal = (first & POLL_FINAL_BIT) != 0;
+    control.length = 1;
+    return true;
+}
+
 uint16_t HDLC::calculateCRC16(const uint8_t *data, size_t length)
 {
     uint16_t crc = 0xFFFF; // CRC-16-CCITT初期値
@@ -793,8 +2882,8 @@ void HDLC::_processReceivedFrame()
 // レスポンス判定ヘルパーメソッド
 bool HDLC::_isRRFrame(uint8_t control)
 {
-    // RRフレーム: ビット0が1、ビット3が0（S形式フレーム）
-    return (control & 0x01) == 0x01 && (control & 0x08) == 0x00;
+    // RRフレーム: 下位4ビットが0x01（S形式フレーム）
+    return (control & 0x0F) == CMD_RR;
 }
 
 bool HDLC::_isREJFrame(uint8_t control)
@@ -803,12 +2892,6 @@ bool HDLC::_isREJFrame(uint8_t control)
     return (control & 0x0F) == CMD_REJ;
 }
 
-uint8_t HDLC::_extractSequenceNumber(uint8_t control)
-{
-    // シーケンス番号はビット1-3に格納
-    return (control >> 1) & 0x07;
-}
-
 void HDLC::_transmitByte(uint8_t byte)
 {
     for (int i = 7; i >= 0; i--)
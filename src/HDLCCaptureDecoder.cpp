@@ -0,0 +1,274 @@
+#ifdef NATIVE_TEST
+
+#include "HDLCCaptureDecoder.h"
+#include "HDLC.h"
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    /**
+     * @brief 16ビット窓内のフラグ位置テーブル
+     *
+     * 添字は連続する2バイト、値のビットsは窓の先頭からsビット目に
+     * 0x7Eが始まることを示す。1バイト毎に1回の参照で8通りの位置を判定できる。
+     */
+    struct FlagTable
+    {
+        uint8_t entries[65536];
+
+        FlagTable()
+        {
+            for (uint32_t window = 0; window < 65536; window++)
+            {
+                uint8_t mask = 0;
+                for (int shift = 0; shift < 8; shift++)
+                {
+                    if (((window >> (8 - shift)) & 0xFF) == HDLC::FLAG_SEQUENCE)
+                    {
+                        mask |= (1 << shift);
+                    }
+                }
+                entries[window] = mask;
+            }
+        }
+    };
+
+    const uint8_t *flagTable()
+    {
+        static const FlagTable table; // 関数内staticの初期化はスレッドセーフ
+        return table.entries;
+    }
+
+    /**
+     * @brief 作業を一定数ずつスレッドに割り当てて並列実行
+     */
+    template <typename Function>
+    void parallelFor(size_t count, size_t batch, unsigned threads, Function function)
+    {
+        std::atomic<size_t> next(0);
+        auto worker = [&]()
+        {
+            for (;;)
+            {
+                size_t begin = next.fetch_add(batch);
+                if (begin >= count)
+                {
+                    return;
+                }
+                size_t end = (begin + batch < count) ? begin + batch : count;
+                for (size_t i = begin; i < end; i++)
+                {
+                    function(i);
+                }
+            }
+        };
+
+        if (threads <= 1 || count <= batch)
+        {
+            worker();
+            return;
+        }
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; i++)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : pool)
+        {
+            thread.join();
+        }
+    }
+
+    inline uint8_t bitAt(const uint8_t *packed, uint64_t index)
+    {
+        return (packed[index / 8] >> (7 - (index % 8))) & 1;
+    }
+}
+
+HDLCCaptureDecoder::HDLCCaptureDecoder(unsigned threads)
+    : m_threads(threads ? threads : std::thread::hardware_concurrency()),
+      m_maxFrameSize(4096),
+      m_summary()
+{
+    if (this->m_threads == 0)
+    {
+        this->m_threads = 1;
+    }
+}
+
+void HDLCCaptureDecoder::findFlags(const uint8_t *packed, uint64_t bitCount,
+                                   uint64_t firstByte, uint64_t lastByte,
+                                   std::vector<uint64_t> &positions)
+{
+    const uint8_t *table = flagTable();
+    uint64_t totalBytes = (bitCount + 7) / 8;
+    if (lastByte > totalBytes)
+    {
+        lastByte = totalBytes;
+    }
+
+    for (uint64_t i = firstByte; i < lastByte; i++)
+    {
+        uint16_t window = (uint16_t)(packed[i] << 8);
+        if (i + 1 < totalBytes)
+        {
+            window |= packed[i + 1];
+        }
+        uint8_t mask = table[window];
+        while (mask)
+        {
+            int shift = __builtin_ctz(mask);
+            mask &= mask - 1;
+            uint64_t position = i * 8 + shift;
+            if (position + 8 <= bitCount)
+            {
+                positions.push_back(position);
+            }
+        }
+    }
+}
+
+std::vector<HDLCCaptureDecoder::FrameRecord> HDLCCaptureDecoder::decode(const uint8_t *packed, uint64_t bitCount)
+{
+    this->m_summary = Summary();
+    std::vector<FrameRecord> frames;
+    if (!packed || bitCount < 16)
+    {
+        return frames;
+    }
+
+    // 1. フラグ探索: バイト範囲をスレッド数の数倍に分割して並列に探索
+    uint64_t totalBytes = (bitCount + 7) / 8;
+    size_t chunkCount = this->m_threads * 4;
+    uint64_t chunkBytes = (totalBytes + chunkCount - 1) / chunkCount;
+    if (chunkBytes < 4096)
+    {
+        chunkBytes = 4096;
+    }
+    chunkCount = (size_t)((totalBytes + chunkBytes - 1) / chunkBytes);
+
+    std::vector<std::vector<uint64_t>> chunkFlags(chunkCount);
+    parallelFor(chunkCount, 1, this->m_threads, [&](size_t chunk)
+                { HDLCCaptureDecoder::findFlags(packed, bitCount, chunk * chunkBytes,
+                                                (chunk + 1) * chunkBytes, chunkFlags[chunk]); });
+
+    std::vector<uint64_t> flags;
+    for (auto &chunk : chunkFlags)
+    {
+        flags.insert(flags.end(), chunk.begin(), chunk.end());
+    }
+    this->m_summary.flags = flags.size();
+    if (flags.size() < 2)
+    {
+        return frames;
+    }
+
+    // 2. フラグ間の区間を並列にデスタッフィング・CRC検証
+    size_t spanCount = flags.size() - 1;
+    std::vector<FrameRecord> spans(spanCount);
+    std::vector<uint8_t> keep(spanCount, 0);
+    parallelFor(spanCount, 256, this->m_threads, [&](size_t i)
+                {
+                    // 0を共有する連続フラグ（011111101111110）は区間が無い
+                    uint64_t start = flags[i] + 8;
+                    uint64_t end = flags[i + 1];
+                    if (end <= start)
+                    {
+                        return;
+                    }
+                    thread_local std::vector<uint8_t> scratch;
+                    keep[i] = this->_decodeSpan(packed, start, end, spans[i], scratch) ? 1 : 2; });
+
+    // 3. キャプチャ順にマージ
+    for (size_t i = 0; i < spanCount; i++)
+    {
+        if (keep[i] == 2)
+        {
+            this->m_summary.idleSpans++;
+            continue;
+        }
+        if (keep[i] == 0)
+        {
+            continue;
+        }
+        switch (spans[i].status)
+        {
+        case FRAME_OK:
+            this->m_summary.validFrames++;
+            break;
+        case FRAME_CRC_ERROR:
+            this->m_summary.crcErrors++;
+            break;
+        case FRAME_ABORTED:
+            this->m_summary.aborted++;
+            break;
+        default:
+            break;
+        }
+        frames.push_back(std::move(spans[i]));
+    }
+    this->m_summary.frames = frames.size();
+    return frames;
+}
+
+bool HDLCCaptureDecoder::_decodeSpan(const uint8_t *packed, uint64_t startBit, uint64_t endBit,
+                                     FrameRecord &record, std::vector<uint8_t> &scratch) const
+{
+    record.bitOffset = startBit;
+    record.bitLength = endBit - startBit;
+    record.data.clear();
+
+    // アボート（7個以上の連続する1）とアイドル（全て1）の判定
+    uint32_t ones = 0;
+    bool aborted = false;
+    bool allOnes = true;
+    for (uint64_t i = startBit; i < endBit; i++)
+    {
+        if (bitAt(packed, i))
+        {
+            if (++ones >= 7)
+            {
+                aborted = true;
+            }
+        }
+        else
+        {
+            ones = 0;
+            allOnes = false;
+        }
+    }
+    if (allOnes)
+    {
+        return false;
+    }
+    if (aborted)
+    {
+        record.status = FRAME_ABORTED;
+        return true;
+    }
+
+    scratch.resize(this->m_maxFrameSize);
+    size_t length = HDLC::destuffBits(packed, (size_t)startBit, (size_t)record.bitLength,
+                                      scratch.data(), scratch.size());
+    if (length == HDLC::DESTUFF_OVERFLOW)
+    {
+        record.status = FRAME_TOO_LONG;
+        return true;
+    }
+    if (length < 3) // アドレス + CRC(2)
+    {
+        record.status = FRAME_TOO_SHORT;
+        record.data.assign(scratch.begin(), scratch.begin() + length);
+        return true;
+    }
+
+    uint16_t receivedCRC = (scratch[length - 2] << 8) | scratch[length - 1];
+    uint16_t calculatedCRC = HDLC::calculateCRC16(scratch.data(), length - 2);
+    record.status = (receivedCRC == calculatedCRC) ? FRAME_OK : FRAME_CRC_ERROR;
+    record.data.assign(scratch.begin(), scratch.begin() + (length - 2));
+    return true;
+}
+
+#endif // NATIVE_TEST
@@ -0,0 +1,176 @@
+#include "HDLCPoller.h"
+
+const uint8_t HDLCPoller::MAX_CONSECUTIVE_FAILURES;
+
+HDLCPoller::HDLCPoller(HDLC &hdlc)
+    : m_hdlc(hdlc),
+      m_stationCount(0),
+      m_pollTimeoutMs(0)
+{
+    for (size_t i = 0; i < HDLC_MAX_STATIONS; i++)
+    {
+        this->m_stations[i].active = false;
+    }
+}
+
+bool HDLCPoller::addStation(uint8_t address, uint8_t weight)
+{
+    if (this->m_stationCount >= HDLC_MAX_STATIONS || this->findStation(address))
+    {
+        return false;
+    }
+
+    // 空いている領域を使う（登録済みの局は移動しない）
+    size_t slot = 0;
+    while (this->m_stations[slot].active)
+    {
+        slot++;
+    }
+    Station &station = this->m_stations[slot];
+    HDLC::initSession(station.session, address);
+    station.weight = weight;
+    station.currentWeight = 0;
+    station.consecutiveFailures = 0;
+    station.active = true;
+    this->m_stationCount++;
+    return true;
+}
+
+bool HDLCPoller::removeStation(uint8_t address)
+{
+    Station *station = this->findStation(address);
+    if (!station)
+    {
+        return false;
+    }
+    // 使用中のセッションは削除しない（HDLCが領域を参照している）
+    if (&this->m_hdlc.currentSession() == &station->session || this->m_hdlc.hasPendingRequests(&station->session))
+    {
+        return false;
+    }
+    station->active = false;
+    this->m_stationCount--;
+    return true;
+}
+
+bool HDLCPoller::setPollWeight(uint8_t address, uint8_t weight)
+{
+    Station *station = this->findStation(address);
+    if (!station)
+    {
+        return false;
+    }
+    station->weight = weight;
+    station->currentWeight = 0;
+    return true;
+}
+
+HDLCPoller::Station *HDLCPoller::findStation(uint8_t address)
+{
+    for (size_t i = 0; i < HDLC_MAX_STATIONS; i++)
+    {
+        if (this->m_stations[i].active && this->m_stations[i].session.address == address)
+        {
+            return &this->m_stations[i];
+        }
+    }
+    return nullptr;
+}
+
+HDLCPoller::Station *HDLCPoller::_selectNext()
+{
+    // 重み付きラウンドロビン: 全局の累積値に重みを加え、最大の局を選んで合計を引く
+    Station *selected = nullptr;
+    int16_t totalWeight = 0;
+    for (size_t i = 0; i < HDLC_MAX_STATIONS; i++)
+    {
+        Station &station = this->m_stations[i];
+        if (!station.active || station.weight == 0)
+        {
+            continue;
+        }
+        station.currentWeight += station.weight;
+        totalWeight += station.weight;
+        if (!selected || station.currentWeight > selected->currentWeight)
+        {
+            selected = &station;
+        }
+    }
+    if (selected)
+    {
+        selected->currentWeight -= totalWeight;
+    }
+    return selected;
+}
+
+void HDLCPoller::_recordResult(Station &station, bool responded)
+{
+    if (responded)
+    {
+        station.consecutiveFailures = 0;
+        return;
+    }
+
+    if (++station.consecutiveFailures >= MAX_CONSECUTIVE_FAILURES)
+    {
+        // 応答が続けて無い局は次回SNRMからやり直す
+        station.session.linkState = HDLC::LINK_DISCONNECTED;
+        station.consecutiveFailures = 0;
+    }
+}
+
+HDLC::PollResult HDLCPoller::pollNext(uint8_t *polledAddress)
+{
+    Station *station = this->_selectNext();
+    if (!station)
+    {
+        return HDLC::POLL_NO_RESPONSE;
+    }
+    if (polledAddress)
+    {
+        *polledAddress = station->session.address;
+    }
+
+    HDLC::StationSession *previous = &this->m_hdlc.currentSession();
+    this->m_hdlc.selectSession(&station->session);
+
+    HDLC::PollResult result;
+    if (station->session.linkState != HDLC::LINK_CONNECTED)
+    {
+        result = this->m_hdlc.sendSNRMAndWaitUA() ? HDLC::POLL_READY : HDLC::POLL_NO_RESPONSE;
+    }
+    else
+    {
+        result = this->m_hdlc.pollStation(this->m_pollTimeoutMs);
+    }
+    this->_recordResult(*station, result != HDLC::POLL_NO_RESPONSE);
+
+    this->m_hdlc.selectSession(previous);
+    return result;
+}
+
+bool HDLCPoller::sendTo(uint8_t address, const uint8_t *data, size_t length)
+{
+    Station *station = this->findStation(address);
+    if (!station)
+    {
+        return false;
+    }
+
+    HDLC::StationSession *previous = &this->m_hdlc.currentSession();
+    this->m_hdlc.selectSession(&station->session);
+
+    bool success = true;
+    if (station->session.linkState != HDLC::LINK_CONNECTED)
+    {
+        success = this->m_hdlc.sendSNRMAndWaitUA();
+    }
+    if (success)
+    {
+        success = this->m_hdlc.sendICommand(data, length);
+    }
+    this->_recordResult(*station, success);
+
+    this->m_hdlc.selectSession(previous);
+    return success;
+}
@@ -0,0 +1,211 @@
+#include "HDLCSegmenter.h"
+
+const size_t HDLCSegmenter::MAX_FRAGMENT_DATA;
+
+namespace
+{
+    /**
+     * @brief バッファからsendMessageへ渡すための読み出し位置
+     */
+    struct BufferCursor
+    {
+        const uint8_t *data;
+        size_t remaining;
+    };
+
+    size_t readFromBuffer(uint8_t *buffer, size_t maxLength, void *context)
+    {
+        BufferCursor *cursor = static_cast<BufferCursor *>(context);
+        size_t length = cursor->remaining < maxLength ? cursor->remaining : maxLength;
+        memcpy(buffer, cursor->data, length);
+        cursor->data += length;
+        cursor->remaining -= length;
+        return length;
+    }
+}
+
+HDLCSegmenter::HDLCSegmenter(HDLC &hdlc)
+    : m_hdlc(hdlc),
+      m_sendIndex(0),
+      m_messageBuffer(nullptr),
+      m_messageBufferSize(0),
+      m_messageCallback(nullptr),
+      m_messageContext(nullptr),
+      m_messageSink(nullptr),
+      m_sinkContext(nullptr),
+      m_receiving(false),
+      m_receiveIndex(0),
+      m_receivedLength(0),
+      m_droppedMessages(0)
+{
+}
+
+bool HDLCSegmenter::sendMessage(const uint8_t *data, size_t length)
+{
+    if (!data || length == 0)
+    {
+        return false;
+    }
+    BufferCursor cursor = {data, length};
+    return this->sendMessage(readFromBuffer, &cursor);
+}
+
+bool HDLCSegmenter::sendMessage(MessageSource source, void *context)
+{
+    if (!source)
+    {
+        return false;
+    }
+
+    // 最後の断片を判定するため、1つ先の断片まで取り出しておく
+    Fragment fragments[HDLC_SEGMENT_BATCH + 1];
+    fragments[0].length = source(fragments[0].data + 1, MAX_FRAGMENT_DATA, context);
+    if (fragments[0].length == 0)
+    {
+        return false;
+    }
+
+    if (this->m_hdlc.currentSession().linkState != HDLC::LINK_CONNECTED && !this->m_hdlc.sendSNRMAndWaitUA())
+    {
+        return false;
+    }
+
+    this->m_sendIndex = 0;
+    size_t count = 1;
+    bool first = true;
+    while (true)
+    {
+        bool end = false;
+        while (count < HDLC_SEGMENT_BATCH + 1)
+        {
+            Fragment &next = fragments[count];
+            next.length = source(next.data + 1, MAX_FRAGMENT_DATA, context);
+            if (next.length == 0)
+            {
+                end = true;
+                break;
+            }
+            count++;
+        }
+
+        size_t sendCount = end ? count : HDLC_SEGMENT_BATCH;
+        if (!this->_sendFragments(fragments, sendCount, first, end))
+        {
+            return false;
+        }
+        if (end)
+        {
+            return true;
+        }
+
+        // 取り出し済みの次の断片を先頭へ
+        memcpy(fragments[0].data + 1, fragments[HDLC_SEGMENT_BATCH].data + 1, fragments[HDLC_SEGMENT_BATCH].length);
+        fragments[0].length = fragments[HDLC_SEGMENT_BATCH].length;
+        count = 1;
+        first = false;
+    }
+}
+
+bool HDLCSegmenter::_sendFragments(Fragment *fragments, size_t count, bool first, bool last)
+{
+    const uint8_t *payloads[HDLC_SEGMENT_BATCH];
+    size_t lengths[HDLC_SEGMENT_BATCH];
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t header = this->m_sendIndex & FRAGMENT_INDEX_MASK;
+        if (first && i == 0)
+        {
+            header |= FRAGMENT_FIRST;
+        }
+        if (!last || i + 1 < count)
+        {
+            header |= FRAGMENT_MORE;
+        }
+        fragments[i].data[0] = header;
+        payloads[i] = fragments[i].data;
+        lengths[i] = 1 + fragments[i].length;
+        this->m_sendIndex++;
+    }
+    return this->m_hdlc.sendIFrames(payloads, lengths, count) == count;
+}
+
+void HDLCSegmenter::setMessageBuffer(uint8_t *buffer, size_t size, MessageCallback callback, void *context)
+{
+    this->m_messageBuffer = buffer;
+    this->m_messageBufferSize = buffer ? size : 0;
+    this->m_messageCallback = callback;
+    this->m_messageContext = context;
+    this->m_receiving = false;
+}
+
+void HDLCSegmenter::setMessageSink(MessageSink sink, void *context)
+{
+    this->m_messageSink = sink;
+    this->m_sinkContext = context;
+    this->m_receiving = false;
+}
+
+void HDLCSegmenter::_dropMessage()
+{
+    if (this->m_receiving)
+    {
+        this->m_droppedMessages++;
+    }
+    this->m_receiving = false;
+}
+
+bool HDLCSegmenter::processFrame(const uint8_t *frame, size_t length)
+{
+    size_t headerSize = this->m_hdlc.frameHeaderSize();
+    if (!frame || length <= headerSize || (frame[1] & 0x01) != 0)
+    {
+        return false; // 断片ヘッダの無いフレーム、またはI形式以外
+    }
+
+    uint8_t fragmentHeader = frame[headerSize];
+    const uint8_t *data = frame + headerSize + 1;
+    size_t dataLength = length - headerSize - 1;
+    uint8_t index = fragmentHeader & FRAGMENT_INDEX_MASK;
+    bool last = (fragmentHeader & FRAGMENT_MORE) == 0;
+
+    if (fragmentHeader & FRAGMENT_FIRST)
+    {
+        // 途中のメッセージは欠落したものとして破棄し、新しいメッセージを始める
+        this->_dropMessage();
+        this->m_receiving = true;
+        this->m_receiveIndex = index;
+        this->m_receivedLength = 0;
+    }
+    else if (!this->m_receiving || index != this->m_receiveIndex)
+    {
+        this->_dropMessage();
+        return false;
+    }
+
+    if (this->m_messageSink)
+    {
+        this->m_messageSink(data, dataLength, this->m_receivedLength, last, this->m_sinkContext);
+    }
+    else
+    {
+        if (this->m_receivedLength + dataLength > this->m_messageBufferSize)
+        {
+            this->_dropMessage();
+            return false;
+        }
+        memcpy(this->m_messageBuffer + this->m_receivedLength, data, dataLength);
+    }
+    this->m_receivedLength += dataLength;
+    this->m_receiveIndex = (index + 1) & FRAGMENT_INDEX_MASK;
+
+    if (!last)
+    {
+        return false;
+    }
+    this->m_receiving = false;
+    if (!this->m_messageSink && this->m_messageCallback)
+    {
+        this->m_messageCallback(this->m_messageBuffer, this->m_receivedLength, this->m_messageContext);
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+#include "HostProtocol.h"
+#include "HDLC.h"
+
+namespace
+{
+    /**
+     * @brief 1バイトずつCOBS符号化して出力先へ書き込む
+     */
+    struct CobsWriter
+    {
+        uint8_t *out;
+        size_t outSize;
+        size_t position; ///< 次に書き込む位置
+        size_t codeIndex; ///< 現在のブロックのコードバイトの位置
+        uint8_t code;     ///< 現在のブロックのコード（ブロック長+1）
+        bool overflow;
+
+        CobsWriter(uint8_t *buffer, size_t size)
+            : out(buffer), outSize(size), position(1), codeIndex(0), code(1), overflow(size == 0)
+        {
+        }
+
+        void put(uint8_t byte)
+        {
+            if (byte != 0)
+            {
+                if (this->position >= this->outSize)
+                {
+                    this->overflow = true;
+                    return;
+                }
+                this->out[this->position++] = byte;
+                this->code++;
+                if (this->code != 0xFF)
+                {
+                    return;
+                }
+            }
+            // 0x00または254バイトでブロックを閉じる
+            this->_closeBlock();
+        }
+
+        size_t finish()
+        {
+            if (this->overflow || this->position >= this->outSize)
+            {
+                return 0;
+            }
+            this->out[this->codeIndex] = this->code;
+            this->out[this->position++] = HostProtocol::DELIMITER;
+            return this->position;
+        }
+
+        void _closeBlock()
+        {
+            if (this->overflow || this->position >= this->outSize)
+            {
+                this->overflow = true;
+                return;
+            }
+            this->out[this->codeIndex] = this->code;
+            this->codeIndex = this->position++;
+            this->code = 1;
+        }
+    };
+}
+
+const uint8_t HostProtocol::DELIMITER;
+const size_t HostProtocol::HEADER_SIZE;
+const size_t HostProtocol::MAX_ENCODED_SIZE;
+
+HostProtocol::HostProtocol()
+    : m_length(0),
+      m_blockCode(0),
+      m_blockLeft(0),
+      m_overflow(false),
+      m_crcErrors(0),
+      m_framingErrors(0)
+{
+}
+
+size_t HostProtocol::encode(uint8_t type, uint8_t sequence, const uint8_t *payload, size_t length,
+                            uint8_t *out, size_t outSize)
+{
+    if (length > HOST_MAX_PAYLOAD || (length > 0 && !payload) || !out)
+    {
+        return 0;
+    }
+
+    uint8_t header[HEADER_SIZE] = {type, sequence, (uint8_t)length};
+
+    // CRCはヘッダとペイロードの連結に対して計算する
+    uint8_t crcInput[HEADER_SIZE + HOST_MAX_PAYLOAD];
+    for (size_t i = 0; i < HEADER_SIZE; i++)
+    {
+        crcInput[i] = header[i];
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        crcInput[HEADER_SIZE + i] = payload[i];
+    }
+    uint16_t crc = HDLC::calculateCRC16(crcInput, HEADER_SIZE + length);
+
+    CobsWriter writer(out, outSize);
+    for (size_t i = 0; i < HEADER_SIZE + length; i++)
+    {
+        writer.put(crcInput[i]);
+    }
+    writer.put((crc >> 8) & 0xFF);
+    writer.put(crc & 0xFF);
+    return writer.finish();
+}
+
+void HostProtocol::reset()
+{
+    this->m_length = 0;
+    this->m_blockCode = 0;
+    this->m_blockLeft = 0;
+    this->m_overflow = false;
+}
+
+bool HostProtocol::feed(uint8_t byte)
+{
+    if (byte == DELIMITER)
+    {
+        bool valid = this->_finishPacket();
+        this->reset();
+        return valid;
+    }
+
+    if (this->m_blockLeft == 0)
+    {
+        // 新しいブロック: 前のブロックが254バイト未満なら、その後ろに0x00があった
+        if (this->m_blockCode != 0 && this->m_blockCode != 0xFF)
+        {
+            if (this->m_length >= sizeof(this->m_buffer))
+            {
+                this->m_overflow = true;
+            }
+            else
+            {
+                this->m_buffer[this->m_length++] = 0x00;
+            }
+        }
+        this->m_blockCode = byte;
+        this->m_blockLeft = byte - 1;
+        return false;
+    }
+
+    if (this->m_length >= sizeof(this->m_buffer))
+    {
+        this->m_overflow = true;
+    }
+    else
+    {
+        this->m_buffer[this->m_length++] = byte;
+    }
+    this->m_blockLeft--;
+    return false;
+}
+
+bool HostProtocol::_finishPacket()
+{
+    if (this->m_length == 0 && this->m_blockCode == 0)
+    {
+        return false; // 連続した区切り（同期用）は無視
+    }
+
+    if (this->m_overflow || this->m_blockLeft != 0 || this->m_length < HEADER_SIZE + 2 ||
+        this->m_length != HEADER_SIZE + (size_t)this->m_buffer[2] + 2)
+    {
+        this->m_framingErrors++;
+        return false;
+    }
+
+    size_t crcOffset = this->m_length - 2;
+    uint16_t receivedCRC = ((uint16_t)this->m_buffer[crcOffset] << 8) | this->m_buffer[crcOffset + 1];
+    if (receivedCRC != HDLC::calculateCRC16(this->m_buffer, crcOffset))
+    {
+        this->m_crcErrors++;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,326 @@
+#include "OctetStuffing.h"
+#include <string.h>
+
+#if OCTET_STUFFING_WIDE_KERNELS && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define OCTET_STUFFING_X86 1
+#include <immintrin.h>
+#else
+#define OCTET_STUFFING_X86 0
+#endif
+
+const uint8_t OctetStuffing::FLAG;
+const uint8_t OctetStuffing::ESCAPE;
+const uint8_t OctetStuffing::ESCAPE_XOR;
+const size_t OctetStuffing::DECODE_ERROR;
+
+namespace
+{
+    inline bool isSpecial(uint8_t byte)
+    {
+        return byte == OctetStuffing::FLAG || byte == OctetStuffing::ESCAPE;
+    }
+
+    // 1バイトずつの参照実装
+    size_t encodeScalar(const uint8_t *data, size_t length, uint8_t *out, size_t outSize)
+    {
+        size_t position = 0;
+        out[position++] = OctetStuffing::FLAG;
+        for (size_t i = 0; i < length; i++)
+        {
+            uint8_t byte = data[i];
+            bool escaped = isSpecial(byte);
+            if (position + (escaped ? 2 : 1) + 1 > outSize) // 終了フラグ分を残す
+            {
+                return 0;
+            }
+            if (escaped)
+            {
+                out[position++] = OctetStuffing::ESCAPE;
+                byte ^= OctetStuffing::ESCAPE_XOR;
+            }
+            out[position++] = byte;
+        }
+        out[position++] = OctetStuffing::FLAG;
+        return position;
+    }
+
+    size_t decodeScalar(const uint8_t *in, size_t length, uint8_t *out, size_t outSize)
+    {
+        size_t position = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            uint8_t byte = in[i];
+            if (byte == OctetStuffing::FLAG)
+            {
+                return OctetStuffing::DECODE_ERROR;
+            }
+            if (byte == OctetStuffing::ESCAPE)
+            {
+                if (++i >= length || in[i] == OctetStuffing::FLAG)
+                {
+                    return OctetStuffing::DECODE_ERROR; // 末尾のエスケープ、またはアボート
+                }
+                byte = in[i] ^ OctetStuffing::ESCAPE_XOR;
+            }
+            if (position >= outSize)
+            {
+                return OctetStuffing::DECODE_ERROR;
+            }
+            out[position++] = byte;
+        }
+        return position;
+    }
+
+#if OCTET_STUFFING_WIDE_KERNELS
+    /**
+     * @brief 先頭から最初の0x7E/0x7Dの位置を返す（無ければlength）
+     */
+    typedef size_t (*ScanFunction)(const uint8_t *data, size_t length);
+
+    size_t scanBytes(const uint8_t *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            if (isSpecial(data[i]))
+            {
+                return i;
+            }
+        }
+        return length;
+    }
+
+    size_t scanSwar(const uint8_t *data, size_t length)
+    {
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        const uint64_t flags = ones * OctetStuffing::FLAG;
+        const uint64_t escapes = ones * OctetStuffing::ESCAPE;
+
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            // 0になったバイトの最上位ビットを立てる（最下位の一致より上は誤検出があり得る）
+            uint64_t f = word ^ flags;
+            uint64_t e = word ^ escapes;
+            uint64_t mask = (((f - ones) & ~f) | ((e - ones) & ~e)) & highs;
+            if (mask)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                return i + (size_t)(__builtin_ctzll(mask) / 8);
+#else
+                break; // 位置はバイト単位で探す
+#endif
+            }
+        }
+        return i + scanBytes(data + i, length - i);
+    }
+
+#if OCTET_STUFFING_X86
+    __attribute__((target("sse2"))) size_t scanSse2(const uint8_t *data, size_t length)
+    {
+        const __m128i flags = _mm_set1_epi8((char)OctetStuffing::FLAG);
+        const __m128i escapes = _mm_set1_epi8((char)OctetStuffing::ESCAPE);
+
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, flags), _mm_cmpeq_epi8(block, escapes));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(hits);
+            if (mask)
+            {
+                return i + (size_t)__builtin_ctz(mask);
+            }
+        }
+        return i + scanBytes(data + i, length - i);
+    }
+
+    __attribute__((target("avx2"))) size_t scanAvx2(const uint8_t *data, size_t length)
+    {
+        const __m256i flags = _mm256_set1_epi8((char)OctetStuffing::FLAG);
+        const __m256i escapes = _mm256_set1_epi8((char)OctetStuffing::ESCAPE);
+
+        size_t i = 0;
+        for (; i + 32 <= length; i += 32)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, flags), _mm256_cmpeq_epi8(block, escapes));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+            if (mask)
+            {
+                return i + (size_t)__builtin_ctz(mask);
+            }
+        }
+        // 残りもVEX命令で処理する（SSE2版を呼ぶとSSE/AVXの切り替えで遅くなる）
+        if (i + 16 <= length)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(flags)),
+                                        _mm_cmpeq_epi8(block, _mm256_castsi256_si128(escapes)));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(hits);
+            if (mask)
+            {
+                return i + (size_t)__builtin_ctz(mask);
+            }
+            i += 16;
+        }
+        return i + scanBytes(data + i, length - i);
+    }
+#endif
+
+    ScanFunction scanFunction(OctetStuffing::Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case OctetStuffing::KERNEL_SWAR:
+            return scanSwar;
+#if OCTET_STUFFING_X86
+        case OctetStuffing::KERNEL_SSE2:
+            return scanSse2;
+        case OctetStuffing::KERNEL_AVX2:
+            return scanAvx2;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    // エスケープ対象を含まない区間をまとめてコピーする
+    size_t encodeRuns(ScanFunction scan, const uint8_t *data, size_t length, uint8_t *out, size_t outSize)
+    {
+        size_t position = 0;
+        out[position++] = OctetStuffing::FLAG;
+        size_t i = 0;
+        while (i < length)
+        {
+            size_t run = scan(data + i, length - i);
+            if (position + run + 1 > outSize) // 終了フラグ分を残す
+            {
+                return 0;
+            }
+            memcpy(out + position, data + i, run);
+            position += run;
+            i += run;
+            if (i == length)
+            {
+                break;
+            }
+            if (position + 2 + 1 > outSize)
+            {
+                return 0;
+            }
+            out[position++] = OctetStuffing::ESCAPE;
+            out[position++] = data[i++] ^ OctetStuffing::ESCAPE_XOR;
+        }
+        out[position++] = OctetStuffing::FLAG;
+        return position;
+    }
+
+    size_t decodeRuns(ScanFunction scan, const uint8_t *in, size_t length, uint8_t *out, size_t outSize)
+    {
+        size_t position = 0;
+        size_t i = 0;
+        while (i < length)
+        {
+            size_t run = scan(in + i, length - i);
+            if (position + run > outSize)
+            {
+                return OctetStuffing::DECODE_ERROR;
+            }
+            memmove(out + position, in + i, run); // 同じバッファでの復号では重なる
+            position += run;
+            i += run;
+            if (i == length)
+            {
+                break;
+            }
+            if (in[i] == OctetStuffing::FLAG || i + 1 >= length || in[i + 1] == OctetStuffing::FLAG)
+            {
+                return OctetStuffing::DECODE_ERROR; // フラグの混入、末尾のエスケープ、またはアボート
+            }
+            if (position >= outSize)
+            {
+                return OctetStuffing::DECODE_ERROR;
+            }
+            out[position++] = in[i + 1] ^ OctetStuffing::ESCAPE_XOR;
+            i += 2;
+        }
+        return position;
+    }
+#endif
+}
+
+bool OctetStuffing::isKernelSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SCALAR:
+        return true;
+#if OCTET_STUFFING_WIDE_KERNELS
+    case KERNEL_SWAR:
+        return true;
+#if OCTET_STUFFING_X86
+    case KERNEL_SSE2:
+    case KERNEL_AVX2:
+    {
+        // CPUの判定は初回だけ行う
+        static const bool sse2 = (__builtin_cpu_init(), __builtin_cpu_supports("sse2") != 0);
+        static const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+        return kernel == KERNEL_SSE2 ? sse2 : avx2;
+    }
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+OctetStuffing::Kernel OctetStuffing::activeKernel()
+{
+#if OCTET_STUFFING_WIDE_KERNELS
+    static const Kernel kernel = isKernelSupported(KERNEL_AVX2)   ? KERNEL_AVX2
+                                 : isKernelSupported(KERNEL_SSE2) ? KERNEL_SSE2
+                                                                  : KERNEL_SWAR;
+    return kernel;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+size_t OctetStuffing::encodeFrame(Kernel kernel, const uint8_t *data, size_t length, uint8_t *out, size_t outSize)
+{
+    if ((length > 0 && !data) || !out || outSize < 2)
+    {
+        return 0;
+    }
+#if OCTET_STUFFING_WIDE_KERNELS
+    ScanFunction scan = isKernelSupported(kernel) ? scanFunction(kernel) : nullptr;
+    if (scan)
+    {
+        return encodeRuns(scan, data, length, out, outSize);
+    }
+#else
+    (void)kernel;
+#endif
+    return encodeScalar(data, length, out, outSize);
+}
+
+size_t OctetStuffing::decode(Kernel kernel, const uint8_t *in, size_t length, uint8_t *out, size_t outSize)
+{
+    if ((length > 0 && !in) || !out)
+    {
+        return DECODE_ERROR;
+    }
+#if OCTET_STUFFING_WIDE_KERNELS
+    ScanFunction scan = isKernelSupported(kernel) ? scanFunction(kernel) : nullptr;
+    if (scan)
+    {
+        return decodeRuns(scan, in, length, out, outSize);
+    }
+#else
+    (void)kernel;
+#endif
+    return decodeScalar(in, length, out, outSize);
+}
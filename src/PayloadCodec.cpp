@@ -0,0 +1,161 @@
+#include "PayloadCodec.h"
+
+namespace
+{
+    // RLEで繰り返しにする最小の長さと、1つの制御バイトで表せる最大の長さ
+    const size_t RLE_MIN_RUN = 3;
+    const size_t RLE_MAX_RUN = 0x7F + RLE_MIN_RUN;
+    const size_t RLE_MAX_LITERAL = 0x80;
+}
+
+const size_t PayloadCodec::MAX_DELTA_INPUT;
+
+size_t PayloadCodec::_encodeRle(const uint8_t *input, size_t length, bool delta, uint8_t *output, size_t limit)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < length)
+    {
+        uint8_t value = PayloadCodec::_valueAt(input, in, delta);
+        size_t run = 1;
+        while (in + run < length && run < RLE_MAX_RUN && PayloadCodec::_valueAt(input, in + run, delta) == value)
+        {
+            run++;
+        }
+
+        if (run >= RLE_MIN_RUN)
+        {
+            if (out + 2 > limit)
+            {
+                return 0;
+            }
+            output[out++] = (uint8_t)(0x80 | (run - RLE_MIN_RUN));
+            output[out++] = value;
+            in += run;
+            continue;
+        }
+
+        // 次の繰り返しの手前までをリテラルにする
+        size_t start = in;
+        while (in < length && in - start < RLE_MAX_LITERAL)
+        {
+            if (in + 2 < length)
+            {
+                uint8_t next = PayloadCodec::_valueAt(input, in, delta);
+                if (PayloadCodec::_valueAt(input, in + 1, delta) == next &&
+                    PayloadCodec::_valueAt(input, in + 2, delta) == next)
+                {
+                    break;
+                }
+            }
+            in++;
+        }
+        size_t literal = in - start;
+        if (out + 1 + literal > limit)
+        {
+            return 0;
+        }
+        output[out++] = (uint8_t)(literal - 1);
+        for (size_t i = start; i < in; i++)
+        {
+            output[out++] = PayloadCodec::_valueAt(input, i, delta);
+        }
+    }
+    return out;
+}
+
+size_t PayloadCodec::compress(const uint8_t *input, size_t length, uint8_t *output, size_t maxOutput)
+{
+    if (!input || length == 0 || !output || maxOutput == 0)
+    {
+        return 0;
+    }
+
+    // 縮まない場合は無圧縮なので、元の長さ未満に収まる符号だけを採用する（出力先の範囲内で符号化する）
+    size_t limit = ((length < maxOutput) ? length : maxOutput) - 1;
+    size_t best = PayloadCodec::_encodeRle(input, length, false, output + 1, limit);
+    uint8_t codec = best ? (uint8_t)CODEC_RLE : (uint8_t)CODEC_NONE;
+
+    if (length <= MAX_DELTA_INPUT)
+    {
+        uint8_t deltaOutput[MAX_DELTA_INPUT];
+        size_t deltaLength = PayloadCodec::_encodeRle(input, length, true, deltaOutput, best ? best - 1 : limit);
+        if (deltaLength > 0)
+        {
+            memcpy(output + 1, deltaOutput, deltaLength);
+            best = deltaLength;
+            codec = CODEC_DELTA_RLE;
+        }
+    }
+
+    if (codec == CODEC_NONE)
+    {
+        best = length;
+        if (1 + best > maxOutput)
+        {
+            return 0;
+        }
+        memcpy(output + 1, input, length);
+    }
+    output[0] = codec;
+    return 1 + best;
+}
+
+size_t PayloadCodec::decompress(const uint8_t *input, size_t length, uint8_t *output, size_t maxOutput)
+{
+    if (!input || length == 0 || !output)
+    {
+        return 0;
+    }
+
+    uint8_t codec = input[0];
+    if (codec == CODEC_NONE)
+    {
+        if (length - 1 > maxOutput)
+        {
+            return 0;
+        }
+        memcpy(output, input + 1, length - 1);
+        return length - 1;
+    }
+    if (codec != CODEC_RLE && codec != CODEC_DELTA_RLE)
+    {
+        return 0;
+    }
+
+    size_t out = 0;
+    for (size_t in = 1; in < length;)
+    {
+        uint8_t control = input[in++];
+        if (control & 0x80)
+        {
+            size_t run = (control & 0x7F) + RLE_MIN_RUN;
+            if (in >= length || out + run > maxOutput)
+            {
+                return 0;
+            }
+            memset(output + out, input[in++], run);
+            out += run;
+        }
+        else
+        {
+            size_t literal = (size_t)control + 1;
+            if (in + literal > length || out + literal > maxOutput)
+            {
+                return 0;
+            }
+            memcpy(output + out, input + in, literal);
+            in += literal;
+            out += literal;
+        }
+    }
+
+    if (codec == CODEC_DELTA_RLE)
+    {
+        for (size_t i = 1; i < out; i++)
+        {
+            output[i] = (uint8_t)(output[i] + output[i - 1]);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,117 @@
+#include "PcapWriter.h"
+#include <string.h>
+
+namespace
+{
+    const size_t GLOBAL_HEADER_SIZE = 24;
+    const size_t RECORD_HEADER_SIZE = 16;
+    const size_t DIRECTION_HEADER_SIZE = 1;
+    const size_t FCS_SIZE = 2; // LAPBのパケットにFCSは含めない
+}
+
+const uint32_t PcapWriter::LINKTYPE;
+
+PcapWriter::PcapWriter(IByteSink &sink, uint8_t *buffer, size_t bufferSize)
+    : m_sink(sink),
+      m_buffer(buffer),
+      m_bufferSize(buffer ? bufferSize : 0),
+      m_used(0),
+      m_timeBaseSeconds(0),
+      m_lastMicros(0),
+      m_wrapCount(0),
+      m_droppedFrames(0),
+      m_crcErrorFrames(0)
+{
+}
+
+bool PcapWriter::begin()
+{
+    if (this->m_used + GLOBAL_HEADER_SIZE > this->m_bufferSize)
+    {
+        return false;
+    }
+
+    this->_put32(0xA1B2C3D4); // マジックナンバー（マイクロ秒精度）
+    this->_put16(2);          // メジャーバージョン
+    this->_put16(4);          // マイナーバージョン
+    this->_put32(0);          // タイムゾーン補正
+    this->_put32(0);          // タイムスタンプ精度
+    this->_put32(0xFFFF);     // スナップ長
+    this->_put32(LINKTYPE);
+    return true;
+}
+
+void PcapWriter::logFrame(uint32_t timestampMicros, bool received, bool crcValid,
+                          const uint8_t *frame, size_t length)
+{
+    if (!frame || length <= FCS_SIZE)
+    {
+        return;
+    }
+    if (received && !crcValid)
+    {
+        this->m_crcErrorFrames++;
+        return;
+    }
+    length -= FCS_SIZE;
+
+    size_t recordSize = RECORD_HEADER_SIZE + DIRECTION_HEADER_SIZE + length;
+    if (this->m_used + recordSize > this->m_bufferSize)
+    {
+        this->m_droppedFrames++;
+        return;
+    }
+
+    // 32ビットのマイクロ秒カウンタを桁あふれ込みの時刻へ拡張
+    if (timestampMicros < this->m_lastMicros)
+    {
+        this->m_wrapCount++;
+    }
+    this->m_lastMicros = timestampMicros;
+    uint64_t totalMicros = ((uint64_t)this->m_wrapCount << 32) | timestampMicros;
+
+    uint32_t capturedLength = (uint32_t)(DIRECTION_HEADER_SIZE + length);
+    this->_put32(this->m_timeBaseSeconds + (uint32_t)(totalMicros / 1000000UL));
+    this->_put32((uint32_t)(totalMicros % 1000000UL));
+    this->_put32(capturedLength);
+    this->_put32(capturedLength);
+
+    uint8_t direction = received ? DIRECTION_RECEIVED : DIRECTION_SENT;
+    this->m_buffer[this->m_used++] = direction;
+    memcpy(this->m_buffer + this->m_used, frame, length);
+    this->m_used += length;
+}
+
+size_t PcapWriter::flush()
+{
+    if (this->m_used == 0)
+    {
+        return 0;
+    }
+
+    size_t written = this->m_sink.write(this->m_buffer, this->m_used);
+    if (written >= this->m_used)
+    {
+        this->m_used = 0;
+        return written;
+    }
+
+    // 部分書き込みの場合は残りを先頭へ詰める
+    memmove(this->m_buffer, this->m_buffer + written, this->m_used - written);
+    this->m_used -= written;
+    return written;
+}
+
+void PcapWriter::_put32(uint32_t value)
+{
+    this->m_buffer[this->m_used++] = value & 0xFF;
+    this->m_buffer[this->m_used++] = (value >> 8) & 0xFF;
+    this->m_buffer[this->m_used++] = (value >> 16) & 0xFF;
+    this->m_buffer[this->m_used++] = (value >> 24) & 0xFF;
+}
+
+void PcapWriter::_put16(uint16_t value)
+{
+    this->m_buffer[this->m_used++] = value & 0xFF;
+    this->m_buffer[this->m_used++] = (value >> 8) & 0xFF;
+}
@@ -0,0 +1,194 @@
+#ifdef NATIVE_TEST
+
+#include "PinTraceRecorder.h"
+
+namespace
+{
+    // VCDの信号識別子と信号名
+    const char VCD_IDS[BitTrace::CHANNEL_COUNT] = {'t', 'r', 'd'};
+    const char *const VCD_NAMES[BitTrace::CHANNEL_COUNT] = {"tx", "rx", "de"};
+
+    // 大容量キャプチャ向けの書き込みバッファサイズ
+    const size_t FILE_BUFFER_SIZE = 64 * 1024;
+}
+
+PinTraceRecorder::PinTraceRecorder(IPinInterface &inner, uint8_t txPin, uint8_t rxPin, uint8_t dePin)
+    : m_inner(inner),
+      m_file(nullptr),
+      m_format(BitTrace::FORMAT_BINARY),
+      m_lastRawMicros(0),
+      m_elapsedMicros(0),
+      m_lastRecordMicros(0),
+      m_edgeCount(0)
+{
+    this->m_pins[BitTrace::CHANNEL_TX] = txPin;
+    this->m_pins[BitTrace::CHANNEL_RX] = rxPin;
+    this->m_pins[BitTrace::CHANNEL_DE] = dePin;
+    for (size_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+    {
+        this->m_levels[i] = 0xFF;
+    }
+}
+
+PinTraceRecorder::~PinTraceRecorder()
+{
+    this->close();
+}
+
+bool PinTraceRecorder::open(const char *path, BitTrace::Format format)
+{
+    this->close();
+
+    this->m_file = fopen(path, "wb");
+    if (!this->m_file)
+    {
+        return false;
+    }
+    setvbuf(this->m_file, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+    this->m_format = format;
+    this->m_lastRawMicros = this->m_inner.micros();
+    this->m_elapsedMicros = 0;
+    this->m_lastRecordMicros = 0;
+    this->m_edgeCount = 0;
+    for (size_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+    {
+        this->m_levels[i] = 0xFF;
+    }
+
+    if (format == BitTrace::FORMAT_VCD)
+    {
+        fputs("$version ArduinoHDLC_RS485 PinTraceRecorder $end\n", this->m_file);
+        fputs("$timescale 1us $end\n", this->m_file);
+        fputs("$scope module rs485 $end\n", this->m_file);
+        for (size_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+        {
+            fprintf(this->m_file, "$var wire 1 %c %s $end\n", VCD_IDS[i], VCD_NAMES[i]);
+        }
+        fputs("$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n", this->m_file);
+        for (size_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+        {
+            fprintf(this->m_file, "x%c\n", VCD_IDS[i]);
+        }
+        fputs("$end\n", this->m_file);
+    }
+    else
+    {
+        uint8_t header[BitTrace::HEADER_SIZE] = {
+            BitTrace::MAGIC[0], BitTrace::MAGIC[1], BitTrace::MAGIC[2], BitTrace::MAGIC[3],
+            BitTrace::VERSION, BitTrace::CHANNEL_COUNT, 0, 0};
+        fwrite(header, 1, sizeof(header), this->m_file);
+    }
+
+    return true;
+}
+
+void PinTraceRecorder::close()
+{
+    if (this->m_file)
+    {
+        fclose(this->m_file);
+        this->m_file = nullptr;
+    }
+}
+
+uint8_t PinTraceRecorder::_channelOf(uint8_t pin) const
+{
+    for (uint8_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+    {
+        if (this->m_pins[i] == pin)
+        {
+            return i;
+        }
+    }
+    return BitTrace::CHANNEL_COUNT;
+}
+
+uint64_t PinTraceRecorder::_now()
+{
+    // 32ビットのmicros()の桁あふれを吸収して64ビットに拡張
+    uint32_t raw = this->m_inner.micros();
+    this->m_elapsedMicros += (uint32_t)(raw - this->m_lastRawMicros);
+    this->m_lastRawMicros = raw;
+    return this->m_elapsedMicros;
+}
+
+void PinTraceRecorder::_recordLevel(uint8_t channel, uint8_t level)
+{
+    level = level ? 1 : 0;
+    if (!this->m_file || this->m_levels[channel] == level)
+    {
+        return;
+    }
+    this->m_levels[channel] = level;
+
+    uint64_t now = this->_now();
+    if (this->m_format == BitTrace::FORMAT_VCD)
+    {
+        if (now != this->m_lastRecordMicros || this->m_edgeCount == 0)
+        {
+            fprintf(this->m_file, "#%llu\n", (unsigned long long)now);
+        }
+        fprintf(this->m_file, "%c%c\n", level ? '1' : '0', VCD_IDS[channel]);
+    }
+    else
+    {
+        uint8_t record[10];
+        size_t length = BitTrace::encodeRecord(now - this->m_lastRecordMicros, channel, level, record);
+        fwrite(record, 1, length, this->m_file);
+    }
+    this->m_lastRecordMicros = now;
+    this->m_edgeCount++;
+}
+
+void PinTraceRecorder::pinMode(uint8_t pin, uint8_t mode)
+{
+    this->m_inner.pinMode(pin, mode);
+}
+
+void PinTraceRecorder::digitalWrite(uint8_t pin, uint8_t value)
+{
+    this->m_inner.digitalWrite(pin, value);
+    uint8_t channel = this->_channelOf(pin);
+    if (channel != BitTrace::CHANNEL_COUNT && channel != BitTrace::CHANNEL_RX)
+    {
+        this->_recordLevel(channel, value);
+    }
+}
+
+uint8_t PinTraceRecorder::digitalRead(uint8_t pin)
+{
+    uint8_t value = this->m_inner.digitalRead(pin);
+    if (pin == this->m_pins[BitTrace::CHANNEL_RX])
+    {
+        this->_recordLevel(BitTrace::CHANNEL_RX, value);
+    }
+    return value;
+}
+
+void PinTraceRecorder::attachInterrupt(uint8_t interruptNum, void (*callback)(), uint8_t mode)
+{
+    this->m_inner.attachInterrupt(interruptNum, callback, mode);
+}
+
+void PinTraceRecorder::detachInterrupt(uint8_t interruptNum)
+{
+    this->m_inner.detachInterrupt(interruptNum);
+}
+
+void PinTraceRecorder::delayMicroseconds(uint32_t microseconds)
+{
+    this->m_inner.delayMicroseconds(microseconds);
+}
+
+uint32_t PinTraceRecorder::millis()
+{
+    return this->m_inner.millis();
+}
+
+uint32_t PinTraceRecorder::micros()
+{
+    return this->m_inner.micros();
+}
+
+#endif // NATIVE_TEST
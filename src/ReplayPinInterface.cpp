@@ -0,0 +1,395 @@
+#ifdef NATIVE_TEST
+
+#include "ReplayPinInterface.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ReplayPinInterface::ReplayPinInterface(uint8_t rxPin)
+    : m_rxPin(rxPin),
+      m_replayChannel(BitTrace::CHANNEL_RX),
+      m_data(nullptr),
+      m_length(0),
+      m_position(0),
+      m_mappedBase(nullptr),
+      m_mappedLength(0),
+      m_hasNextEdge(false),
+      m_edgeTimeMicros(0),
+      m_nowMicros(0),
+      m_level(1)
+{
+    this->m_vcdNames[BitTrace::CHANNEL_TX] = "tx";
+    this->m_vcdNames[BitTrace::CHANNEL_RX] = "rx";
+    this->m_vcdNames[BitTrace::CHANNEL_DE] = "de";
+    memset(this->m_pinValues, 0, sizeof(this->m_pinValues));
+}
+
+ReplayPinInterface::~ReplayPinInterface()
+{
+    this->close();
+}
+
+void ReplayPinInterface::setVcdSignalName(BitTrace::Channel channel, const char *name)
+{
+    if (channel < BitTrace::CHANNEL_COUNT && name)
+    {
+        this->m_vcdNames[channel] = name;
+    }
+}
+
+bool ReplayPinInterface::open(const char *path)
+{
+    this->close();
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    uint8_t magic[4] = {0};
+    size_t magicLength = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (magicLength < sizeof(magic) || memcmp(magic, BitTrace::MAGIC, sizeof(magic)) != 0)
+    {
+        // HBT1でなければVCDとして読み込む
+        return this->_loadVcd(path);
+    }
+
+#if !defined(_WIN32)
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    this->m_mappedBase = base;
+    this->m_mappedLength = (size_t)st.st_size;
+    if (!this->openMemory(static_cast<const uint8_t *>(base), (size_t)st.st_size))
+    {
+        this->_unmap();
+        return false;
+    }
+    return true;
+#else
+    // メモリマップが使えない環境では全体を読み込む
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    this->m_ownedData.resize(size > 0 ? (size_t)size : 0);
+    size_t readLength = fread(this->m_ownedData.data(), 1, this->m_ownedData.size(), file);
+    fclose(file);
+    return this->openMemory(this->m_ownedData.data(), readLength);
+#endif
+}
+
+bool ReplayPinInterface::openMemory(const uint8_t *data, size_t length)
+{
+    if (!data || length < BitTrace::HEADER_SIZE || memcmp(data, BitTrace::MAGIC, 4) != 0)
+    {
+        return false;
+    }
+    this->m_data = data;
+    this->m_length = length;
+    this->rewind();
+    return true;
+}
+
+void ReplayPinInterface::close()
+{
+    this->_unmap();
+    this->m_ownedData.clear();
+    this->m_data = nullptr;
+    this->m_length = 0;
+    this->rewind();
+}
+
+void ReplayPinInterface::_unmap()
+{
+#if !defined(_WIN32)
+    if (this->m_mappedBase)
+    {
+        munmap(this->m_mappedBase, this->m_mappedLength);
+    }
+#endif
+    this->m_mappedBase = nullptr;
+    this->m_mappedLength = 0;
+}
+
+void ReplayPinInterface::rewind()
+{
+    this->m_position = BitTrace::HEADER_SIZE;
+    this->m_edgeTimeMicros = 0;
+    this->m_nowMicros = 0;
+    this->m_level = 1; // 記録前はアイドル（マーク）とみなす
+    this->m_hasNextEdge = false;
+    if (this->m_data)
+    {
+        this->m_hasNextEdge = this->_loadNextEdge();
+    }
+}
+
+bool ReplayPinInterface::isFinished() const
+{
+    return !this->m_hasNextEdge;
+}
+
+bool ReplayPinInterface::_loadNextEdge()
+{
+    // 再生対象チャネルのレコードだけを取り出す
+    while (this->m_position < this->m_length)
+    {
+        uint64_t delta;
+        uint8_t channel;
+        uint8_t level;
+        size_t consumed = BitTrace::decodeRecord(this->m_data + this->m_position,
+                                                 this->m_length - this->m_position,
+                                                 delta, channel, level);
+        if (consumed == 0)
+        {
+            break; // 途中で切れたレコード
+        }
+        this->m_position += consumed;
+        this->m_edgeTimeMicros += delta;
+
+        if (channel == this->m_replayChannel)
+        {
+            this->m_nextEdge.timeMicros = this->m_edgeTimeMicros;
+            this->m_nextEdge.channel = channel;
+            this->m_nextEdge.level = level;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReplayPinInterface::_advance()
+{
+    while (this->m_hasNextEdge && this->m_nextEdge.timeMicros <= this->m_nowMicros)
+    {
+        this->m_level = this->m_nextEdge.level;
+        this->m_hasNextEdge = this->_loadNextEdge();
+    }
+}
+
+bool ReplayPinInterface::_loadVcd(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    // 時間単位をマイクロ秒へ変換する係数（mul/div）
+    uint64_t mul = 1;
+    uint64_t div = 1;
+    std::string ids[BitTrace::CHANNEL_COUNT];
+    std::string firstId;
+    bool inDefinitions = true;
+    uint64_t timeMicros = 0;
+    uint64_t lastRecordMicros = 0;
+    uint8_t levels[BitTrace::CHANNEL_COUNT] = {0xFF, 0xFF, 0xFF};
+
+    std::vector<uint8_t> &out = this->m_ownedData;
+    out.assign(BitTrace::MAGIC, BitTrace::MAGIC + 4);
+    out.push_back(BitTrace::VERSION);
+    out.push_back(BitTrace::CHANNEL_COUNT);
+    out.push_back(0);
+    out.push_back(0);
+
+    char token[256];
+    while (fscanf(file, "%255s", token) == 1)
+    {
+        if (inDefinitions)
+        {
+            if (strcmp(token, "$timescale") == 0)
+            {
+                char value[64] = {0};
+                char unit[16] = {0};
+                if (fscanf(file, "%63s", value) != 1)
+                {
+                    break;
+                }
+                // "1us" と "1 us" の両方の表記に対応
+                char *unitStart = value;
+                while (*unitStart >= '0' && *unitStart <= '9')
+                {
+                    unitStart++;
+                }
+                uint64_t number = strtoull(value, nullptr, 10);
+                if (*unitStart)
+                {
+                    strncpy(unit, unitStart, sizeof(unit) - 1);
+                }
+                else if (fscanf(file, "%15s", unit) != 1)
+                {
+                    break;
+                }
+                int exponent = 0; // マイクロ秒を基準とした10のべき
+                if (strcmp(unit, "s") == 0)
+                    exponent = 6;
+                else if (strcmp(unit, "ms") == 0)
+                    exponent = 3;
+                else if (strcmp(unit, "ns") == 0)
+                    exponent = -3;
+                else if (strcmp(unit, "ps") == 0)
+                    exponent = -6;
+                else if (strcmp(unit, "fs") == 0)
+                    exponent = -9;
+                mul = number ? number : 1;
+                div = 1;
+                for (; exponent > 0; exponent--)
+                    mul *= 10;
+                for (; exponent < 0; exponent++)
+                    div *= 10;
+            }
+            else if (strcmp(token, "$var") == 0)
+            {
+                char type[32], size[16], id[64], name[128];
+                if (fscanf(file, "%31s %15s %63s %127s", type, size, id, name) != 4)
+                {
+                    break;
+                }
+                if (firstId.empty())
+                {
+                    firstId = id;
+                }
+                for (size_t i = 0; i < BitTrace::CHANNEL_COUNT; i++)
+                {
+                    if (this->m_vcdNames[i] == name)
+                    {
+                        ids[i] = id;
+                    }
+                }
+            }
+            else if (strcmp(token, "$enddefinitions") == 0)
+            {
+                inDefinitions = false;
+                // 名前が一致しない場合は最初の信号を再生対象チャネルに割り当てる
+                if (ids[this->m_replayChannel].empty())
+                {
+                    ids[this->m_replayChannel] = firstId;
+                }
+            }
+            continue;
+        }
+
+        if (token[0] == '#')
+        {
+            timeMicros = strtoull(token + 1, nullptr, 10) * mul / div;
+        }
+        else if (token[0] == 'b' || token[0] == 'B' || token[0] == 'r' || token[0] == 'R')
+        {
+            // ベクタ値は対象外（識別子を読み飛ばす）
+            if (fscanf(file, "%255s", token) != 1)
+            {
+                break;
+            }
+        }
+        else if (token[0] == '0' || token[0] == '1' || token[0] == 'x' || token[0] == 'X' ||
+                 token[0] == 'z' || token[0] == 'Z')
+        {
+            const char *id = token + 1;
+            uint8_t level = (token[0] == '1') ? 1 : 0;
+            if (token[0] != '0' && token[0] != '1')
+            {
+                continue; // 不定値はレベル変化として扱わない
+            }
+            for (uint8_t channel = 0; channel < BitTrace::CHANNEL_COUNT; channel++)
+            {
+                if (!ids[channel].empty() && ids[channel] == id && levels[channel] != level)
+                {
+                    levels[channel] = level;
+                    uint8_t record[10];
+                    size_t length = BitTrace::encodeRecord(timeMicros - lastRecordMicros, channel, level, record);
+                    out.insert(out.end(), record, record + length);
+                    lastRecordMicros = timeMicros;
+                }
+            }
+        }
+        // $dumpvars等のキーワードは無視
+    }
+    fclose(file);
+
+    if (inDefinitions)
+    {
+        out.clear();
+        return false;
+    }
+    return this->openMemory(out.data(), out.size());
+}
+
+void ReplayPinInterface::pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void ReplayPinInterface::digitalWrite(uint8_t pin, uint8_t value)
+{
+    this->m_pinValues[pin] = value;
+}
+
+uint8_t ReplayPinInterface::digitalRead(uint8_t pin)
+{
+    if (pin == this->m_rxPin)
+    {
+        this->_advance();
+        return this->m_level;
+    }
+    return this->m_pinValues[pin];
+}
+
+void ReplayPinInterface::attachInterrupt(uint8_t interruptNum, void (*callback)(), uint8_t mode)
+{
+    (void)interruptNum;
+    (void)callback;
+    (void)mode;
+}
+
+void ReplayPinInterface::detachInterrupt(uint8_t interruptNum)
+{
+    (void)interruptNum;
+}
+
+void ReplayPinInterface::delayMicroseconds(uint32_t microseconds)
+{
+    // 実時間は待たずに仮想クロックだけを進める
+    this->m_nowMicros += microseconds;
+}
+
+uint32_t ReplayPinInterface::millis()
+{
+    return (uint32_t)(this->m_nowMicros / 1000);
+}
+
+uint32_t ReplayPinInterface::micros()
+{
+    return (uint32_t)this->m_nowMicros;
+}
+
+#endif // NATIVE_TEST
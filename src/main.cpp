@@ -4,6 +4,7 @@
 
 #include "HDLC.h"
 #include "ArduinoPinInterface.h"
+#include "HostProtocol.h"
 
 #if defined(ARDUINO_AVR_UNO) || defined(ARDUINO_AVR_LEONARDO)
 #define RS485_RX_PIN 5
@@ -17,18 +18,70 @@
 #define RS485_RE_PIN D4
 #endif
 
-#define RS485_BAUD_RATE 4800
+#define RS485_BAUD_RATE 4800 // 起動時の速度
+
+// 相手局が1台だけの回線で定義すると、受信CRC異常率に応じてtuneBaudRateで速度を上げ下げする。
+// マルチドロップのバスでは交渉した局だけが速度を切り替えてしまうため定義しない
+// #define RS485_POINT_TO_POINT
+
+// RS485トランシーバのDI/ROをUART（例: Serial1）に繋いだ場合に定義すると、
+// ビット操作の代わりに非同期フレーミングで送受信する（-DRS485_UART_SERIAL=Serial1）
+// #define RS485_UART_SERIAL Serial1
 
 // グローバルオブジェクト
 ArduinoPinInterface pinInterface;
 HDLC hdlc(pinInterface, RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN, RS485_RE_PIN, RS485_BAUD_RATE);
+#ifdef RS485_UART_SERIAL
+HardwareSerialByteStream uartStream(RS485_UART_SERIAL);
+#endif
+#if defined(ESP32)
+NvsConfigStorage configStorage;
+#else
+EEPROMConfigStorage configStorage;
+#endif
+
+#define COMMAND_QUEUE_SIZE 4 // 解析済みコマンドの待ち行列（送信中・送信待ちを含む）
+#define COMMAND_MAX_LENGTH (HDLC::MAX_FRAME_SIZE - 5) // Iフレームに入る最大データ長
 
-// 受信データ処理用
-size_t binaryBufferLength = 0;
-uint8_t binaryBuffer[64] = {0}; // バイナリデータ用バッファ（64バイト = 128文字の16進文字列に対応）
-char hexChar = 0;               // 16進文字のペア処理用
+/**
+ * @brief 解析済みコマンド（1行 = 1つのIフレーム）
+ */
+struct Command
+{
+    uint8_t data[COMMAND_MAX_LENGTH];
+    size_t length;
+    bool truncated;             ///< 最大長を超えた部分を捨てた
+    uint8_t sequence;           ///< バイナリモードのシーケンス番号（完了通知で返す）
+    HDLC::RequestHandle handle; ///< submitIのハンドル（未送信はINVALID_HANDLE）
+};
+
+// コマンドの待ち行列
+// [先頭, 先頭+submittedCount) は送信中、[先頭+submittedCount, 先頭+commandCount) は送信待ち、
+// 先頭+commandCount は解析中の行（待ち行列が一杯の間は入力を読まない）
+Command commandQueue[COMMAND_QUEUE_SIZE];
+size_t commandHead = 0;
+size_t commandCount = 0;
+size_t submittedCount = 0;
+
+// 16進文字列の解析状態
+char hexChar = 0; // 16進文字のペア処理用
 bool hasHexChar = false;
-bool commandReady = false;
+bool lineOpen = false; // 解析中の行のスロットを初期化済み
+int addressInput = -1; // "@<アドレス>"行の解析中の値（-1は16進データ行）
+
+// ホストとの通信モード: 人が使う16進テキストと、HostProtocolのバイナリパケット
+// テキストモードで0x00（COBSの区切り）を受信するとバイナリモードへ、
+// HOST_CMD_TEXT_MODEでテキストモードへ戻る
+enum HostMode
+{
+    HOST_MODE_TEXT,
+    HOST_MODE_BINARY
+};
+HostMode hostMode = HOST_MODE_TEXT;
+HostProtocol hostProtocol;
+
+HDLC::RequestHandle connectHandle = HDLC::INVALID_HANDLE; // 送信中のSNRM
+bool baudTunePending = false; // Iフレーム完了後、リンクが空いたら速度を調整する
 
 /**
  * @brief 16進数文字を数値に変換するユーティリティ関数
@@ -56,147 +109,374 @@ static uint8_t hexCharToValue(char hexChar)
 }
 
 /**
- * @brief HDLC受信フレームのコールバック関数
+ * @brief データを16進文字列で表示
+ * @param data データ
+ * @param length データ長
+ */
+static void printHex(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (data[i] < 0x10)
+        {
+            Serial.print('0');
+        }
+        Serial.print(data[i], HEX);
+        if (i < length - 1)
+        {
+            Serial.print(' ');
+        }
+    }
+    Serial.println();
+}
+
+/**
+ * @brief ホストへバイナリパケットを送信
+ * @param type 種別（HostProtocol::PacketType）
+ * @param sequence シーケンス番号
+ * @param payload ペイロード
+ * @param length ペイロード長
+ */
+static void sendHostPacket(uint8_t type, uint8_t sequence, const uint8_t *payload, size_t length)
+{
+    static uint8_t encoded[HostProtocol::MAX_ENCODED_SIZE];
+    size_t encodedLength = HostProtocol::encode(type, sequence, payload, length, encoded, sizeof(encoded));
+    Serial.write(encoded, encodedLength);
+}
+
+/**
+ * @brief HDLC受信フレームのコールバック関数（hdlc.service()から呼ばれる）
  * @param data 受信したデータ
  * @param length データ長
  * @param isValid CRCチェックの結果
  */
 void onFrameReceived(const uint8_t *data, size_t length, bool isValid)
 {
-    Serial.print("Received HDLC frame: ");
+    if (hostMode == HOST_MODE_BINARY)
+    {
+        uint8_t payload[1 + HDLC::MAX_FRAME_SIZE];
+        payload[0] = isValid ? 1 : 0;
+        memcpy(payload + 1, data, length);
+        sendHostPacket(HostProtocol::HOST_EVT_FRAME, 0, payload, 1 + length);
+        return;
+    }
+
+    Serial.print(F("Received HDLC frame: "));
 
     if (isValid)
     {
-        Serial.print("VALID - ");
+        Serial.print(F("VALID - "));
+        printHex(data, length);
+    }
+    else
+    {
+        Serial.println(F("INVALID CRC"));
+    }
+}
+
+/**
+ * @brief 要求結果の表示名
+ */
+static const __FlashStringHelper *requestStatusName(HDLC::RequestStatus status)
+{
+    switch (status)
+    {
+    case HDLC::REQUEST_COMPLETED:
+        return F("OK");
+    case HDLC::REQUEST_REJECTED:
+        return F("REJECTED");
+    case HDLC::REQUEST_TIMEOUT:
+        return F("TIMEOUT");
+    default:
+        return F("FAILED");
+    }
+}
 
-        // 16進数文字列として表示
-        for (size_t i = 0; i < length; i++)
+/**
+ * @brief 非同期要求の完了コールバック
+ *
+ * 要求は送信順に完了するため、Iフレームの完了は常に待ち行列の先頭のコマンド。
+ * @param handle 完了した要求
+ * @param status 結果
+ * @param context 未使用
+ */
+void onRequestCompleted(HDLC::RequestHandle handle, HDLC::RequestStatus status, void *context)
+{
+    (void)context;
+    if (handle == connectHandle)
+    {
+        connectHandle = HDLC::INVALID_HANDLE;
+        if (status != HDLC::REQUEST_COMPLETED && hostMode == HOST_MODE_TEXT)
         {
-            if (data[i] < 0x10)
-            {
-                Serial.print("0");
-            }
-            Serial.print(data[i], HEX);
-            if (i < length - 1)
-            {
-                Serial.print(" ");
-            }
+            Serial.print(F("ERROR: SNRM/UA handshake "));
+            Serial.println(requestStatusName(status));
         }
-        Serial.println();
+        return;
+    }
+
+    if (submittedCount == 0 || commandQueue[commandHead].handle != handle)
+    {
+        return;
+    }
+    Command &command = commandQueue[commandHead];
+    if (hostMode == HOST_MODE_BINARY)
+    {
+        uint8_t result = (uint8_t)status;
+        sendHostPacket(HostProtocol::HOST_EVT_COMPLETED, command.sequence, &result, 1);
     }
     else
     {
-        Serial.println("INVALID CRC");
+        Serial.print(F("I-frame "));
+        Serial.print(requestStatusName(status));
+        Serial.print(F(": "));
+        printHex(command.data, command.length);
+    }
+
+    // 先頭のコマンドを解放
+    commandHead = (commandHead + 1) % COMMAND_QUEUE_SIZE;
+    commandCount--;
+    submittedCount--;
+#ifdef RS485_POINT_TO_POINT
+    if (status == HDLC::REQUEST_COMPLETED)
+    {
+        baudTunePending = true;
     }
+#endif
 }
 
 /**
- * @brief Serial入力の処理（16進文字列を直接バイナリに変換）
+ * @brief 相手局アドレスを変更して保存（"@<アドレス>"行）
+ * @param address 新しいアドレス（0-255以外は無効）
  */
-void processSerialInput()
+void changeTargetAddress(int address)
 {
-    while (Serial.available())
+    if (address < 0 || address > 255)
+    {
+        Serial.println(F("Error: Address out of range. Please enter a number between 0-255."));
+        return;
+    }
+    if (hdlc.pendingRequests() > 0)
     {
-        char c = Serial.read();
+        Serial.println(F("Error: Link busy. Try again when all I-frames have completed."));
+        return;
+    }
+
+    // 別の局になるため、リンクはSNRMからやり直す
+    HDLC::initSession(hdlc.currentSession(), (uint8_t)address);
+    hdlc.setAddress((uint8_t)address);
+    Serial.print(F("Target address set to: "));
+    Serial.println(address);
+    if (!hdlc.saveLinkConfig())
+    {
+        Serial.println(F("WARNING: Failed to save link configuration"));
+    }
+}
+
+/**
+ * @brief テキストモードの1文字を処理（16進文字列を直接、待ち行列の空きスロットへ変換）
+ * @param command 解析中の行のスロット
+ * @param c 受信文字
+ */
+void processTextChar(Command &command, char c)
+{
+    if (!lineOpen)
+    {
+        command.length = 0;
+        command.truncated = false;
+        lineOpen = true;
+    }
 
-        Serial.print(c);
-        Serial.flush();
+    if (Serial.availableForWrite() > 0)
+    {
+        Serial.write(c);
+    }
 
-        if (c == '\n' || c == '\r')
+    if (c == '\n' || c == '\r')
+    {
+        if (addressInput >= 0)
+        {
+            changeTargetAddress(addressInput);
+            addressInput = -1;
+        }
+        else if (command.length > 0)
         {
-            if (binaryBufferLength > 0)
+            // 行を確定して待ち行列に入れる
+            if (command.truncated)
             {
-                commandReady = true;
+                Serial.println(F("WARNING: Command truncated"));
             }
+            command.sequence = 0;
+            command.handle = HDLC::INVALID_HANDLE;
+            commandCount++;
         }
-        else if (c == ' ')
+        hasHexChar = false;
+        lineOpen = false;
+    }
+    else if (c == ' ')
+    {
+        // スペースは無視
+    }
+    else if (c == '@' && command.length == 0 && !hasHexChar)
+    {
+        // 行頭の'@'は相手局アドレス（10進数）の設定
+        addressInput = 0;
+    }
+    else if (addressInput >= 0)
+    {
+        if (c >= '0' && c <= '9' && addressInput <= 255)
         {
-            // スペースは無視
-            continue;
+            addressInput = addressInput * 10 + (c - '0');
         }
-        else
+    }
+    else
+    {
+        // 16進文字の処理
+        uint8_t hexValue = hexCharToValue(c);
+        if (hexValue != 255) // 有効な16進文字
         {
-            // 16進文字の処理
-            uint8_t hexValue = hexCharToValue(c);
-            if (hexValue != 255) // 有効な16進文字
+            if (!hasHexChar)
+            {
+                // 上位4ビット
+                hexChar = hexValue << 4;
+                hasHexChar = true;
+            }
+            else
             {
-                if (!hasHexChar)
+                // 下位4ビットと結合してコマンドに格納
+                hexChar |= hexValue;
+                if (command.length < sizeof(command.data))
                 {
-                    // 上位4ビット
-                    hexChar = hexValue << 4;
-                    hasHexChar = true;
+                    command.data[command.length++] = hexChar;
                 }
                 else
                 {
-                    // 下位4ビットと結合してバイナリバッファに格納
-                    hexChar |= hexValue;
-                    if (binaryBufferLength < sizeof(binaryBuffer))
-                    {
-                        binaryBuffer[binaryBufferLength++] = hexChar;
-                    }
-                    hasHexChar = false;
+                    command.truncated = true;
                 }
+                hasHexChar = false;
             }
         }
     }
 }
 
 /**
- * @brief 受信したコマンドの処理（SNRM→UA待機→Iコマンド送信フロー）
+ * @brief 現在の状態をHOST_EVT_STATUSで送る
+ * @param sequence 問い合わせのシーケンス番号（状態の変化による通知は0）
  */
-void processCommand()
+void sendStatusPacket(uint8_t sequence)
 {
-    if (!commandReady)
+    uint32_t baudRate = hdlc.getBaudRate();
+    uint8_t status[7] = {
+        (uint8_t)(baudRate >> 24), (uint8_t)(baudRate >> 16), (uint8_t)(baudRate >> 8), (uint8_t)baudRate,
+        hdlc.currentSession().address,
+        (uint8_t)hdlc.currentSession().linkState,
+        (uint8_t)hdlc.pendingRequests()};
+    sendHostPacket(HostProtocol::HOST_EVT_STATUS, sequence, status, sizeof(status));
+}
+
+/**
+ * @brief バイナリモードで受信したパケットを処理
+ * @param command 待ち行列の空きスロット（HOST_CMD_SEND_Iの格納先）
+ */
+void processHostPacket(Command &command)
+{
+    uint8_t sequence = hostProtocol.packetSequence();
+    switch (hostProtocol.packetType())
+    {
+    case HostProtocol::HOST_CMD_SEND_I:
     {
+        size_t length = hostProtocol.payloadLength();
+        if (length == 0 || length > sizeof(command.data))
+        {
+            uint8_t error = HostProtocol::HOST_ERROR_BAD_LENGTH;
+            sendHostPacket(HostProtocol::HOST_EVT_ERROR, sequence, &error, 1);
+            return;
+        }
+        memcpy(command.data, hostProtocol.payload(), length);
+        command.length = length;
+        command.truncated = false;
+        command.sequence = sequence;
+        command.handle = HDLC::INVALID_HANDLE;
+        commandCount++;
         return;
     }
-
-    commandReady = false;
-
-    if (binaryBufferLength == 0)
+    case HostProtocol::HOST_CMD_STATUS:
+        sendStatusPacket(sequence);
+        return;
+    case HostProtocol::HOST_CMD_TEXT_MODE:
+        hostMode = HOST_MODE_TEXT;
+        Serial.println(F("Text mode"));
+        return;
+    default:
     {
-        Serial.println("No command to process.");
+        uint8_t error = HostProtocol::HOST_ERROR_UNKNOWN_COMMAND;
+        sendHostPacket(HostProtocol::HOST_EVT_ERROR, sequence, &error, 1);
         return;
     }
+    }
+}
 
-    Serial.print("Sending I-frame with data: ");
-    for (size_t i = 0; i < binaryBufferLength; i++)
+/**
+ * @brief Serial入力の処理
+ *
+ * 受信済みのバイトだけを処理して戻る。待ち行列が一杯の間は入力を読まない。
+ */
+void processSerialInput()
+{
+    while (commandCount < COMMAND_QUEUE_SIZE && Serial.available())
     {
-        if (binaryBuffer[i] < 0x10)
+        Command &command = commandQueue[(commandHead + commandCount) % COMMAND_QUEUE_SIZE];
+        uint8_t byte = Serial.read();
+
+        if (hostMode == HOST_MODE_BINARY)
         {
-            Serial.print("0");
+            if (hostProtocol.feed(byte))
+            {
+                processHostPacket(command);
+            }
         }
-        Serial.print(binaryBuffer[i], HEX);
-        if (i < binaryBufferLength - 1)
+        else if (byte == HostProtocol::DELIMITER)
         {
-            Serial.print(" ");
+            // 入力途中の行を捨ててバイナリモードへ
+            hostMode = HOST_MODE_BINARY;
+            hostProtocol.reset();
+            hasHexChar = false;
+            lineOpen = false;
+            addressInput = -1;
+        }
+        else
+        {
+            processTextChar(command, (char)byte);
         }
     }
-    Serial.println();
+}
 
-    // 1. SNRMコマンド送信とUA応答待機
-    Serial.println("Step 1: Sending SNRM and waiting for UA...");
-    if (!hdlc.sendSNRMAndWaitUA())
+/**
+ * @brief 送信待ちのコマンドをリンクへ渡す（SNRM→UA→Iコマンドの順）
+ *
+ * 要求を待ち行列に入れるだけで、送受信はloop()のhdlc.service()で進める。
+ * リンクが未確立の場合だけ先にSNRMを送る。
+ */
+void processCommand()
+{
+    while (submittedCount < commandCount)
     {
-        Serial.println("ERROR: SNRM/UA handshake failed");
-        binaryBufferLength = 0;
-        return;
-    }
-    Serial.println("SNRM/UA handshake successful");
+        if (hdlc.currentSession().linkState != HDLC::LINK_CONNECTED && connectHandle == HDLC::INVALID_HANDLE)
+        {
+            connectHandle = hdlc.connect();
+            if (connectHandle == HDLC::INVALID_HANDLE)
+            {
+                return; // リンクの待ち行列が一杯: 次のloop()で再試行
+            }
+        }
 
-    // 2. Iコマンドでデータ送信
-    Serial.println("Step 2: Sending I-frame...");
-    if (hdlc.sendICommand(binaryBuffer, binaryBufferLength))
-    {
-        Serial.println("I-frame transmission successful");
-    }
-    else
-    {
-        Serial.println("I-frame transmission failed");
+        Command &command = commandQueue[(commandHead + submittedCount) % COMMAND_QUEUE_SIZE];
+        command.handle = hdlc.submitI(command.data, command.length);
+        if (command.handle == HDLC::INVALID_HANDLE)
+        {
+            return;
+        }
+        submittedCount++;
     }
-
-    // バッファをクリア
-    binaryBufferLength = 0;
 }
 
 /**
@@ -204,120 +484,66 @@ void processCommand()
  */
 void printStatus()
 {
-    Serial.println("=== Arduino HDLC RS485 Communication (Integrated) ===");
-    Serial.println("Usage: Send hex string via Serial (e.g., '01 02 FF')");
-    Serial.println("System automatically sends SNRM before each I-frame");
-    Serial.println("System initialized and ready.");
-    Serial.print("RS485 Baud Rate: ");
-    Serial.println(RS485_BAUD_RATE);
-    Serial.println("Waiting for I-frame data...");
+    Serial.println(F("=== Arduino HDLC RS485 Communication (Integrated) ==="));
+    Serial.println(F("Usage: Send hex string via Serial (e.g., '01 02 FF')"));
+    Serial.println(F("Each line is queued as one I-frame; SNRM is sent when the link is down"));
+    Serial.println(F("Send '@<address>' to set and save the target address (0-255)"));
+    Serial.println(F("Send 0x00 to switch to the binary COBS host protocol"));
+    Serial.println(F("System initialized and ready."));
+    Serial.print(F("Target address: "));
+    Serial.println(hdlc.currentSession().address);
+    Serial.print(F("RS485 Baud Rate: "));
+    Serial.println(hdlc.getBaudRate());
+    Serial.println(F("Waiting for I-frame data..."));
 }
 
 void setup()
 {
-    // シリアル通信の初期化
+    // シリアル通信の初期化（ホストの接続は待たない）
     Serial.begin(115200);
 
-#ifdef LED_BUILTIN
-    pinMode(LED_BUILTIN, OUTPUT);
-    digitalWrite(LED_BUILTIN, LOW);
-    bool ledState = false;
-#endif
-
-    // Leonardo用の改良された初期化
-#if defined(ARDUINO_AVR_LEONARDO)
-    // Leonardoの場合：タイムアウト付きで待機
-    unsigned long startTime = millis();
-    while (!Serial && (millis() - startTime) < 3000) // 3秒でタイムアウト
-    {
-#ifdef LED_BUILTIN
-        if ((millis() - startTime) % 250 == 0) // 250ms間隔で点滅
-        {
-            digitalWrite(LED_BUILTIN, ledState ? HIGH : LOW);
-            ledState = !ledState;
-        }
-#endif
-        delay(50); // CPU負荷軽減
-    }
-
-    // Leonardoのシリアルバッファをクリア
-    delay(500); // 追加の安定化時間
-    while (Serial.available() > 0)
-    {
-        Serial.read(); // バッファクリア
-    }
-    Serial.flush(); // 送信バッファクリア
-
-#else
-    // 他のArduino（UNO等）の場合：従来通り
-    while (!Serial)
-    {
-#ifdef LED_BUILTIN
-        digitalWrite(LED_BUILTIN, ledState ? HIGH : LOW);
-        ledState = !ledState;
-#endif
-        delay(500);
-    }
-#endif
-
-#ifdef LED_BUILTIN
-    // 初期化完了の合図（短い点滅）
-    for (int i = 0; i < 6; i++)
+    // HDLC初期化（保存済みのリンク設定を読み出してすぐに戻る）
+    hdlc.setConfigStorage(&configStorage);
+    if (!hdlc.begin())
     {
-        digitalWrite(LED_BUILTIN, HIGH);
-        delay(100);
-        digitalWrite(LED_BUILTIN, LOW);
-        delay(100);
+        Serial.println(F("ERROR: Failed to initialize HDLC"));
     }
+#ifdef RS485_UART_SERIAL
+    uartStream.begin(hdlc.getBaudRate());
+    hdlc.setByteStream(&uartStream);
 #endif
 
-    Serial.println("Initializing Arduino HDLC RS485 Communication...");
-    Serial.flush(); // 出力完了を確実にする
-
-    delay(1000); // 安定化のため少し待機
-
-    // HDLC初期化
-    if (!hdlc.begin())
-    {
-        Serial.println("ERROR: Failed to initialize HDLC");
-        Serial.flush();
-        while (1)
-        {
-#ifdef LED_BUILTIN
-            digitalWrite(LED_BUILTIN, HIGH);
-            delay(200);
-            digitalWrite(LED_BUILTIN, LOW);
-            delay(200);
-#endif
-        }
-    }
+    hdlc.setCompletionCallback(onRequestCompleted);
+    hdlc.setReceiveCallback(onFrameReceived);
 
     // ステータス表示
     printStatus();
-    Serial.flush(); // 出力完了を確実にする
-
-    // Leonardo用：最終的なシリアルバッファクリア
-#if defined(ARDUINO_AVR_LEONARDO)
-    delay(200);
-    while (Serial.available() > 0)
-    {
-        Serial.read();
-    }
-    Serial.println("Leonardo: Ready for input");
-    Serial.flush();
-#endif
 }
 
 void loop()
 {
-    // Serial入力の処理
+    // Serial入力の解析、送信待ちコマンドの投入、リンクの送受信を毎回少しずつ進める
     processSerialInput();
-
-    // コマンド処理
     processCommand();
 
-    // 少し待機
-    delay(10);
+    // 応答待ちの間はすぐに戻る
+    if (!hdlc.service() && baudTunePending)
+    {
+        // 受信CRC異常率に応じて速度を調整
+        baudTunePending = false;
+        if (hdlc.tuneBaudRate())
+        {
+            if (hostMode == HOST_MODE_BINARY)
+            {
+                sendStatusPacket(0);
+            }
+            else
+            {
+                Serial.print(F("RS485 Baud Rate changed to: "));
+                Serial.println(hdlc.getBaudRate());
+            }
+        }
+    }
 }
 
 #endif // UNIT_TEST
\ No newline at end of file
@@ -2,6 +2,17 @@
 #include <gtest/gtest.h>
 #include "HDLC.h"
 #include "MockPinInterface.h"
+#include "PinTraceRecorder.h"
+#include "ReplayPinInterface.h"
+#include "HDLCCaptureDecoder.h"
+#include "PcapWriter.h"
+#include "HDLCPoller.h"
+#include "HostProtocol.h"
+#include "MockConfigStorage.h"
+#include "HDLCSegmenter.h"
+#include "PayloadCodec.h"
+#include "OctetStuffing.h"
+#include <cstdio>
 
 class HDLCResponseTest : public ::testing::Test
 {
@@ -92,6 +103,2055 @@ TEST_F(HDLCResponseTest, AddressMismatchInResponse)
     EXPECT_TRUE(true);
 }
 
+// モックのランレングス記録テスト
+TEST(MockPinInterfaceTest, RunLengthCaptureIsBounded)
+{
+    MockPinInterface mock;
+    mock.setCaptureMode(MockPinInterface::CAPTURE_RLE, 4);
+
+    // 同一レベルの連続書き込みは1区間にまとめられる
+    mock.digitalWrite(2, HIGH);
+    mock.digitalWrite(2, HIGH);
+    mock.digitalWrite(2, LOW);
+    EXPECT_EQ(2u, mock.getRunCount(2));
+    EXPECT_EQ(2u, mock.getRun(2, 0).accesses);
+    EXPECT_EQ(0u, mock.getLogSize());
+
+    // 保持数以上の位置や記録の無いピンは空の区間
+    EXPECT_EQ(0u, mock.getRun(2, 2).accesses);
+    EXPECT_EQ(0u, mock.getRun(3, 0).accesses);
+
+    // 大量のレベル変化でもリング容量を超えない
+    for (int i = 0; i < 10000; i++)
+    {
+        mock.digitalWrite(2, (i & 1) ? HIGH : LOW);
+        mock.delayMicroseconds(104);
+    }
+    EXPECT_EQ(4u, mock.getRunCount(2));
+    EXPECT_GT(mock.getDroppedRunCount(2), 0u);
+
+    // 実行カウンタはログなしでも正しい
+    EXPECT_EQ(10003, mock.countDigitalWrites(2));
+    EXPECT_EQ(5002, mock.countDigitalWrites(2, HIGH));
+    EXPECT_EQ(10000, mock.countDelays());
+    EXPECT_EQ(1040000u, mock.getTotalDelayMicros());
+}
+
+// 既定モードではログとカウンタが一致する
+TEST(MockPinInterfaceTest, FullLogCountersMatchLog)
+{
+    MockPinInterface mock;
+    mock.digitalWrite(4, HIGH);
+    mock.digitalWrite(4, LOW);
+    mock.delayMicroseconds(10);
+
+    EXPECT_EQ(3u, mock.getLogSize());
+    EXPECT_EQ(2, mock.countDigitalWrites(4));
+    EXPECT_EQ(1, mock.countDigitalWrites(4, LOW));
+    EXPECT_EQ(1, mock.countDelays());
+
+    mock.clearLog();
+    EXPECT_EQ(0, mock.countDigitalWrites(4));
+    EXPECT_EQ(0, mock.countDelays());
+}
+
+// 送信波形を記録し、別インスタンスの受信処理へ再生するテスト
+static void recordSNRM(const char *path, BitTrace::Format format)
+{
+    ReplayPinInterface idleLine(3); // ファイル無し: 仮想クロック付きのアイドル回線
+    PinTraceRecorder recorder(idleLine, 2, 3, 4);
+    ASSERT_TRUE(recorder.open(path, format));
+
+    HDLC sender(recorder, 2, 3, 4, 5, 9600);
+    sender.begin();
+    sender.sendSNRMAndWaitUA(); // 応答は無いのでタイムアウトする
+    EXPECT_GT(recorder.getEdgeCount(), 0u);
+    recorder.close();
+}
+
+static void replaySNRM(const char *path)
+{
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.open(path));
+    replay.setReplayChannel(BitTrace::CHANNEL_TX);
+
+    HDLC receiver(replay, 2, 3, 4, 5, 9600);
+    receiver.begin();
+    ASSERT_TRUE(receiver.receiveFrameWithBitControl(100));
+
+    uint8_t frame[HDLC::MAX_FRAME_SIZE];
+    ASSERT_EQ(2u, receiver.readFrame(frame, sizeof(frame)));
+    EXPECT_EQ(1, frame[0]); // テスト用デフォルトアドレス
+    EXPECT_EQ(HDLC::CMD_SNRM, frame[1]);
+}
+
+TEST(BitTraceTest, BinaryRecordAndReplay)
+{
+    const char *path = "bit_trace_test.hbt";
+    recordSNRM(path, BitTrace::FORMAT_BINARY);
+    replaySNRM(path);
+    remove(path);
+}
+
+TEST(BitTraceTest, VcdRecordAndReplay)
+{
+    const char *path = "bit_trace_test.vcd";
+    recordSNRM(path, BitTrace::FORMAT_VCD);
+    replaySNRM(path);
+    remove(path);
+}
+
+// テスト用のビット列生成ヘルパー
+class PackedBitWriter
+{
+public:
+    void bit(uint8_t value)
+    {
+        if (m_bitCount % 8 == 0)
+        {
+            m_bytes.push_back(0);
+        }
+        if (value)
+        {
+            m_bytes.back() |= (uint8_t)(1 << (7 - (m_bitCount % 8)));
+        }
+        m_bitCount++;
+    }
+
+    void flag()
+    {
+        for (int i = 7; i >= 0; i--)
+        {
+            bit((HDLC::FLAG_SEQUENCE >> i) & 1);
+        }
+    }
+
+    void idle(int bits)
+    {
+        for (int i = 0; i < bits; i++)
+        {
+            bit(1);
+        }
+    }
+
+    // アドレス・コントロール・情報・CRCをビットスタッフィング付きで書き込む
+    void frame(const std::vector<uint8_t> &body, bool corruptCRC = false)
+    {
+        std::vector<uint8_t> bytes = body;
+        uint16_t crc = HDLC::calculateCRC16(body.data(), body.size());
+        if (corruptCRC)
+        {
+            crc ^= 0x0001;
+        }
+        bytes.push_back(crc >> 8);
+        bytes.push_back(crc & 0xFF);
+
+        flag();
+        int ones = 0;
+        for (uint8_t byte : bytes)
+        {
+            for (int i = 7; i >= 0; i--)
+            {
+                uint8_t value = (byte >> i) & 1;
+                bit(value);
+                ones = value ? ones + 1 : 0;
+                if (ones == 5)
+                {
+                    bit(0);
+                    ones = 0;
+                }
+            }
+        }
+        flag();
+    }
+
+    const std::vector<uint8_t> &bytes() const { return m_bytes; }
+    uint64_t bitCount() const { return m_bitCount; }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    uint64_t m_bitCount = 0;
+};
+
+TEST(CaptureDecoderTest, ParallelDecodeMatchesCaptureOrder)
+{
+    PackedBitWriter writer;
+    writer.idle(20);
+    for (int i = 0; i < 2000; i++)
+    {
+        // 0xFFを含めてビットスタッフィングを発生させる
+        std::vector<uint8_t> body = {(uint8_t)(i & 0xFF), 0x10, 0xFF, 0x7E, (uint8_t)(i >> 8)};
+        writer.frame(body, i == 700);
+        writer.idle(i % 13);
+    }
+
+    HDLCCaptureDecoder single(1);
+    HDLCCaptureDecoder parallel(4);
+    auto expected = single.decode(writer.bytes().data(), writer.bitCount());
+    auto frames = parallel.decode(writer.bytes().data(), writer.bitCount());
+
+    ASSERT_EQ(2000u, frames.size());
+    ASSERT_EQ(expected.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        EXPECT_EQ(expected[i].bitOffset, frames[i].bitOffset);
+        EXPECT_EQ(i == 700 ? HDLCCaptureDecoder::FRAME_CRC_ERROR : HDLCCaptureDecoder::FRAME_OK,
+                  frames[i].status);
+        ASSERT_EQ(5u, frames[i].data.size());
+        EXPECT_EQ((uint8_t)(i & 0xFF), frames[i].data[0]);
+        EXPECT_EQ((uint8_t)(i >> 8), frames[i].data[4]);
+    }
+    EXPECT_EQ(1u, parallel.getSummary().crcErrors);
+    EXPECT_EQ(1999u, parallel.getSummary().validFrames);
+}
+
+TEST(CaptureDecoderTest, AbortedFrameIsReported)
+{
+    PackedBitWriter writer;
+    writer.flag();
+    for (int i = 0; i < 12; i++)
+    {
+        writer.bit(i & 1);
+    }
+    writer.idle(7); // アボート
+    writer.bit(0);
+    writer.frame({0x01, 0x63});
+
+    HDLCCaptureDecoder decoder(2);
+    auto frames = decoder.decode(writer.bytes().data(), writer.bitCount());
+    ASSERT_EQ(2u, frames.size());
+    EXPECT_EQ(HDLCCaptureDecoder::FRAME_ABORTED, frames[0].status);
+    EXPECT_EQ(HDLCCaptureDecoder::FRAME_OK, frames[1].status);
+}
+
+// メモリへ書き込むテスト用シンク
+class MemoryByteSink : public IByteSink
+{
+public:
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        bytes.insert(bytes.end(), data, data + length);
+        return length;
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+static uint32_t readLE32(const std::vector<uint8_t> &bytes, size_t offset)
+{
+    return bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | ((uint32_t)bytes[offset + 3] << 24);
+}
+
+TEST_F(HDLCResponseTest, PcapLogsTransmittedFrame)
+{
+    MemoryByteSink sink;
+    uint8_t buffer[256];
+    PcapWriter writer(sink, buffer, sizeof(buffer));
+    ASSERT_TRUE(writer.begin());
+
+    hdlc->setFrameLogger(&writer);
+    hdlc->begin();
+    hdlc->sendSNRMAndWaitUA(); // 応答なし
+
+    // flushまではシンクへ書き込まない
+    EXPECT_TRUE(sink.bytes.empty());
+    writer.flush();
+
+    // グローバルヘッダ24バイト + レコードヘッダ16バイト + 方向1バイト + フレーム2バイト（FCSは除く）
+    ASSERT_EQ(43u, sink.bytes.size());
+    EXPECT_EQ(0xA1B2C3D4u, readLE32(sink.bytes, 0));
+    EXPECT_EQ(PcapWriter::LINKTYPE, readLE32(sink.bytes, 20));
+    EXPECT_EQ(3u, readLE32(sink.bytes, 32));
+    EXPECT_EQ(PcapWriter::DIRECTION_SENT, sink.bytes[40]);
+    EXPECT_EQ(1, sink.bytes[41]);
+    EXPECT_EQ(HDLC::CMD_SNRM, sink.bytes[42]);
+}
+
+TEST(PcapWriterTest, DropsWhenBufferFullAndSkipsCRCErrors)
+{
+    MemoryByteSink sink;
+    uint8_t buffer[48];
+    PcapWriter writer(sink, buffer, sizeof(buffer));
+    ASSERT_TRUE(writer.begin());
+
+    const uint8_t frame[] = {0x01, 0x63, 0x12, 0x34};
+    writer.logFrame(1400000, true, false, frame, sizeof(frame)); // CRC異常は記録しない
+    writer.logFrame(1500000, true, true, frame, sizeof(frame));
+    writer.logFrame(1600000, true, true, frame, sizeof(frame)); // 入りきらない
+    EXPECT_EQ(1u, writer.crcErrorFrames());
+    EXPECT_EQ(1u, writer.droppedFrames());
+
+    writer.flush();
+    ASSERT_EQ(43u, sink.bytes.size());
+    EXPECT_EQ(1u, readLE32(sink.bytes, 24));      // 秒
+    EXPECT_EQ(500000u, readLE32(sink.bytes, 28)); // マイクロ秒
+    EXPECT_EQ(PcapWriter::DIRECTION_RECEIVED, sink.bytes[40]);
+    EXPECT_EQ(0x01, sink.bytes[41]);
+    EXPECT_EQ(0x63, sink.bytes[42]);
+}
+
+// 重み付きポーリングと局毎のセッション分離
+TEST_F(HDLCResponseTest, PollerHonoursWeightsAndKeepsSessionsSeparate)
+{
+    hdlc->begin();
+    HDLCPoller poller(*hdlc);
+    poller.setPollTimeout(5);
+    ASSERT_TRUE(poller.addStation(0x10, 3));
+    ASSERT_TRUE(poller.addStation(0x20, 1));
+    EXPECT_FALSE(poller.addStation(0x10, 1)); // 重複
+
+    // 0x20は接続済みで送受信シーケンスが進んでいる状態とする
+    HDLCPoller::Station *other = poller.findStation(0x20);
+    other->session.linkState = HDLC::LINK_CONNECTED;
+    other->session.sendSequence = 3;
+    other->session.receiveSequence = 5;
+    poller.setPollWeight(0x20, 0); // 巡回対象外
+
+    for (int i = 0; i < 4; i++)
+    {
+        uint8_t address = 0;
+        EXPECT_EQ(HDLC::POLL_NO_RESPONSE, poller.pollNext(&address));
+        EXPECT_EQ(0x10, address);
+    }
+    EXPECT_EQ(3, other->session.sendSequence);
+    EXPECT_EQ(5, other->session.receiveSequence);
+    EXPECT_EQ(HDLC::LINK_CONNECTED, other->session.linkState);
+
+    // 重み3:1で巡回する
+    poller.setPollWeight(0x20, 1);
+    int counts[2] = {0, 0};
+    for (int i = 0; i < 8; i++)
+    {
+        uint8_t address = 0;
+        poller.pollNext(&address);
+        counts[address == 0x10 ? 0 : 1]++;
+    }
+    EXPECT_EQ(6, counts[0]);
+    EXPECT_EQ(2, counts[1]);
+
+    // ポーリング後は既定セッションに戻る
+    EXPECT_EQ(1, hdlc->currentSession().address);
+}
+
+// 局を削除しても他の局の領域は移動せず、使用中の局は削除しないこと
+TEST_F(HDLCResponseTest, PollerKeepsStationsInPlaceOnRemoval)
+{
+    hdlc->begin();
+    HDLCPoller poller(*hdlc);
+    ASSERT_TRUE(poller.addStation(0x10));
+    ASSERT_TRUE(poller.addStation(0x20));
+    ASSERT_TRUE(poller.addStation(0x30));
+    HDLCPoller::Station *last = poller.findStation(0x30);
+
+    EXPECT_TRUE(poller.removeStation(0x10));
+    EXPECT_FALSE(poller.removeStation(0x10));
+    EXPECT_EQ(2u, poller.stationCount());
+    EXPECT_EQ(last, poller.findStation(0x30));
+    EXPECT_EQ(0x30, last->session.address);
+    EXPECT_EQ(nullptr, poller.findStation(0x10));
+
+    // 空いた領域を再利用する
+    ASSERT_TRUE(poller.addStation(0x40));
+    EXPECT_EQ(3u, poller.stationCount());
+    EXPECT_EQ(last, poller.findStation(0x30));
+
+    // 選択中の局と要求が未完了の局は削除しない
+    hdlc->selectSession(&last->session);
+    EXPECT_FALSE(poller.removeStation(0x30));
+    HDLC::RequestHandle handle = hdlc->connect();
+    ASSERT_NE(HDLC::INVALID_HANDLE, handle);
+    hdlc->selectSession(nullptr);
+    EXPECT_TRUE(hdlc->hasPendingRequests(&last->session));
+    EXPECT_FALSE(poller.removeStation(0x30));
+    EXPECT_TRUE(poller.removeStation(0x20));
+    EXPECT_EQ(last, poller.findStation(0x30));
+}
+
+// 記録した波形の最初のフレームを読み出すヘルパー
+static std::vector<uint8_t> firstFrameInTrace(const char *path, BitTrace::Channel channel)
+{
+    ReplayPinInterface replay(3);
+    if (!replay.open(path))
+    {
+        return {};
+    }
+    replay.setReplayChannel(channel);
+    HDLC receiver(replay, 2, 3, 4, 5, 9600);
+    receiver.begin();
+    if (!receiver.receiveFrameWithBitControl(200))
+    {
+        return {};
+    }
+    uint8_t frame[HDLC::MAX_FRAME_SIZE];
+    size_t length = receiver.readFrame(frame, sizeof(frame));
+    return std::vector<uint8_t>(frame, frame + length);
+}
+
+// 一次局が送信したフレームを二次局へ再生し、二次局の応答を記録する
+static std::vector<uint8_t> secondaryResponseTo(const char *commandTrace, HDLC::StationSession *sessionOut,
+                                                bool *accepted, std::vector<uint8_t> *payload,
+                                                const std::vector<uint8_t> *pendingData = nullptr)
+{
+    const char *responseTrace = "secondary_response.hbt";
+    std::vector<uint8_t> response;
+    {
+        ReplayPinInterface replay(3);
+        EXPECT_TRUE(replay.open(commandTrace));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        PinTraceRecorder recorder(replay, 2, 3, 4);
+        recorder.open(responseTrace, BitTrace::FORMAT_BINARY);
+
+        HDLC secondary(recorder, 2, 3, 4, 5, 9600);
+        secondary.setRole(HDLC::ROLE_SECONDARY);
+        secondary.begin();
+        if (sessionOut)
+        {
+            secondary.currentSession() = *sessionOut;
+            secondary.setAddress(sessionOut->address);
+        }
+        if (pendingData)
+        {
+            secondary.queueResponseData(pendingData->data(), pendingData->size());
+        }
+        bool result = secondary.listen(200);
+        if (accepted)
+        {
+            *accepted = result;
+        }
+        if (payload)
+        {
+            uint8_t frame[HDLC::MAX_FRAME_SIZE];
+            size_t length = secondary.readFrame(frame, sizeof(frame));
+            payload->assign(frame, frame + length);
+        }
+        if (sessionOut)
+        {
+            *sessionOut = secondary.currentSession();
+        }
+        recorder.close();
+    }
+    response = firstFrameInTrace(responseTrace, BitTrace::CHANNEL_TX);
+    remove(responseTrace);
+    return response;
+}
+
+TEST(SecondaryStationTest, AnswersSNRMWithPrecomputedUA)
+{
+    const char *path = "primary_snrm.hbt";
+    recordSNRM(path, BitTrace::FORMAT_BINARY);
+
+    HDLC::StationSession session;
+    HDLC::initSession(session, 1);
+    session.sendSequence = 5;
+    std::vector<uint8_t> response = secondaryResponseTo(path, &session, nullptr, nullptr);
+    remove(path);
+
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(1, response[0]);
+    EXPECT_EQ(HDLC::CMD_UA | HDLC::POLL_FINAL_BIT, response[1]);
+    EXPECT_EQ(HDLC::LINK_CONNECTED, session.linkState);
+    EXPECT_EQ(0, session.sendSequence);
+}
+
+TEST(SecondaryStationTest, AcknowledgesIFrameOrRejectsOutOfSequence)
+{
+    const char *path = "primary_iframe.hbt";
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        const uint8_t data[] = {0xDE, 0xAD};
+        primary.sendICommand(data, sizeof(data), 5); // N(S)=0、応答なし
+    }
+
+    HDLC::StationSession session;
+    HDLC::initSession(session, 1);
+    session.linkState = HDLC::LINK_CONNECTED;
+    bool accepted = false;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> response = secondaryResponseTo(path, &session, &accepted, &payload);
+    EXPECT_TRUE(accepted);
+    ASSERT_EQ(4u, payload.size());
+    EXPECT_EQ(0xDE, payload[2]);
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(HDLC::CMD_RR | HDLC::POLL_FINAL_BIT | (1 << 5), response[1]); // N(R)=1
+    EXPECT_EQ(1, session.receiveSequence);
+
+    // 同じN(S)=0を再度受信するとREJ(N(R)=1)
+    response = secondaryResponseTo(path, &session, &accepted, nullptr);
+    EXPECT_FALSE(accepted);
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(HDLC::CMD_REJ | HDLC::POLL_FINAL_BIT | (1 << 5), response[1]);
+    remove(path);
+}
+
+// アドレスフィルタ: 他局宛てフレームはアドレス確定時点で破棄される
+TEST(AddressFilterTest, DropsFramesForOtherStations)
+{
+    const char *path = "address_filter.hbt";
+    recordSNRM(path, BitTrace::FORMAT_BINARY); // アドレス1宛て
+
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.open(path));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.setAddress(3);
+        receiver.setAddressFilter(true);
+        receiver.acceptAddress(2);
+        receiver.acceptAddress(HDLC::BROADCAST_ADDRESS);
+        EXPECT_FALSE(receiver.isAddressAccepted(1));
+        EXPECT_FALSE(receiver.receiveFrameWithBitControl(100));
+        EXPECT_GE(receiver.getReceiveStatistics().filteredFrames, 1u);
+    }
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.open(path));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.setAddress(3);
+        receiver.setAddressFilter(true);
+        receiver.acceptAddress(1); // グループアドレスとして受理
+        EXPECT_TRUE(receiver.receiveFrameWithBitControl(100));
+        EXPECT_EQ(0u, receiver.getReceiveStatistics().filteredFrames);
+    }
+    remove(path);
+}
+
+// ビット列からHBT1トレースを生成（ビット中央で標本化されるよう半ビットずらす）
+static std::vector<uint8_t> lineTrace(const std::vector<uint8_t> &bits, uint32_t bitMicros = 104)
+{
+    std::vector<uint8_t> trace(BitTrace::MAGIC, BitTrace::MAGIC + 4);
+    trace.push_back(BitTrace::VERSION);
+    trace.push_back(BitTrace::CHANNEL_COUNT);
+    trace.push_back(0);
+    trace.push_back(0);
+
+    uint8_t level = 1;
+    uint64_t lastMicros = 0;
+    for (size_t i = 0; i < bits.size(); i++)
+    {
+        if (bits[i] == level)
+        {
+            continue;
+        }
+        uint64_t edgeMicros = i ? i * bitMicros - bitMicros / 2 : 0;
+        uint8_t record[10];
+        size_t length = BitTrace::encodeRecord(edgeMicros - lastMicros, BitTrace::CHANNEL_TX, bits[i], record);
+        trace.insert(trace.end(), record, record + length);
+        lastMicros = edgeMicros;
+        level = bits[i];
+    }
+    return trace;
+}
+
+static void appendBits(std::vector<uint8_t> &bits, uint8_t value, size_t count)
+{
+    bits.insert(bits.end(), count, value);
+}
+
+static void appendByte(std::vector<uint8_t> &bits, uint8_t byte)
+{
+    for (int i = 7; i >= 0; i--)
+    {
+        bits.push_back((byte >> i) & 1);
+    }
+}
+
+// アボート・最大長超過は即座に破棄し、回線アイドルでタイムアウトを待たずに戻る
+TEST(ReceiveStateTest, AbortAndOversizeFailFast)
+{
+    std::vector<uint8_t> aborted;
+    appendBits(aborted, 1, 16);
+    appendByte(aborted, HDLC::FLAG_SEQUENCE);
+    appendByte(aborted, 0x01);
+    appendBits(aborted, 1, 8); // アボート
+    std::vector<uint8_t> trace = lineTrace(aborted);
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        EXPECT_FALSE(receiver.receiveFrameWithBitControl(1000));
+        EXPECT_LT(replay.millis(), 100u);
+        EXPECT_EQ(1u, receiver.getReceiveStatistics().abortedFrames);
+        EXPECT_GE(receiver.getReceiveStatistics().idleDetections, 1u);
+    }
+
+    std::vector<uint8_t> oversize;
+    appendBits(oversize, 1, 16);
+    appendByte(oversize, HDLC::FLAG_SEQUENCE);
+    appendBits(oversize, 0, (HDLC::MAX_FRAME_SIZE + 4) * 8);
+    appendBits(oversize, 1, 1); // 以降はアイドル
+    trace = lineTrace(oversize);
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        EXPECT_FALSE(receiver.receiveFrameWithBitControl(1000));
+        EXPECT_LT(replay.millis(), 200u);
+        EXPECT_EQ(1u, receiver.getReceiveStatistics().oversizeFrames);
+        EXPECT_EQ(0u, receiver.getReceiveStatistics().abortedFrames);
+    }
+}
+
+// 一次局のIフレームを記録するヘルパー
+static void recordIFrame(const char *path, const HDLC::StationSession &session, const std::vector<uint8_t> &data)
+{
+    ReplayPinInterface idleLine(3);
+    PinTraceRecorder recorder(idleLine, 2, 3, 4);
+    ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+    HDLC primary(recorder, 2, 3, 4, 5, 9600);
+    primary.begin();
+    primary.currentSession() = session;
+    primary.sendICommand(data.data(), data.size(), 5); // 応答なし
+}
+
+// 二次局は送信データがあればRRの代わりにIフレームで受信確認を返す
+TEST(SecondaryStationTest, PiggybacksAcknowledgementOnIFrame)
+{
+    const char *path = "primary_piggyback.hbt";
+    HDLC::StationSession primarySession;
+    HDLC::initSession(primarySession, 1);
+    primarySession.linkState = HDLC::LINK_CONNECTED;
+    recordIFrame(path, primarySession, std::vector<uint8_t>{0x11});
+
+    HDLC::StationSession session;
+    HDLC::initSession(session, 1);
+    session.linkState = HDLC::LINK_CONNECTED;
+    std::vector<uint8_t> reply = {0x22, 0x33};
+    bool accepted = false;
+    std::vector<uint8_t> response = secondaryResponseTo(path, &session, &accepted, nullptr, &reply);
+    EXPECT_TRUE(accepted);
+    ASSERT_EQ(4u, response.size());
+    EXPECT_EQ(0x00 | HDLC::POLL_FINAL_BIT | (1 << 5), response[1]); // I: N(S)=0, N(R)=1, F
+    EXPECT_EQ(0x22, response[2]);
+    EXPECT_EQ(0, session.sendSequence);
+    EXPECT_EQ(1, session.outstandingFrames);
+
+    // 一次局の次のIフレーム（N(S)=1, N(R)=1）で二次局のデータが確認される
+    primarySession.sendSequence = 1;
+    primarySession.receiveSequence = 1;
+    recordIFrame(path, primarySession, std::vector<uint8_t>{0x44});
+    response = secondaryResponseTo(path, &session, &accepted, nullptr);
+    remove(path);
+    EXPECT_TRUE(accepted);
+    EXPECT_EQ(1, session.sendSequence);
+    EXPECT_EQ(0, session.outstandingFrames);
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(HDLC::CMD_RR | HDLC::POLL_FINAL_BIT | (2 << 5), response[1]);
+}
+
+// 拡張モード: SNRMEで確立し、2バイトのコントロールフィールドでN(R)を返す
+TEST(SecondaryStationTest, ExtendedModeUsesTwoByteControl)
+{
+    const char *path = "primary_snrme.hbt";
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setExtendedMode(true);
+        primary.sendSNRMAndWaitUA(); // 応答なし
+    }
+    HDLC::StationSession session;
+    HDLC::initSession(session, 1);
+    std::vector<uint8_t> response = secondaryResponseTo(path, &session, nullptr, nullptr);
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(HDLC::CMD_UA | HDLC::POLL_FINAL_BIT, response[1]);
+    EXPECT_TRUE(session.extendedMode);
+
+    // N(S)=100のIフレームにはRR(N(R)=101, F)を2バイトで返す
+    HDLC::StationSession primarySession = session;
+    primarySession.sendSequence = 100;
+    recordIFrame(path, primarySession, std::vector<uint8_t>{0x55});
+    session.receiveSequence = 100;
+    bool accepted = false;
+    std::vector<uint8_t> payload;
+    response = secondaryResponseTo(path, &session, &accepted, &payload);
+    remove(path);
+    EXPECT_TRUE(accepted);
+    ASSERT_EQ(4u, payload.size());
+    EXPECT_EQ(100 << 1, payload[1]);
+    EXPECT_EQ(0x01, payload[2]); // N(R)=0, P
+    EXPECT_EQ(0x55, payload[3]);
+    ASSERT_EQ(3u, response.size());
+    EXPECT_EQ(HDLC::CMD_RR, response[1]);
+    EXPECT_EQ((101 << 1) | 0x01, response[2]);
+    EXPECT_EQ(101, session.receiveSequence);
+}
+
+// ウィンドウ送信: 最後のフレームにだけPビットを立て、無応答なら再送して諦める
+TEST(WindowedSendTest, PollsOnlyLastFrameOfWindow)
+{
+    const char *path = "primary_window.hbt";
+    size_t confirmed = 1;
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setResponseTimeout(5);
+        primary.setWindowSize(3);
+        const uint8_t a[] = {1}, b[] = {2}, c[] = {3};
+        const uint8_t *payloads[] = {a, b, c};
+        const size_t lengths[] = {1, 1, 1};
+        confirmed = primary.sendIFrames(payloads, lengths, 3, 1);
+        EXPECT_EQ(0, primary.currentSession().sendSequence);
+        EXPECT_EQ(0, primary.currentSession().outstandingFrames);
+    }
+    std::vector<uint8_t> first = firstFrameInTrace(path, BitTrace::CHANNEL_TX);
+    remove(path);
+    EXPECT_EQ(0u, confirmed);
+    ASSERT_EQ(3u, first.size());
+    EXPECT_EQ(0, first[1] & HDLC::POLL_FINAL_BIT);
+}
+
+// トレースの1チャネルをビット列に変換（細かく標本化した区間長をビット時間で丸める）
+static void traceToBits(const char *path, BitTrace::Channel channel, PackedBitWriter &writer,
+                        size_t *risingEdges = nullptr)
+{
+    const uint32_t stepMicros = 8;
+    const uint32_t bitMicros = 104;
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.open(path));
+    replay.setReplayChannel(channel);
+
+    uint8_t level = replay.digitalRead(3);
+    uint32_t runMicros = 0;
+    size_t rising = 0;
+    while (!replay.isFinished())
+    {
+        replay.delayMicroseconds(stepMicros);
+        runMicros += stepMicros;
+        uint8_t next = replay.digitalRead(3);
+        if (next != level)
+        {
+            for (uint32_t i = 0; i < (runMicros + bitMicros / 2) / bitMicros; i++)
+            {
+                writer.bit(level);
+            }
+            rising += next ? 1 : 0;
+            level = next;
+            runMicros = 0;
+        }
+    }
+    writer.bit(level); // 最後の区間（終了フラグの0等）
+    writer.idle(16);
+    if (risingEdges)
+    {
+        *risingEdges = rising;
+    }
+}
+
+// バースト送信: ウィンドウ内のフレームはフラグを共有し、DEは1回だけ切り替わる
+TEST(WindowedSendTest, WindowIsSentAsOneBurst)
+{
+    const char *path = "primary_burst.hbt";
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setResponseTimeout(5);
+        const uint8_t a[] = {0x10}, b[] = {0x20, 0x21}, c[] = {0x30};
+        const uint8_t *payloads[] = {a, b, c};
+        const size_t lengths[] = {1, 2, 1};
+        EXPECT_EQ(0u, primary.sendIFrames(payloads, lengths, 3, 0)); // 応答なし、再送なし
+    }
+
+    PackedBitWriter tx;
+    traceToBits(path, BitTrace::CHANNEL_TX, tx);
+    PackedBitWriter de;
+    size_t deAssertions = 0;
+    traceToBits(path, BitTrace::CHANNEL_DE, de, &deAssertions);
+    remove(path);
+
+    HDLCCaptureDecoder decoder(1);
+    auto frames = decoder.decode(tx.bytes().data(), tx.bitCount());
+    ASSERT_EQ(3u, frames.size());
+    for (const auto &frame : frames)
+    {
+        EXPECT_EQ(HDLCCaptureDecoder::FRAME_OK, frame.status);
+    }
+    EXPECT_EQ(0x20, frames[1].data[2]);
+    EXPECT_EQ(4u, decoder.getSummary().flags); // 開始1 + 共有2 + 終了1
+    EXPECT_EQ(1u, deAssertions);
+}
+
+// ドライバの有効化・解除に遅延があるトランシーバのループバック模擬
+class LoopbackPinInterface : public IPinInterface
+{
+public:
+    LoopbackPinInterface(uint32_t enableLatency, uint32_t disableLatency)
+        : m_enableLatency(enableLatency), m_disableLatency(disableLatency) {}
+
+    void pinMode(uint8_t, uint8_t) override {}
+    void digitalWrite(uint8_t pin, uint8_t value) override
+    {
+        if (pin == 4 && value != m_de)
+        {
+            m_deChangedAt = m_now;
+            m_de = value;
+        }
+        if (pin == 2)
+        {
+            m_tx = value;
+        }
+    }
+    uint8_t digitalRead(uint8_t) override
+    {
+        m_now++;
+        bool driving = m_de ? (m_now - m_deChangedAt >= m_enableLatency)
+                            : (m_now - m_deChangedAt < m_disableLatency);
+        return driving ? m_tx : HIGH; // 駆動していなければバイアスでアイドル
+    }
+    void attachInterrupt(uint8_t, void (*)(), uint8_t) override {}
+    void detachInterrupt(uint8_t) override {}
+    void delayMicroseconds(uint32_t us) override { m_now += us; }
+    uint32_t millis() override { return m_now / 1000; }
+    uint32_t micros() override { return m_now; }
+
+private:
+    uint32_t m_enableLatency;
+    uint32_t m_disableLatency;
+    uint32_t m_now = 1000;
+    uint32_t m_deChangedAt = 0;
+    uint8_t m_de = LOW;
+    uint8_t m_tx = HIGH;
+};
+
+TEST(DriverTimingTest, CalibrationMeasuresLoopbackLatency)
+{
+    LoopbackPinInterface pins(30, 12);
+    HDLC hdlc(pins, 2, 3, 4, 5, 9600);
+    hdlc.begin();
+    EXPECT_EQ(52u + 100u, hdlc.getSettleMicros()); // 既定値
+    ASSERT_TRUE(hdlc.calibrateDriverTiming());
+    EXPECT_GE(hdlc.getSettleMicros(), 30u);
+    EXPECT_LT(hdlc.getSettleMicros(), 30u + 20u);
+    EXPECT_GE(hdlc.getTurnaroundMicros(), 12u);
+    EXPECT_LT(hdlc.getTurnaroundMicros(), 12u + 20u);
+
+    // 受信出力が変化しない（ループバック不可）場合は設定を変えない
+    MockPinInterface mock;
+    HDLC silent(mock, 2, 3, 4, 5, 9600);
+    silent.begin();
+    silent.setDriverTiming(7, 8);
+    EXPECT_FALSE(silent.calibrateDriverTiming());
+    EXPECT_EQ(7u, silent.getSettleMicros());
+}
+
+// 応答遅延の推定: 未測定時は設定値、測定後はSRTT/RTTVARから算出
+TEST_F(HDLCResponseTest, AdaptiveTimeoutFollowsMeasuredDelay)
+{
+    hdlc->begin();
+    hdlc->setResponseTimeout(50);
+    EXPECT_EQ(50u, hdlc->responseTimeoutMs());
+
+    HDLC::StationSession &session = hdlc->currentSession();
+    HDLC::updateRttEstimate(session, 2000);
+    EXPECT_EQ(2000u, session.srttMicros);
+    EXPECT_EQ(1000u, session.rttVarMicros);
+    for (int i = 0; i < 50; i++)
+    {
+        HDLC::updateRttEstimate(session, 2000);
+    }
+    EXPECT_EQ(2000u, session.srttMicros);
+    EXPECT_LT(session.rttVarMicros, 100u);
+    uint32_t fast = hdlc->responseTimeoutMs();
+    EXPECT_LT(fast, 10u);
+
+    // 遅い応答が続けばタイムアウトも延びる
+    for (int i = 0; i < 50; i++)
+    {
+        HDLC::updateRttEstimate(session, 80000);
+    }
+    EXPECT_GT(hdlc->responseTimeoutMs(), 80u);
+
+    // 固定タイムアウトに切り替え
+    hdlc->setAdaptiveTimeout(false);
+    EXPECT_EQ(50u, hdlc->responseTimeoutMs());
+}
+
+// 応答が無ければタイムアウトを倍にしていく
+TEST(AdaptiveTimeoutTest, BacksOffAfterNoResponse)
+{
+    ReplayPinInterface idleLine(3);
+    HDLC primary(idleLine, 2, 3, 4, 5, 9600);
+    primary.begin();
+    primary.setResponseTimeout(4);
+    const uint8_t data[] = {0x01};
+    EXPECT_FALSE(primary.sendICommand(data, sizeof(data)));
+    EXPECT_EQ(8u, primary.responseTimeoutMs());
+    EXPECT_FALSE(primary.sendICommand(data, sizeof(data)));
+    EXPECT_EQ(16u, primary.responseTimeoutMs());
+
+    // 固定タイムアウトでは倍にせず、上限も掛けない
+    primary.setAdaptiveTimeout(false);
+    EXPECT_EQ(4u, primary.responseTimeoutMs());
+    EXPECT_FALSE(primary.sendICommand(data, sizeof(data)));
+    EXPECT_EQ(4u, primary.responseTimeoutMs());
+    primary.setResponseTimeout(HDLC::MAX_RESPONSE_TIMEOUT_MS * 2);
+    EXPECT_EQ(HDLC::MAX_RESPONSE_TIMEOUT_MS * 2, primary.responseTimeoutMs());
+}
+
+// 回線上のフレーム（フラグ+スタッフィング済みデータ+フラグ）をビット列に追加
+static void appendFrame(std::vector<uint8_t> &bits, const std::vector<uint8_t> &body)
+{
+    PackedBitWriter writer;
+    writer.frame(body);
+    for (uint64_t i = 0; i < writer.bitCount(); i++)
+    {
+        bits.push_back((writer.bytes()[i / 8] >> (7 - i % 8)) & 1);
+    }
+}
+
+TEST(AutoBaudTest, DetectsRateFromFlagsAndReceives)
+{
+    // 19200bps（1ビット52us）で2フレームを送る回線
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 40);
+    appendFrame(bits, {0x01, 0x13, 0xA5, 0x0F});
+    appendBits(bits, 1, 40);
+    appendFrame(bits, {0x01, 0x13, 0x5A});
+    appendBits(bits, 1, 40);
+    std::vector<uint8_t> trace = lineTrace(bits, 52);
+
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        EXPECT_EQ(19200u, receiver.detectBaudRate(100));
+        EXPECT_EQ(9600u, receiver.getBaudRate()); // 検出だけでは変更しない
+    }
+    {
+        // 自動モード: 1フレーム目で速度を検出し、2フレーム目を受信する
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.setAutoBaud(true);
+        ASSERT_TRUE(receiver.receiveFrameWithBitControl(100));
+        EXPECT_EQ(19200u, receiver.getBaudRate());
+        uint8_t frame[HDLC::MAX_FRAME_SIZE];
+        ASSERT_EQ(3u, receiver.readFrame(frame, sizeof(frame)));
+        EXPECT_EQ(0x5A, frame[2]);
+    }
+
+    {
+        // 9600bpsのフラグフィルの途中（10ms後）から検出を始める
+        std::vector<uint8_t> fill;
+        appendBits(fill, 1, 40);
+        for (int i = 0; i < 200; i++)
+        {
+            appendByte(fill, HDLC::FLAG_SEQUENCE);
+        }
+        std::vector<uint8_t> fillTrace = lineTrace(fill);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(fillTrace.data(), fillTrace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 19200);
+        receiver.begin();
+        replay.delayMicroseconds(10000);
+        EXPECT_EQ(9600u, receiver.detectBaudRate(1000));
+    }
+
+    // フラグの無い回線では検出しない
+    MockPinInterface mock;
+    HDLC silent(mock, 2, 3, 4, 5, 9600);
+    silent.begin();
+    EXPECT_EQ(0u, silent.detectBaudRate(5));
+}
+
+// 9600bpsの1ビットを19200bpsの2ビットとして追加（1本のトレースで両方の速度を表す）
+static void appendSlowBits(std::vector<uint8_t> &bits, const std::vector<uint8_t> &slow)
+{
+    for (uint8_t bit : slow)
+    {
+        bits.push_back(bit);
+        bits.push_back(bit);
+    }
+}
+
+static std::vector<uint8_t> xidBaudInfo(uint32_t baudRate)
+{
+    return {HDLC::XID_FORMAT_ID, HDLC::XID_GROUP_ID, 0x00, 0x06, HDLC::XID_PARAM_BAUD_RATE, 4,
+            (uint8_t)(baudRate >> 24), (uint8_t)(baudRate >> 16), (uint8_t)(baudRate >> 8), (uint8_t)baudRate};
+}
+
+// 二次局: XIDに受理した速度を返して切り替え、新しい速度のTESTで確定する
+TEST(BaudNegotiationTest, SecondarySwitchesAfterXidAndConfirmsWithTest)
+{
+    // 応答が無ければ一次局は速度を変えない
+    {
+        ReplayPinInterface idleLine(3);
+        HDLC primary(idleLine, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setResponseTimeout(5);
+        EXPECT_FALSE(primary.negotiateBaudRate(19200));
+        EXPECT_EQ(9600u, primary.getBaudRate());
+    }
+
+    // 9600bpsのXID(P, 38400提案)の後、19200bpsのTEST(P)が届く回線（19200bpsのビット単位）
+    std::vector<uint8_t> xidBody = {0x01, HDLC::CMD_XID | HDLC::POLL_FINAL_BIT};
+    std::vector<uint8_t> info = xidBaudInfo(38400);
+    xidBody.insert(xidBody.end(), info.begin(), info.end());
+    std::vector<uint8_t> slow;
+    appendBits(slow, 1, 16);
+    appendFrame(slow, xidBody);
+    appendBits(slow, 1, 8);
+    std::vector<uint8_t> bits;
+    appendSlowBits(bits, slow);
+    std::vector<uint8_t> withoutTest = bits;
+    appendBits(withoutTest, 1, 16);
+    appendBits(bits, 1, 600); // 二次局の応答（9600bpsで約15ms）の後
+    appendFrame(bits, {0x01, HDLC::CMD_TEST | HDLC::POLL_FINAL_BIT, 0x5A, 0xA5});
+    appendBits(bits, 1, 16);
+
+    const char *responseTrace = "xid_response.hbt";
+    {
+        std::vector<uint8_t> trace = lineTrace(bits, 52);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        PinTraceRecorder recorder(replay, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(responseTrace, BitTrace::FORMAT_BINARY));
+        HDLC secondary(recorder, 2, 3, 4, 5, 9600);
+        secondary.setRole(HDLC::ROLE_SECONDARY);
+        secondary.begin();
+        secondary.setMaxBaudRate(19200);
+
+        EXPECT_FALSE(secondary.listen(100));
+        EXPECT_EQ(19200u, secondary.getBaudRate());
+        EXPECT_TRUE(secondary.isBaudChangePending());
+        EXPECT_FALSE(secondary.listen(100)); // TEST(P)を受信して折り返す
+        EXPECT_FALSE(secondary.isBaudChangePending());
+        EXPECT_FALSE(secondary.listen(HDLC::BAUD_FALLBACK_MS + 50));
+        EXPECT_EQ(19200u, secondary.getBaudRate());
+        recorder.close();
+    }
+    // 応答は切り替え前の速度で送られ、受理した速度（上限の19200）を示す
+    std::vector<uint8_t> response = firstFrameInTrace(responseTrace, BitTrace::CHANNEL_TX);
+    remove(responseTrace);
+    std::vector<uint8_t> expected = {0x01, HDLC::CMD_XID | HDLC::POLL_FINAL_BIT};
+    info = xidBaudInfo(19200);
+    expected.insert(expected.end(), info.begin(), info.end());
+    EXPECT_EQ(expected, response);
+
+    // TESTが届かなければ期限後に元の速度へ戻る
+    {
+        std::vector<uint8_t> trace = lineTrace(withoutTest, 52);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC secondary(replay, 2, 3, 4, 5, 9600);
+        secondary.setRole(HDLC::ROLE_SECONDARY);
+        secondary.begin();
+        EXPECT_FALSE(secondary.listen(100));
+        EXPECT_EQ(38400u, secondary.getBaudRate());
+        EXPECT_FALSE(secondary.listen(1000));
+        EXPECT_LT(replay.millis(), 1000u); // 期限で受信を打ち切る
+        EXPECT_EQ(9600u, secondary.getBaudRate());
+        EXPECT_FALSE(secondary.isBaudChangePending());
+    }
+}
+
+// CRC異常率による速度の選択
+TEST(BaudNegotiationTest, RecommendsRateFromCrcErrorRate)
+{
+    EXPECT_EQ(19200u, HDLC::recommendBaudRate(9600, 1000, 0, 115200));
+    EXPECT_EQ(9600u, HDLC::recommendBaudRate(9600, 1000, 0, 9600));  // 上限
+    EXPECT_EQ(9600u, HDLC::recommendBaudRate(9600, 980, 20, 115200)); // 2%: 維持
+    EXPECT_EQ(4800u, HDLC::recommendBaudRate(9600, 900, 100, 115200));
+    EXPECT_EQ(1200u, HDLC::recommendBaudRate(1200, 0, 50, 115200)); // 最低速度
+    EXPECT_EQ(9600u, HDLC::recommendBaudRate(9600, 0, 0, 115200));
+}
+
+// 非同期要求の完了記録
+struct CompletionLog
+{
+    std::vector<HDLC::RequestHandle> handles;
+    std::vector<HDLC::RequestStatus> statuses;
+
+    static void record(HDLC::RequestHandle handle, HDLC::RequestStatus status, void *context)
+    {
+        CompletionLog *log = static_cast<CompletionLog *>(context);
+        log->handles.push_back(handle);
+        log->statuses.push_back(status);
+    }
+};
+
+// service()を他の処理（50us）と交互に呼び、1ms以上戻らなかった回数を数える
+static size_t runService(HDLC &hdlc, ReplayPinInterface &pins, size_t *calls)
+{
+    size_t blockingCalls = 0;
+    *calls = 0;
+    bool busy = true;
+    while (busy && *calls < 100000)
+    {
+        uint32_t before = pins.micros();
+        busy = hdlc.service();
+        if (pins.micros() - before >= 1000)
+        {
+            blockingCalls++;
+        }
+        (*calls)++;
+        pins.delayMicroseconds(50);
+    }
+    return blockingCalls;
+}
+
+TEST(AsyncRequestTest, ServiceCompletesQueuedRequestsWithoutBlocking)
+{
+    // 応答 RR(F, N(R)=1) と REJ(F, N(R)=1) が順に届く回線
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 150);
+    appendFrame(bits, {0x01, HDLC::CMD_RR | HDLC::POLL_FINAL_BIT | (1 << 5)});
+    appendBits(bits, 1, 250);
+    appendFrame(bits, {0x01, HDLC::CMD_REJ | HDLC::POLL_FINAL_BIT | (1 << 5)});
+    appendBits(bits, 1, 16);
+    std::vector<uint8_t> trace = lineTrace(bits);
+
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+    replay.setReplayChannel(BitTrace::CHANNEL_TX);
+    HDLC primary(replay, 2, 3, 4, 5, 9600);
+    primary.begin();
+    primary.setResponseTimeout(100);
+    CompletionLog log;
+    primary.setCompletionCallback(CompletionLog::record, &log);
+
+    const uint8_t first[] = {0x11}, second[] = {0x22};
+    HDLC::RequestHandle a = primary.submitI(first, sizeof(first));
+    HDLC::RequestHandle b = primary.submitI(second, sizeof(second));
+    ASSERT_NE(HDLC::INVALID_HANDLE, a);
+    ASSERT_NE(a, b);
+    EXPECT_TRUE(primary.isPending(b));
+    EXPECT_EQ(2u, primary.pendingRequests());
+
+    size_t calls = 0;
+    size_t blocking = runService(primary, replay, &calls);
+    ASSERT_EQ(2u, log.handles.size());
+    EXPECT_EQ(a, log.handles[0]);
+    EXPECT_EQ(HDLC::REQUEST_COMPLETED, log.statuses[0]);
+    EXPECT_EQ(b, log.handles[1]);
+    EXPECT_EQ(HDLC::REQUEST_REJECTED, log.statuses[1]);
+    EXPECT_FALSE(primary.isPending(a));
+    EXPECT_EQ(1, primary.currentSession().sendSequence);
+
+    // 長く戻らないのは送信2回と応答の受信2回だけで、応答待ちの間は何度も戻る
+    EXPECT_LE(blocking, 4u);
+    EXPECT_GT(calls, 100u);
+
+    // 応答が無ければタイムアウトで完了する
+    ReplayPinInterface idleLine(3);
+    HDLC silent(idleLine, 2, 3, 4, 5, 9600);
+    silent.begin();
+    silent.setResponseTimeout(20);
+    CompletionLog timeouts;
+    silent.setCompletionCallback(CompletionLog::record, &timeouts);
+    HDLC::RequestHandle c = silent.connect();
+    runService(silent, idleLine, &calls);
+    ASSERT_EQ(1u, timeouts.statuses.size());
+    EXPECT_EQ(c, timeouts.handles[0]);
+    EXPECT_EQ(HDLC::REQUEST_TIMEOUT, timeouts.statuses[0]);
+    EXPECT_EQ(HDLC::LINK_DISCONNECTED, silent.currentSession().linkState);
+}
+
+// 受信コールバックの記録（コールバックには文脈が無いため静的に持つ）
+static std::vector<std::vector<uint8_t>> receivedFrames;
+static std::vector<bool> receivedValid;
+
+static void recordReceivedFrame(const uint8_t *data, size_t length, bool isValid)
+{
+    receivedFrames.push_back(std::vector<uint8_t>(data, data + length));
+    receivedValid.push_back(isValid);
+}
+
+// 応答待ちの間に届いた他局のフレームで要求を完了しないこと
+TEST(AsyncRequestTest, ServiceIgnoresForeignFramesWhileWaiting)
+{
+    // 局5のUA、局1のUA、局5のRR(N(R)=3)、局1のRR(N(R)=1) の順に届く回線
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 150);
+    appendFrame(bits, {0x05, HDLC::CMD_UA | HDLC::POLL_FINAL_BIT});
+    appendBits(bits, 1, 30);
+    appendFrame(bits, {0x01, HDLC::CMD_UA | HDLC::POLL_FINAL_BIT});
+    appendBits(bits, 1, 250);
+    appendFrame(bits, {0x05, HDLC::CMD_RR | HDLC::POLL_FINAL_BIT | (3 << 5)});
+    appendBits(bits, 1, 30);
+    appendFrame(bits, {0x01, HDLC::CMD_RR | HDLC::POLL_FINAL_BIT | (1 << 5)});
+    appendBits(bits, 1, 16);
+    std::vector<uint8_t> trace = lineTrace(bits);
+
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+    replay.setReplayChannel(BitTrace::CHANNEL_TX);
+    HDLC primary(replay, 2, 3, 4, 5, 9600);
+    primary.begin();
+    primary.setResponseTimeout(100);
+    receivedFrames.clear();
+    receivedValid.clear();
+    primary.setReceiveCallback(recordReceivedFrame);
+    CompletionLog log;
+    primary.setCompletionCallback(CompletionLog::record, &log);
+
+    const uint8_t payload[] = {0x11};
+    HDLC::RequestHandle connect = primary.connect();
+    HDLC::RequestHandle data = primary.submitI(payload, sizeof(payload));
+    size_t calls = 0;
+    runService(primary, replay, &calls);
+
+    ASSERT_EQ(2u, log.handles.size());
+    EXPECT_EQ(connect, log.handles[0]);
+    EXPECT_EQ(HDLC::REQUEST_COMPLETED, log.statuses[0]);
+    EXPECT_EQ(data, log.handles[1]);
+    EXPECT_EQ(HDLC::REQUEST_COMPLETED, log.statuses[1]);
+    EXPECT_EQ(HDLC::LINK_CONNECTED, primary.currentSession().linkState);
+    EXPECT_EQ(1, primary.currentSession().sendSequence); // 局5のN(R)=3は反映しない
+    EXPECT_EQ(0, primary.currentSession().outstandingFrames);
+
+    // 他局のフレームも受信コールバックには届く
+    ASSERT_EQ(4u, receivedFrames.size());
+    EXPECT_EQ(0x05, receivedFrames[0][0]);
+    EXPECT_EQ(0x05, receivedFrames[2][0]);
+}
+
+TEST(ReceiveCallbackTest, DeliversUnsolicitedFramesFromService)
+{
+    // 二次局宛てのSNRMと、CRC異常のフレームが届く回線
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 40);
+    appendFrame(bits, {0x01, HDLC::CMD_SNRM | HDLC::POLL_FINAL_BIT});
+    appendBits(bits, 1, 300);
+    PackedBitWriter corrupt;
+    corrupt.frame({0x01, 0x13, 0x77}, true);
+    for (uint64_t i = 0; i < corrupt.bitCount(); i++)
+    {
+        bits.push_back((corrupt.bytes()[i / 8] >> (7 - i % 8)) & 1);
+    }
+    appendBits(bits, 1, 40);
+    std::vector<uint8_t> trace = lineTrace(bits);
+
+    receivedFrames.clear();
+    receivedValid.clear();
+    const char *responseTrace = "callback_response.hbt";
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        PinTraceRecorder recorder(replay, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(responseTrace, BitTrace::FORMAT_BINARY));
+        HDLC secondary(recorder, 2, 3, 4, 5, 9600);
+        secondary.setRole(HDLC::ROLE_SECONDARY);
+        secondary.begin();
+        secondary.setReceiveCallback(recordReceivedFrame);
+
+        size_t calls = 0;
+        while (!replay.isFinished() && calls < 100000)
+        {
+            EXPECT_FALSE(secondary.service()); // 要求は無い
+            // 応答の送信後も含め、service()からは受信状態（DE/REとも解除）で戻る
+            EXPECT_EQ(LOW, replay.digitalRead(4));
+            EXPECT_EQ(LOW, replay.digitalRead(5));
+            calls++;
+            replay.delayMicroseconds(50);
+        }
+        EXPECT_EQ(HDLC::LINK_CONNECTED, secondary.currentSession().linkState);
+        EXPECT_EQ(0u, secondary.getReceiveStatistics().overrunFrames);
+        recorder.close();
+    }
+
+    // service()で受信したSNRMにUAで応答し、両方のフレームを通知する
+    std::vector<uint8_t> response = firstFrameInTrace(responseTrace, BitTrace::CHANNEL_TX);
+    remove(responseTrace);
+    ASSERT_EQ(2u, response.size());
+    EXPECT_EQ(HDLC::CMD_UA | HDLC::POLL_FINAL_BIT, response[1]);
+
+    ASSERT_EQ(2u, receivedFrames.size());
+    EXPECT_EQ((std::vector<uint8_t>{0x01, HDLC::CMD_SNRM | HDLC::POLL_FINAL_BIT}), receivedFrames[0]);
+    EXPECT_TRUE(receivedValid[0]);
+    EXPECT_EQ((std::vector<uint8_t>{0x01, 0x13, 0x77}), receivedFrames[1]);
+    EXPECT_FALSE(receivedValid[1]);
+}
+
+// ホストパケットをCOBS符号化し、1バイトずつ復号器へ渡して元に戻ること
+TEST(HostProtocolTest, RoundTripsPacketsThroughCobs)
+{
+    uint8_t payload[HOST_MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = (i % 7 == 0) ? 0x00 : (uint8_t)i; // 0x00を含み、254バイト超の連続も作る
+    }
+
+    uint8_t encoded[HostProtocol::MAX_ENCODED_SIZE];
+    HostProtocol decoder;
+    const size_t lengths[] = {0, 1, 5, 59, HOST_MAX_PAYLOAD};
+    for (size_t length : lengths)
+    {
+        size_t encodedLength = HostProtocol::encode(HostProtocol::HOST_CMD_SEND_I, 0x42, payload, length,
+                                                    encoded, sizeof(encoded));
+        ASSERT_GT(encodedLength, length + 5) << "length=" << length;
+        ASSERT_EQ(HostProtocol::DELIMITER, encoded[encodedLength - 1]);
+        for (size_t i = 0; i + 1 < encodedLength; i++)
+        {
+            ASSERT_NE(0x00, encoded[i]) << "区切り以外に0x00が現れてはならない";
+        }
+
+        for (size_t i = 0; i + 1 < encodedLength; i++)
+        {
+            EXPECT_FALSE(decoder.feed(encoded[i]));
+        }
+        ASSERT_TRUE(decoder.feed(encoded[encodedLength - 1])) << "length=" << length;
+        EXPECT_EQ(HostProtocol::HOST_CMD_SEND_I, decoder.packetType());
+        EXPECT_EQ(0x42, decoder.packetSequence());
+        ASSERT_EQ(length, decoder.payloadLength());
+        EXPECT_EQ(0, memcmp(payload, decoder.payload(), length));
+    }
+
+    // 254バイトの非0連続（コード0xFFのブロック）を含むパケット
+    uint8_t ones[HOST_MAX_PAYLOAD];
+    memset(ones, 0x11, sizeof(ones));
+    size_t encodedLength = HostProtocol::encode(HostProtocol::HOST_EVT_FRAME, 1, ones, sizeof(ones),
+                                                encoded, sizeof(encoded));
+    ASSERT_GT(encodedLength, 0u);
+    bool received = false;
+    for (size_t i = 0; i < encodedLength; i++)
+    {
+        received = decoder.feed(encoded[i]);
+    }
+    ASSERT_TRUE(received);
+    EXPECT_EQ(sizeof(ones), decoder.payloadLength());
+    EXPECT_EQ(0, memcmp(ones, decoder.payload(), sizeof(ones)));
+
+    // 出力先が足りない場合は0
+    EXPECT_EQ(0u, HostProtocol::encode(HostProtocol::HOST_CMD_STATUS, 0, nullptr, 0, encoded, 5));
+    EXPECT_EQ(0u, decoder.crcErrors());
+    EXPECT_EQ(0u, decoder.framingErrors());
+}
+
+// 破損したパケットを捨て、次の区切りから同期し直すこと
+TEST(HostProtocolTest, DropsCorruptedPacketsAndResynchronizes)
+{
+    const uint8_t payload[] = {0x01, 0x00, 0x7E, 0x7D};
+    uint8_t encoded[HostProtocol::MAX_ENCODED_SIZE];
+    size_t encodedLength = HostProtocol::encode(HostProtocol::HOST_CMD_SEND_I, 7, payload, sizeof(payload),
+                                                encoded, sizeof(encoded));
+    ASSERT_GT(encodedLength, 0u);
+
+    HostProtocol decoder;
+
+    // 途中から読み始めた残り（先頭バイト欠落）
+    for (size_t i = 1; i < encodedLength; i++)
+    {
+        EXPECT_FALSE(decoder.feed(encoded[i]));
+    }
+
+    // ビット化け（CRC異常）
+    for (size_t i = 0; i < encodedLength; i++)
+    {
+        uint8_t byte = encoded[i];
+        if (i == encodedLength - 3)
+        {
+            byte ^= 0x04;
+        }
+        EXPECT_FALSE(decoder.feed(byte));
+    }
+    EXPECT_EQ(1u, decoder.crcErrors());
+    EXPECT_EQ(1u, decoder.framingErrors());
+
+    // 連続した区切りは数えない
+    EXPECT_FALSE(decoder.feed(HostProtocol::DELIMITER));
+    EXPECT_EQ(1u, decoder.framingErrors());
+
+    // 正しいパケットは受信できる
+    bool received = false;
+    for (size_t i = 0; i < encodedLength; i++)
+    {
+        received = decoder.feed(encoded[i]);
+    }
+    ASSERT_TRUE(received);
+    EXPECT_EQ(7, decoder.packetSequence());
+    ASSERT_EQ(sizeof(payload), decoder.payloadLength());
+    EXPECT_EQ(0, memcmp(payload, decoder.payload(), sizeof(payload)));
+}
+
+// 保存したリンク設定をbegin()で入力待ち無しに復元すること
+TEST(LinkConfigTest, BeginRestoresPersistedConfigWithoutPrompt)
+{
+    MockConfigStorage storage;
+
+    // 未保存の場合は既定のアドレス
+    {
+        MockPinInterface pins;
+        HDLC hdlc(pins, 2, 3, 4, 5, 9600);
+        hdlc.setConfigStorage(&storage);
+        ASSERT_TRUE(hdlc.begin());
+        EXPECT_EQ(HDLC::DEFAULT_ADDRESS, hdlc.currentSession().address);
+        EXPECT_EQ(HDLC::ROLE_PRIMARY, hdlc.getRole());
+        EXPECT_EQ(9600u, hdlc.getBaudRate());
+
+        hdlc.setAddress(0x35);
+        hdlc.setRole(HDLC::ROLE_SECONDARY);
+        hdlc.setBaudRate(19200);
+        hdlc.setResponseTimeout(120);
+        hdlc.setAdaptiveTimeout(false);
+        hdlc.setWindowSize(3);
+        hdlc.setLineCoding(HDLC::LINE_NRZI);
+        ASSERT_TRUE(hdlc.saveLinkConfig());
+        EXPECT_EQ(1u, storage.writeCount);
+
+        // 変更が無ければ書き込まない
+        ASSERT_TRUE(hdlc.saveLinkConfig());
+        EXPECT_EQ(1u, storage.writeCount);
+    }
+
+    // 再起動後（別インスタンス）に復元される
+    {
+        MockPinInterface pins;
+        HDLC hdlc(pins, 2, 3, 4, 5, 9600);
+        hdlc.setConfigStorage(&storage);
+        ASSERT_TRUE(hdlc.begin());
+        HDLC::LinkConfig config = hdlc.getLinkConfig();
+        EXPECT_EQ(0x35, config.address);
+        EXPECT_EQ(HDLC::ROLE_SECONDARY, config.role);
+        EXPECT_EQ(19200u, config.baudRate);
+        EXPECT_EQ(120u, config.responseTimeoutMs);
+        EXPECT_FALSE(config.adaptiveTimeout);
+        EXPECT_EQ(3, config.windowSize);
+        EXPECT_EQ(HDLC::LINE_NRZI, config.lineCoding);
+        EXPECT_EQ(19200u, hdlc.getBaudRate());
+    }
+
+    // 壊れた設定は使わない
+    storage.data[5] ^= 0x01;
+    {
+        MockPinInterface pins;
+        HDLC hdlc(pins, 2, 3, 4, 5, 9600);
+        hdlc.setConfigStorage(&storage);
+        ASSERT_TRUE(hdlc.begin());
+        EXPECT_EQ(HDLC::DEFAULT_ADDRESS, hdlc.currentSession().address);
+        EXPECT_EQ(HDLC::ROLE_PRIMARY, hdlc.getRole());
+        EXPECT_EQ(9600u, hdlc.getBaudRate());
+    }
+
+    // 保存先が無い・書き込めない場合は失敗
+    MockPinInterface pins;
+    HDLC hdlc(pins, 2, 3, 4, 5, 9600);
+    EXPECT_FALSE(hdlc.saveLinkConfig());
+    storage.failWrites = true;
+    hdlc.setConfigStorage(&storage);
+    EXPECT_FALSE(hdlc.saveLinkConfig());
+}
+
+// 1フレームに入らないメッセージを断片ヘッダ付きのIフレームに分けて送り、受信側で元に戻すこと
+TEST(SegmentationTest, SplitsMessageAcrossIFramesAndReassembles)
+{
+    std::vector<uint8_t> message(130);
+    for (size_t i = 0; i < message.size(); i++)
+    {
+        message[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    const char *path = "primary_segments.hbt";
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setResponseTimeout(5);
+        primary.currentSession().linkState = HDLC::LINK_CONNECTED;
+        HDLCSegmenter segmenter(primary);
+        EXPECT_FALSE(segmenter.sendMessage(message.data(), message.size())); // 応答なし
+    }
+
+    PackedBitWriter tx;
+    traceToBits(path, BitTrace::CHANNEL_TX, tx);
+    remove(path);
+    HDLCCaptureDecoder decoder(1);
+    auto frames = decoder.decode(tx.bytes().data(), tx.bitCount());
+    ASSERT_GE(frames.size(), 3u);
+
+    // 57 + 57 + 16バイト、ヘッダは FIRST|MORE|0, MORE|1, 2
+    const uint8_t expectedHeaders[] = {0xC0, 0x41, 0x02};
+    const size_t expectedLengths[] = {57, 57, 16};
+    for (size_t i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(HDLCCaptureDecoder::FRAME_OK, frames[i].status);
+        ASSERT_EQ(3 + expectedLengths[i], frames[i].data.size());
+        EXPECT_EQ(expectedHeaders[i], frames[i].data[2]);
+    }
+
+    // 受信側: バッファへ再組み立て
+    MockPinInterface pins;
+    HDLC secondary(pins, 2, 3, 4, 5, 9600);
+    secondary.begin();
+    HDLCSegmenter receiver(secondary);
+    uint8_t buffer[256];
+    static size_t completedLength;
+    completedLength = 0;
+    receiver.setMessageBuffer(buffer, sizeof(buffer),
+                              [](const uint8_t *, size_t length, void *) { completedLength = length; });
+    EXPECT_FALSE(receiver.processFrame(frames[0].data.data(), frames[0].data.size()));
+    EXPECT_FALSE(receiver.processFrame(frames[1].data.data(), frames[1].data.size()));
+    EXPECT_TRUE(receiver.processFrame(frames[2].data.data(), frames[2].data.size()));
+    ASSERT_EQ(message.size(), completedLength);
+    EXPECT_EQ(0, memcmp(message.data(), buffer, message.size()));
+
+    // 断片の欠落は破棄
+    EXPECT_FALSE(receiver.processFrame(frames[0].data.data(), frames[0].data.size()));
+    EXPECT_FALSE(receiver.processFrame(frames[2].data.data(), frames[2].data.size()));
+    EXPECT_EQ(1u, receiver.droppedMessages());
+
+    // バッファに入らないメッセージは破棄
+    receiver.setMessageBuffer(buffer, 100, nullptr);
+    EXPECT_FALSE(receiver.processFrame(frames[0].data.data(), frames[0].data.size()));
+    EXPECT_FALSE(receiver.processFrame(frames[1].data.data(), frames[1].data.size()));
+    EXPECT_EQ(2u, receiver.droppedMessages());
+
+    // 逐次通知
+    static std::vector<uint8_t> streamed;
+    static bool streamEnded;
+    streamed.clear();
+    streamEnded = false;
+    receiver.setMessageSink([](const uint8_t *data, size_t length, size_t offset, bool last, void *) {
+        EXPECT_EQ(streamed.size(), offset);
+        streamed.insert(streamed.end(), data, data + length);
+        streamEnded = last;
+    });
+    for (size_t i = 0; i < 3; i++)
+    {
+        receiver.processFrame(frames[i].data.data(), frames[i].data.size());
+    }
+    EXPECT_TRUE(streamEnded);
+    EXPECT_EQ(message, streamed);
+}
+
+// 繰り返しはRLE、増加するカウンタは差分RLEで縮め、縮まなければ無圧縮にすること
+TEST(PayloadCodecTest, PicksSmallestCodecAndRoundTrips)
+{
+    std::vector<uint8_t> registers = {0x12, 0x34, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xAB, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> counter;
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        counter.push_back((uint8_t)(0xF0 + i * 3));
+    }
+    std::vector<uint8_t> noise = {0x3A, 0x91, 0x07, 0xC4, 0x5E, 0x22, 0xF8, 0x6B};
+
+    struct Case
+    {
+        const std::vector<uint8_t> *data;
+        uint8_t codec;
+    } cases[] = {
+        {&registers, PayloadCodec::CODEC_RLE},
+        {&counter, PayloadCodec::CODEC_DELTA_RLE},
+        {&noise, PayloadCodec::CODEC_NONE},
+    };
+    for (const Case &c : cases)
+    {
+        uint8_t compressed[128];
+        size_t length = PayloadCodec::compress(c.data->data(), c.data->size(), compressed, sizeof(compressed));
+        ASSERT_GT(length, 0u);
+        EXPECT_EQ(c.codec, compressed[0]);
+        if (c.codec == PayloadCodec::CODEC_NONE)
+        {
+            EXPECT_EQ(c.data->size() + 1, length);
+        }
+        else
+        {
+            EXPECT_LT(length, c.data->size() / 2);
+        }
+
+        uint8_t restored[128];
+        size_t restoredLength = PayloadCodec::decompress(compressed, length, restored, sizeof(restored));
+        ASSERT_EQ(c.data->size(), restoredLength);
+        EXPECT_EQ(0, memcmp(c.data->data(), restored, restoredLength));
+
+        // 出力先不足・途中で切れた符号は0
+        EXPECT_EQ(0u, PayloadCodec::decompress(compressed, length, restored, c.data->size() - 1));
+        if (c.codec != PayloadCodec::CODEC_NONE)
+        {
+            EXPECT_EQ(0u, PayloadCodec::decompress(compressed, length - 1, restored, sizeof(restored)));
+        }
+
+        // 圧縮の出力先不足は0で、出力先サイズより後ろには書き込まない
+        uint8_t guarded[128];
+        memset(guarded, 0xCC, sizeof(guarded));
+        EXPECT_EQ(0u, PayloadCodec::compress(c.data->data(), c.data->size(), guarded, length - 1));
+        for (size_t i = length - 1; i < sizeof(guarded); i++)
+        {
+            ASSERT_EQ(0xCC, guarded[i]) << i;
+        }
+    }
+
+    const uint8_t unknown[] = {0x7F, 0x00};
+    uint8_t restored[8];
+    EXPECT_EQ(0u, PayloadCodec::decompress(unknown, sizeof(unknown), restored, sizeof(restored)));
+}
+
+// XIDで圧縮を合意した局は、圧縮されたIフレームを伸長して受け取ること
+TEST(CompressionTest, SecondaryAcceptsXidAndExpandsCompressedIFrame)
+{
+    // 一次局のXID(P)（圧縮の提案）。応答が無いので一次局は圧縮しない
+    const char *path = "primary_xid_compression.hbt";
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setResponseTimeout(5);
+        EXPECT_FALSE(primary.negotiateCompression(true));
+        EXPECT_FALSE(primary.currentSession().compression);
+    }
+
+    HDLC::StationSession session;
+    HDLC::initSession(session, 1);
+    session.linkState = HDLC::LINK_CONNECTED;
+    std::vector<uint8_t> response = secondaryResponseTo(path, &session, nullptr, nullptr);
+    const uint8_t expectedXid[] = {1, HDLC::CMD_XID | HDLC::POLL_FINAL_BIT, HDLC::XID_FORMAT_ID, HDLC::XID_GROUP_ID,
+                                   0, 3, HDLC::XID_PARAM_COMPRESSION, 1, 1};
+    EXPECT_EQ(std::vector<uint8_t>(expectedXid, expectedXid + sizeof(expectedXid)), response);
+    EXPECT_TRUE(session.compression);
+
+    // 圧縮されたIフレームは回線上で短くなる
+    std::vector<uint8_t> data(40, 0x00);
+    data[0] = 0x10;
+    data[39] = 0x99;
+    HDLC::StationSession primarySession;
+    HDLC::initSession(primarySession, 1);
+    primarySession.linkState = HDLC::LINK_CONNECTED;
+    primarySession.compression = true;
+    recordIFrame(path, primarySession, data);
+    std::vector<uint8_t> wire = firstFrameInTrace(path, BitTrace::CHANNEL_TX);
+    ASSERT_GE(wire.size(), 3u);
+    EXPECT_LT(wire.size(), 12u);
+    EXPECT_EQ(PayloadCodec::CODEC_RLE, wire[2]);
+
+    bool accepted = false;
+    std::vector<uint8_t> payload;
+    secondaryResponseTo(path, &session, &accepted, &payload);
+    EXPECT_TRUE(accepted);
+    ASSERT_EQ(2 + data.size(), payload.size());
+    EXPECT_EQ(data, std::vector<uint8_t>(payload.begin() + 2, payload.end()));
+
+    // 圧縮を合意していない局は伸長しない
+    session.compression = false;
+    session.receiveSequence = 0;
+    secondaryResponseTo(path, &session, &accepted, &payload);
+    remove(path);
+    EXPECT_EQ(wire, payload);
+}
+
+// ビット列をNRZIの回線レベルに変換（アイドル(1)から始め、0で反転）
+static std::vector<uint8_t> nrziLevels(const std::vector<uint8_t> &bits)
+{
+    std::vector<uint8_t> levels;
+    uint8_t level = 1;
+    for (uint8_t bit : bits)
+    {
+        if (bit == 0)
+        {
+            level ^= 1;
+        }
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+// NRZIで送受信でき、エッジ同期により送信側のクロックがずれた長いフレームも受信できること
+TEST(LineCodingTest, NrziRoundTripsAndTracksClockDrift)
+{
+    const char *path = "nrzi_iframe.hbt";
+    std::vector<uint8_t> zeros(40, 0x00);
+    {
+        ReplayPinInterface idleLine(3);
+        PinTraceRecorder recorder(idleLine, 2, 3, 4);
+        ASSERT_TRUE(recorder.open(path, BitTrace::FORMAT_BINARY));
+        HDLC primary(recorder, 2, 3, 4, 5, 9600);
+        primary.begin();
+        primary.setLineCoding(HDLC::LINE_NRZI);
+        HDLC::StationSession session;
+        HDLC::initSession(session, 1);
+        session.linkState = HDLC::LINK_CONNECTED;
+        primary.currentSession() = session;
+        primary.sendICommand(zeros.data(), zeros.size(), 5); // 応答なし
+    }
+
+    // NRZでは0の連続が一定レベルになるが、NRZIでは毎ビット反転する
+    {
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.open(path));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.setLineCoding(HDLC::LINE_NRZI);
+        ASSERT_TRUE(receiver.receiveFrameWithBitControl(200));
+        uint8_t frame[HDLC::MAX_FRAME_SIZE];
+        ASSERT_EQ(2 + zeros.size(), receiver.readFrame(frame, sizeof(frame)));
+        EXPECT_EQ(0x01, frame[0]);
+        EXPECT_EQ(0, memcmp(zeros.data(), frame + 2, zeros.size()));
+    }
+    EXPECT_TRUE(firstFrameInTrace(path, BitTrace::CHANNEL_TX).empty());
+    remove(path);
+
+    // 送信側のクロックが約5%遅い（1ビット109us）回線で60バイトの0を送る
+    std::vector<uint8_t> body = {0x01, 0x10};
+    body.insert(body.end(), 60, 0x00);
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 40);
+    appendFrame(bits, body);
+    appendBits(bits, 1, 40);
+
+    uint8_t frame[HDLC::MAX_FRAME_SIZE];
+    {
+        // NRZは標本点のずれが蓄積して受信できない
+        std::vector<uint8_t> trace = lineTrace(bits, 109);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.receiveFrameWithBitControl(100);
+        EXPECT_EQ(0u, receiver.readFrame(frame, sizeof(frame)));
+    }
+    {
+        std::vector<uint8_t> trace = lineTrace(nrziLevels(bits), 109);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC receiver(replay, 2, 3, 4, 5, 9600);
+        receiver.begin();
+        receiver.setLineCoding(HDLC::LINE_NRZI);
+        ASSERT_TRUE(receiver.receiveFrameWithBitControl(100));
+        ASSERT_EQ(body.size(), receiver.readFrame(frame, sizeof(frame)));
+        EXPECT_EQ(0, memcmp(body.data(), frame, body.size()));
+    }
+}
+
+// フラグとエスケープを0x7Dでエスケープし、戻せること
+TEST(OctetStuffingTest, EscapesFlagAndEscapeBytes)
+{
+    const uint8_t frame[] = {0x01, 0x7E, 0x10, 0x7D, 0x5E};
+    uint8_t encoded[16];
+    size_t length = OctetStuffing::encodeFrame(frame, sizeof(frame), encoded, sizeof(encoded));
+    const uint8_t expected[] = {0x7E, 0x01, 0x7D, 0x5E, 0x10, 0x7D, 0x5D, 0x5E, 0x7E};
+    ASSERT_EQ(sizeof(expected), length);
+    EXPECT_EQ(0, memcmp(expected, encoded, length));
+    EXPECT_EQ(0u, OctetStuffing::encodeFrame(frame, sizeof(frame), encoded, length - 1)); // 出力先不足
+
+    uint8_t decoded[16];
+    ASSERT_EQ(sizeof(frame), OctetStuffing::decode(encoded + 1, length - 2, decoded, sizeof(decoded)));
+    EXPECT_EQ(0, memcmp(frame, decoded, sizeof(frame)));
+
+    // 末尾のエスケープ・フラグの混入・出力先不足は異常
+    EXPECT_EQ(OctetStuffing::DECODE_ERROR, OctetStuffing::decode(encoded + 1, 2, decoded, sizeof(decoded)));
+    EXPECT_EQ(OctetStuffing::DECODE_ERROR, OctetStuffing::decode(encoded, length, decoded, sizeof(decoded)));
+    EXPECT_EQ(OctetStuffing::DECODE_ERROR, OctetStuffing::decode(encoded + 1, length - 2, decoded, 2));
+}
+
+// 非同期フレーミングでもビット同期と同じリンク制御で接続し、Iフレームを届けること
+TEST(ByteStreamTest, StationsConnectOverSocketPair)
+{
+    FdByteStream primaryStream, secondaryStream;
+    ASSERT_TRUE(FdByteStream::createPair(primaryStream, secondaryStream));
+
+    ReplayPinInterface primaryPins(3), secondaryPins(3);
+    HDLC primary(primaryPins, 2, 3, 4, 5, 115200);
+    HDLC secondary(secondaryPins, 2, 3, 4, 5, 115200);
+    primary.begin();
+    primary.setByteStream(&primaryStream);
+    primary.setResponseTimeout(100);
+    secondary.begin();
+    secondary.setByteStream(&secondaryStream);
+    secondary.setRole(HDLC::ROLE_SECONDARY);
+    receivedFrames.clear();
+    receivedValid.clear();
+    secondary.setReceiveCallback(recordReceivedFrame);
+
+    CompletionLog log;
+    primary.setCompletionCallback(CompletionLog::record, &log);
+    const uint8_t payload[] = {0x7E, 0x00, 0x7D, 0x42}; // エスケープが必要なバイトを含む
+    primary.connect();
+    primary.submitI(payload, sizeof(payload));
+    for (int i = 0; i < 100 && primary.pendingRequests() > 0; i++)
+    {
+        primary.service();
+        secondary.service();
+    }
+
+    ASSERT_EQ(2u, log.statuses.size());
+    EXPECT_EQ(HDLC::REQUEST_COMPLETED, log.statuses[0]);
+    EXPECT_EQ(HDLC::REQUEST_COMPLETED, log.statuses[1]);
+    EXPECT_EQ(HDLC::LINK_CONNECTED, secondary.currentSession().linkState);
+    EXPECT_EQ(1, secondary.currentSession().receiveSequence);
+    ASSERT_EQ(2u, receivedFrames.size()); // SNRMとIフレーム
+    ASSERT_EQ(2 + sizeof(payload), receivedFrames[1].size());
+    EXPECT_EQ(0, memcmp(payload, receivedFrames[1].data() + 2, sizeof(payload)));
+    EXPECT_EQ(0u, secondary.getReceiveStatistics().crcErrors);
+}
+
+// 疑似端末越しに調歩同期形式のバイト列を送受信すること
+TEST(ByteStreamTest, ExchangesEscapedFramesOverPty)
+{
+    FdByteStream master;
+    char slaveName[128];
+    ASSERT_TRUE(master.openPty(slaveName, sizeof(slaveName)));
+    FdByteStream slave;
+    ASSERT_TRUE(slave.open(slaveName, 115200));
+
+    ReplayPinInterface pins(3);
+    HDLC hdlc(pins, 2, 3, 4, 5, 115200);
+    hdlc.begin();
+    hdlc.setByteStream(&slave);
+    hdlc.setResponseTimeout(10);
+
+    // 送信: SNRMがフラグで囲まれて届く（応答は無い）
+    EXPECT_FALSE(hdlc.sendSNRMAndWaitUA());
+    std::vector<uint8_t> sent;
+    for (int value; (value = master.read()) >= 0;)
+    {
+        sent.push_back((uint8_t)value);
+    }
+    std::vector<uint8_t> snrm = {0x01, HDLC::CMD_SNRM};
+    uint16_t crc = HDLC::calculateCRC16(snrm.data(), snrm.size());
+    snrm.push_back(crc >> 8);
+    snrm.push_back(crc & 0xFF);
+    uint8_t expected[16];
+    size_t expectedLength = OctetStuffing::encodeFrame(snrm.data(), snrm.size(), expected, sizeof(expected));
+    ASSERT_EQ(expectedLength, sent.size());
+    EXPECT_EQ(0, memcmp(expected, sent.data(), expectedLength));
+
+    // 受信: 雑音（最初のフラグまで読み捨てる）の後に、エスケープを含むフレームとアボートしたフレーム
+    std::vector<uint8_t> frame = {0x01, 0x13, 0x7E, 0x7D, 0x55};
+    crc = HDLC::calculateCRC16(frame.data(), frame.size());
+    frame.push_back(crc >> 8);
+    frame.push_back(crc & 0xFF);
+    uint8_t line[32] = {0x33, 0x44};
+    size_t lineLength = 2 + OctetStuffing::encodeFrame(frame.data(), frame.size(), line + 2, sizeof(line) - 2);
+    const uint8_t aborted[] = {0x01, 0x13, 0x7D, 0x7E};
+    ASSERT_EQ(lineLength, master.write(line, lineLength));
+    ASSERT_EQ(sizeof(aborted), master.write(aborted, sizeof(aborted)));
+
+    ASSERT_TRUE(hdlc.receiveFrameWithBitControl(100));
+    uint8_t received[HDLC::MAX_FRAME_SIZE];
+    ASSERT_EQ(frame.size() - 2, hdlc.readFrame(received, sizeof(received)));
+    EXPECT_EQ(0, memcmp(frame.data(), received, frame.size() - 2));
+    EXPECT_FALSE(hdlc.receiveFrameWithBitControl(20));
+    EXPECT_EQ(0u, hdlc.getReceiveStatistics().crcErrors);
+    EXPECT_EQ(1u, hdlc.getReceiveStatistics().abortedFrames);
+}
+
+// 複数バイト単位のカーネルがどの位置・密度でも参照実装（1バイトずつ）と同じ結果になること
+TEST(OctetStuffingTest, WideKernelsMatchScalarReference)
+{
+    const OctetStuffing::Kernel kernels[] = {OctetStuffing::KERNEL_SWAR, OctetStuffing::KERNEL_SSE2,
+                                             OctetStuffing::KERNEL_AVX2};
+    EXPECT_TRUE(OctetStuffing::isKernelSupported(OctetStuffing::activeKernel()));
+    EXPECT_TRUE(OctetStuffing::isKernelSupported(OctetStuffing::KERNEL_SWAR));
+
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return (uint8_t)(seed >> 16);
+    };
+
+    std::vector<uint8_t> data(300);
+    for (int density : {0, 4, 64, 255}) // 0x7E/0x7Dの割合（/256）
+    {
+        for (uint8_t &byte : data)
+        {
+            byte = next();
+            if (byte < density)
+            {
+                byte = (byte & 1) ? OctetStuffing::FLAG : OctetStuffing::ESCAPE;
+            }
+            else if (byte == OctetStuffing::FLAG || byte == OctetStuffing::ESCAPE)
+            {
+                byte = 0;
+            }
+        }
+        for (size_t offset = 0; offset < 33; offset += 7)
+        {
+            for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 200})
+            {
+                const uint8_t *input = data.data() + offset;
+                std::vector<uint8_t> expected(OctetStuffing::maxEncodedSize(length));
+                size_t expectedLength = OctetStuffing::encodeFrame(OctetStuffing::KERNEL_SCALAR, input, length,
+                                                                   expected.data(), expected.size());
+                ASSERT_GT(expectedLength, 0u);
+                for (OctetStuffing::Kernel kernel : kernels)
+                {
+                    if (!OctetStuffing::isKernelSupported(kernel))
+                    {
+                        continue;
+                    }
+                    SCOPED_TRACE(::testing::Message() << "kernel " << kernel << " density " << density
+                                                      << " offset " << offset << " length " << length);
+                    std::vector<uint8_t> encoded(expected.size());
+                    ASSERT_EQ(expectedLength, OctetStuffing::encodeFrame(kernel, input, length, encoded.data(),
+                                                                         encoded.size()));
+                    EXPECT_EQ(0, memcmp(expected.data(), encoded.data(), expectedLength));
+                    // 出力先不足は参照実装と同じく0
+                    EXPECT_EQ(0u, OctetStuffing::encodeFrame(kernel, input, length, encoded.data(), expectedLength - 1));
+
+                    // 同じバッファでの復号
+                    size_t decodedLength = OctetStuffing::decode(kernel, encoded.data() + 1, expectedLength - 2,
+                                                                 encoded.data(), encoded.size());
+                    ASSERT_EQ(length, decodedLength);
+                    EXPECT_EQ(0, memcmp(input, encoded.data(), length));
+
+                    // 末尾のエスケープ・フラグの混入は異常
+                    if (length > 0)
+                    {
+                        std::vector<uint8_t> broken(expected.begin() + 1, expected.begin() + expectedLength - 1);
+                        broken.back() = OctetStuffing::ESCAPE;
+                        uint8_t out[600];
+                        EXPECT_EQ(OctetStuffing::decode(OctetStuffing::KERNEL_SCALAR, broken.data(), broken.size(),
+                                                        out, sizeof(out)),
+                                  OctetStuffing::decode(kernel, broken.data(), broken.size(), out, sizeof(out)));
+                        broken[broken.size() / 2] = OctetStuffing::FLAG;
+                        EXPECT_EQ(OctetStuffing::DECODE_ERROR,
+                                  OctetStuffing::decode(kernel, broken.data(), broken.size(), out, sizeof(out)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// フラグフィル（0x7Eの連続）だけの回線ではタイムアウトで戻り、続くフレームは受信できること
+TEST(ReceiveStateTest, FlagFillHonorsTimeout)
+{
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 16);
+    for (int i = 0; i < 3000; i++) // 約2.5秒
+    {
+        appendByte(bits, HDLC::FLAG_SEQUENCE);
+    }
+    appendFrame(bits, {0x01, 0x13, 0x42});
+    appendBits(bits, 1, 40);
+    std::vector<uint8_t> trace = lineTrace(bits);
+
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+    replay.setReplayChannel(BitTrace::CHANNEL_TX);
+    HDLC receiver(replay, 2, 3, 4, 5, 9600);
+    receiver.begin();
+    uint32_t start = replay.millis();
+    EXPECT_FALSE(receiver.receiveFrameWithBitControl(50));
+    EXPECT_LT(replay.millis() - start, 60u);
+
+    EXPECT_TRUE(receiver.receiveFrameWithBitControl(5000));
+    uint8_t received[HDLC::MAX_FRAME_SIZE];
+    ASSERT_EQ(3u, receiver.readFrame(received, sizeof(received)));
+    EXPECT_EQ(0x42, received[2]);
+    EXPECT_EQ(0u, receiver.getReceiveStatistics().abortedFrames);
+    EXPECT_EQ(0u, receiver.getReceiveStatistics().crcErrors);
+}
+
+// CRC異常・他局宛てのフレームの後のアイドルはアボートとして数えないこと
+TEST(ReceiveStateTest, IdleAfterRejectedFrameIsNotAbort)
+{
+    std::vector<uint8_t> bits;
+    appendBits(bits, 1, 16);
+    PackedBitWriter corrupt;
+    corrupt.frame({0x01, 0x13, 0x77}, true);
+    for (uint64_t i = 0; i < corrupt.bitCount(); i++)
+    {
+        bits.push_back((corrupt.bytes()[i / 8] >> (7 - i % 8)) & 1);
+    }
+    appendBits(bits, 1, 40);
+    for (int i = 0; i < 3; i++)
+    {
+        appendFrame(bits, {0x02, 0x13, 0x55}); // 他局宛て
+        appendBits(bits, 1, 40);
+    }
+    std::vector<uint8_t> trace = lineTrace(bits);
+
+    ReplayPinInterface replay(3);
+    ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+    replay.setReplayChannel(BitTrace::CHANNEL_TX);
+    HDLC receiver(replay, 2, 3, 4, 5, 9600);
+    receiver.begin();
+    receiver.setAddressFilter(true);
+    // CRC異常の後に回線がアイドルになればタイムアウトを待たずに戻る
+    EXPECT_FALSE(receiver.receiveFrameWithBitControl(1000));
+    EXPECT_LT(replay.millis(), 100u);
+    EXPECT_FALSE(receiver.receiveFrameWithBitControl(100));
+    EXPECT_EQ(1u, receiver.getReceiveStatistics().crcErrors);
+    EXPECT_EQ(3u, receiver.getReceiveStatistics().filteredFrames);
+    EXPECT_EQ(0u, receiver.getReceiveStatistics().abortedFrames);
+}
+
+// フラグフィル・0固定の回線でもservice()は数オクテット分で戻り、フラグフィルに続くフレームは受信できること
+TEST(ReceiveStateTest, ServiceDoesNotBlockOnFlagFillOrLowLine)
+{
+    std::vector<uint8_t> fill;
+    appendBits(fill, 1, 16);
+    for (int i = 0; i < 3000; i++) // 約2.5秒
+    {
+        appendByte(fill, HDLC::FLAG_SEQUENCE);
+    }
+    appendFrame(fill, {0x01, HDLC::CMD_SNRM | HDLC::POLL_FINAL_BIT});
+    appendBits(fill, 1, 40);
+
+    std::vector<uint8_t> low;
+    appendBits(low, 1, 16);
+    appendBits(low, 0, 20000); // 約2秒
+    appendBits(low, 1, 40);
+
+    const std::vector<uint8_t> *lines[] = {&fill, &low};
+    for (const std::vector<uint8_t> *line : lines)
+    {
+        std::vector<uint8_t> trace = lineTrace(*line);
+        ReplayPinInterface replay(3);
+        ASSERT_TRUE(replay.openMemory(trace.data(), trace.size()));
+        replay.setReplayChannel(BitTrace::CHANNEL_TX);
+        HDLC secondary(replay, 2, 3, 4, 5, 9600);
+        secondary.setRole(HDLC::ROLE_SECONDARY);
+        secondary.begin();
+
+        uint32_t longestMicros = 0;
+        size_t calls = 0;
+        while (!replay.isFinished() && calls < 1000000)
+        {
+            uint32_t start = replay.micros();
+            secondary.service();
+            uint32_t elapsed = replay.micros() - start;
+            longestMicros = elapsed > longestMicros ? elapsed : longestMicros;
+            calls++;
+            replay.delayMicroseconds(20);
+        }
+        if (line == &fill)
+        {
+            // 最長はフレーム（開始フラグからUAの送信・受信への切り替えまで）
+            EXPECT_LT(longestMicros, 20000u);
+            EXPECT_EQ(HDLC::LINK_CONNECTED, secondary.currentSession().linkState);
+        }
+        else
+        {
+            EXPECT_LT(longestMicros, 5000u);
+            EXPECT_EQ(HDLC::LINK_DISCONNECTED, secondary.currentSession().linkState);
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,181 @@
+/**
+ * @brief 非同期フレーミングのバイトスタッフィングのベンチマーク
+ *
+ * 使い方: stuffing_bench [-f フレーム長] [-d 割合] [-m 合計MB]
+ *
+ * 0x7E/0x7Dを指定の割合（/256）で含む乱数フレームを各カーネルで
+ * 符号化・復号し、1バイトずつの参照実装（KERNEL_SCALAR）と結果を比較して
+ * スループットを標準出力へ書き出す。
+ */
+#include "OctetStuffing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const char *kernelName(OctetStuffing::Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case OctetStuffing::KERNEL_SCALAR:
+            return "scalar";
+        case OctetStuffing::KERNEL_SWAR:
+            return "swar";
+        case OctetStuffing::KERNEL_SSE2:
+            return "sse2";
+        case OctetStuffing::KERNEL_AVX2:
+            return "avx2";
+        }
+        return "unknown";
+    }
+
+    void usage(const char *program)
+    {
+        fprintf(stderr, "Usage: %s [-f frame_size] [-d escape_density_per_256] [-m total_mb]\n", program);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t frameSize = 1500;
+    unsigned density = 2;
+    size_t totalMegabytes = 256;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            frameSize = (size_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            density = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            totalMegabytes = (size_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (frameSize == 0 || density > 256 || totalMegabytes == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // キャッシュに収まる程度のフレーム群を繰り返し処理する
+    const size_t frameCount = 256;
+    std::vector<uint8_t> frames(frameSize * frameCount);
+    uint32_t seed = 1;
+    for (uint8_t &byte : frames)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t value = seed >> 16;
+        if ((value & 0xFF) < density)
+        {
+            byte = (value & 0x100) ? OctetStuffing::FLAG : OctetStuffing::ESCAPE;
+        }
+        else
+        {
+            byte = (uint8_t)(value >> 8);
+            if (byte == OctetStuffing::FLAG || byte == OctetStuffing::ESCAPE)
+            {
+                byte = 0;
+            }
+        }
+    }
+    size_t iterations = (totalMegabytes * 1000000 + frames.size() - 1) / frames.size();
+
+    size_t encodedStride = OctetStuffing::maxEncodedSize(frameSize);
+    std::vector<uint8_t> reference(encodedStride * frameCount);
+    std::vector<size_t> referenceLengths(frameCount);
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        referenceLengths[i] = OctetStuffing::encodeFrame(OctetStuffing::KERNEL_SCALAR, &frames[i * frameSize],
+                                                         frameSize, &reference[i * encodedStride], encodedStride);
+    }
+
+    printf("frame %zu bytes, escape density %u/256, %zu MB per kernel, active kernel %s\n", frameSize, density,
+           totalMegabytes, kernelName(OctetStuffing::activeKernel()));
+    printf("%-8s %12s %12s %10s %10s\n", "kernel", "encode MB/s", "decode MB/s", "encode x", "decode x");
+
+    const OctetStuffing::Kernel kernels[] = {OctetStuffing::KERNEL_SCALAR, OctetStuffing::KERNEL_SWAR,
+                                             OctetStuffing::KERNEL_SSE2, OctetStuffing::KERNEL_AVX2};
+    double scalarEncode = 0;
+    double scalarDecode = 0;
+    int status = 0;
+    std::vector<uint8_t> encoded(encodedStride);
+    std::vector<uint8_t> decoded(frameSize);
+    for (OctetStuffing::Kernel kernel : kernels)
+    {
+        if (!OctetStuffing::isKernelSupported(kernel))
+        {
+            printf("%-8s %12s\n", kernelName(kernel), "unsupported");
+            continue;
+        }
+
+        // 参照実装と同じ出力になることを先に確認する
+        bool match = true;
+        for (size_t i = 0; i < frameCount && match; i++)
+        {
+            size_t length = OctetStuffing::encodeFrame(kernel, &frames[i * frameSize], frameSize, encoded.data(),
+                                                       encoded.size());
+            match = length == referenceLengths[i] && memcmp(encoded.data(), &reference[i * encodedStride], length) == 0 &&
+                    OctetStuffing::decode(kernel, encoded.data() + 1, length - 2, decoded.data(), decoded.size()) ==
+                        frameSize &&
+                    memcmp(decoded.data(), &frames[i * frameSize], frameSize) == 0;
+        }
+        if (!match)
+        {
+            printf("%-8s %12s\n", kernelName(kernel), "MISMATCH");
+            status = 1;
+            continue;
+        }
+
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                checksum += OctetStuffing::encodeFrame(kernel, &frames[i * frameSize], frameSize, encoded.data(),
+                                                       encoded.size());
+            }
+        }
+        double encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t iteration = 0; iteration < iterations; iteration++)
+        {
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                checksum += OctetStuffing::decode(kernel, &reference[i * encodedStride + 1], referenceLengths[i] - 2,
+                                                  decoded.data(), decoded.size());
+            }
+        }
+        double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double megabytes = (double)iterations * frames.size() / 1e6;
+        double encodeRate = encodeSeconds > 0 ? megabytes / encodeSeconds : 0;
+        double decodeRate = decodeSeconds > 0 ? megabytes / decodeSeconds : 0;
+        if (kernel == OctetStuffing::KERNEL_SCALAR)
+        {
+            scalarEncode = encodeRate;
+            scalarDecode = decodeRate;
+        }
+        printf("%-8s %12.1f %12.1f %9.2fx %9.2fx\n", kernelName(kernel), encodeRate, decodeRate,
+               scalarEncode > 0 ? encodeRate / scalarEncode : 0, scalarDecode > 0 ? decodeRate / scalarDecode : 0);
+        if (checksum == 0)
+        {
+            status = 1; // 最適化で処理が消えないよう結果を使う
+        }
+    }
+    return status;
+}